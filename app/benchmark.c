@@ -1,15 +1,35 @@
 #include "benchmark.h"
+#include "views.h"
 
 #include <malloc.h>
 #include <tools/compiler.h>
 #include <tools/timer.h>
+#include <tools/stats.h>
 #include <kernel/mdb_kernel.h>
 #include <sched/rsched.h>
 
-#include <tools/atomic.h>
+#include <tools/mem.h>
+#include <tools/nproc.h>
+#include <math.h>
 #include <limits.h>
+#include <string.h>
+#include <inttypes.h>
 #include <tools/log.h>
+#include <tools/error_codes.h>
 
+/* Lane efficiency in 1/100 of a percent */
+static inline
+uint64_t lane_efficiency(const struct mdb_lane_stats* st)
+{
+        return st->active * 10000 / MAX(st->issued, 1);
+}
+
+static inline
+void benchmark_add_block_time(struct bench_thread* th, uint64_t elapsed_time)
+{
+        perf_hist_add(&th->block_hist, elapsed_time);
+        th->block_total += elapsed_time;
+}
 
 static
 void benchmark_proc_fun(uint32_t x0, uint32_t x1, uint32_t y0,
@@ -17,8 +37,7 @@ void benchmark_proc_fun(uint32_t x0, uint32_t x1, uint32_t y0,
 {
         struct perf_timer tm_block;
         struct benchmark* bench = ctx;
-
-        uint64_t elapsed_time, min_time, max_time;
+        struct bench_thread* th = &bench->threads[rsched_thread_id()];
 
         perf_timer_start(&tm_block);
 
@@ -26,45 +45,138 @@ void benchmark_proc_fun(uint32_t x0, uint32_t x1, uint32_t y0,
 
         perf_timer_stop(&tm_block);
 
+        benchmark_add_block_time(th, perf_timer_diff_ns(&tm_block));
+}
+
+static
+void benchmark_proc_lanes_fun(uint32_t x0, uint32_t x1, uint32_t y0,
+                              uint32_t y1, void* ctx)
+{
+        struct perf_timer tm_block;
+        struct benchmark* bench = ctx;
+        struct bench_thread* th = &bench->threads[rsched_thread_id()];
+        struct mdb_lane_stats tile = {0, 0};
+
+        perf_timer_start(&tm_block);
+
+        mdb_kernel_process_block_stats(bench->kernel, x0, x1, y0, y1, &tile);
+
+        perf_timer_stop(&tm_block);
+
+        benchmark_add_block_time(th, perf_timer_diff_ns(&tm_block));
+
+        th->lanes.issued += tile.issued;
+        th->lanes.active += tile.active;
+
+        /* A lane is active until its pixel escapes */
+        th->iters += tile.active;
+
+        perf_hist_add(&th->lane_hist, lane_efficiency(&tile));
+}
+
+static
+void benchmark_proc_iters_fun(uint32_t x0, uint32_t x1, uint32_t y0,
+                              uint32_t y1, void* ctx)
+{
+        struct perf_timer tm_block;
+        struct benchmark* bench = ctx;
+        struct bench_thread* th = &bench->threads[rsched_thread_id()];
+        uint64_t iters = 0;
+
+        perf_timer_start(&tm_block);
 
-        elapsed_time = perf_timer_diff_ns(&tm_block);
+        mdb_kernel_process_block_iters(bench->kernel, x0, x1, y0, y1, &iters);
 
-        min_time = atomic_load(&bench->min_block_time);
-        while(min_time > elapsed_time)
+        perf_timer_stop(&tm_block);
+
+        benchmark_add_block_time(th, perf_timer_diff_ns(&tm_block));
+
+        th->iters += iters;
+}
+
+/* Warm-up frames only run the kernel */
+static
+void benchmark_proc_warmup_fun(uint32_t x0, uint32_t x1, uint32_t y0,
+                               uint32_t y1, void* ctx)
+{
+        struct benchmark* bench = ctx;
+
+        mdb_kernel_process_block(bench->kernel, x0, x1, y0, y1);
+}
+
+static
+void benchmark_threads_create(struct benchmark* bench)
+{
+        size_t size;
+        uint32_t i;
+
+        bench->n_threads = rsched_threads_count(bench->sched);
+
+        size = bench->n_threads * sizeof(*bench->threads);
+        bench->threads = malloc_aligned(size, 64);
+        memset(bench->threads, 0, size);
+
+        for(i = 0; i < bench->n_threads; ++i)
         {
-                if(atomic_compare_exchange(&bench->min_block_time,
-                                           &min_time, elapsed_time))
-                        break;
+                perf_hist_init(&bench->threads[i].block_hist);
+
+                if(bench->lane_stats)
+                        perf_hist_init(&bench->threads[i].lane_hist);
         }
 
-        max_time = atomic_load(&bench->max_block_time);
-        while(max_time < elapsed_time)
+        if(bench->lane_stats)
+                perf_hist_init(&bench->lanes_frame_hist);
+}
+
+static
+void benchmark_threads_destroy(struct benchmark* bench)
+{
+        uint32_t i;
+
+        for(i = 0; i < bench->n_threads; ++i)
         {
-                if(atomic_compare_exchange(&bench->max_block_time,
-                                           &max_time, elapsed_time))
-                        break;
+                perf_hist_destroy(&bench->threads[i].block_hist);
+
+                if(bench->lane_stats)
+                        perf_hist_destroy(&bench->threads[i].lane_hist);
         }
 
-        atomic_fetch_add_relaxed(&bench->total_block_time, elapsed_time);
-        atomic_fetch_add_relaxed(&bench->block_count, 1);
+        if(bench->lane_stats)
+                perf_hist_destroy(&bench->lanes_frame_hist);
+
+        free_aligned(bench->threads);
+        bench->threads = NULL;
 }
 
+/* Sum up lane counters of the last frame, workers must be parked */
 static
-void benchmark_proc_dummy_fun(uint32_t x0, uint32_t x1, uint32_t y0,
-                                     uint32_t y1, void* ctx)
+void benchmark_lanes_frame(struct benchmark* bench)
 {
-        UNUSED_PARAM(x0);
-        UNUSED_PARAM(x1);
-        UNUSED_PARAM(y0);
-        UNUSED_PARAM(y1);
-        UNUSED_PARAM(ctx);
+        struct mdb_lane_stats frame = {0, 0};
+        uint32_t i;
+
+        for(i = 0; i < bench->n_threads; ++i)
+        {
+                frame.issued += bench->threads[i].lanes.issued;
+                frame.active += bench->threads[i].lanes.active;
+
+                bench->threads[i].lanes.issued = 0;
+                bench->threads[i].lanes.active = 0;
+        }
+
+        bench->lanes_total.issued += frame.issued;
+        bench->lanes_total.active += frame.active;
+
+        perf_hist_add(&bench->lanes_frame_hist, lane_efficiency(&frame));
 }
 
 void benchmark_create(struct benchmark** pbench, uint32_t runs,
                       struct mdb_kernel* kernel,
-                      struct rsched* sched)
+                      struct rsched* sched,
+                      bool lane_stats)
 {
         struct benchmark* bench;
+        rsched_user_fun proc_fun = &benchmark_proc_fun;
 
         *pbench = calloc(1, sizeof(**pbench));
         bench = *pbench;
@@ -73,63 +185,493 @@ void benchmark_create(struct benchmark** pbench, uint32_t runs,
         bench->sched = sched;
 
         bench->runs = runs;
+        bench->frame_time = calloc(runs, sizeof(*bench->frame_time));
+
+        bench->batches = 1;
+        bench->batch_time = calloc(1, sizeof(*bench->batch_time));
+
+        if(lane_stats && !mdb_kernel_has_lane_stats(kernel))
+        {
+                LOG_WARN("The kernel doesn't count SIMD lane utilization.");
+        }
+        else if(lane_stats)
+        {
+                bench->lane_stats = true;
+                bench->iter_stats = true;
+                proc_fun = &benchmark_proc_lanes_fun;
+        }
+
+        if(!bench->lane_stats && mdb_kernel_has_iter_stats(kernel))
+        {
+                bench->iter_stats = true;
+                proc_fun = &benchmark_proc_iters_fun;
+        }
 
-        atomic_store(&bench->total_block_time, 0);
-        atomic_store(&bench->min_block_time, UINT64_MAX);
-        atomic_store(&bench->max_block_time, 0);
-        atomic_store(&bench->block_count, 0);
+        benchmark_threads_create(bench);
 
-        rsched_set_user_context(bench->sched, &benchmark_proc_fun, bench);
+        bench->proc_fun = proc_fun;
+        rsched_set_user_context(bench->sched, proc_fun, bench);
 }
 
 void benchmark_destroy(struct benchmark* bench)
 {
+        benchmark_threads_destroy(bench);
+        free(bench->batch_time);
+        free(bench->frame_time);
         free(bench);
 }
 
+int benchmark_set_view(struct benchmark* bench, const struct view* view)
+{
+        bench->view = view;
+
+        if(!view)
+                return MDB_SUCCESS;
+
+        return view_apply(view, bench->kernel, 0, 1);
+}
+
+void benchmark_set_batches(struct benchmark* bench, uint32_t warmup,
+                           uint32_t batches)
+{
+        uint32_t runs = bench->runs / bench->batches;
+
+        bench->warmup = warmup;
+        bench->batches = MAX(batches, 1);
+        bench->runs = runs * bench->batches;
+
+        free(bench->frame_time);
+        free(bench->batch_time);
+
+        bench->frame_time = calloc(bench->runs, sizeof(*bench->frame_time));
+        bench->batch_time = calloc(bench->batches,
+                                   sizeof(*bench->batch_time));
+}
+
+/* Average current frequency of the cpus the threads are bound to
+ * in kHz, 0 if unknown.
+ */
 static
-void benchmark_run_kernel(struct benchmark* bench)
+uint32_t benchmark_cpu_freq(struct benchmark* bench)
 {
-        struct perf_timer tm_kernel;
-        uint32_t runs = bench->runs;
-        uint32_t run = 0;
+        uint32_t n = MIN(bench->n_threads, (uint32_t)nproc_active());
+        uint64_t sum = 0;
+        uint32_t i;
+        int freq;
 
-        perf_timer_start(&tm_kernel);
+        for(i = 0; i < n; ++i)
+        {
+                freq = nproc_cur_freq((int)i);
+                if(!freq)
+                        return 0;
+
+                sum += (uint64_t)freq;
+        }
 
-        while(run < runs)
+        return (uint32_t)(sum / MAX(n, 1));
+}
+
+static
+void benchmark_track_freq(struct benchmark* bench)
+{
+        uint32_t freq = benchmark_cpu_freq(bench);
+
+        if(!freq)
+                return;
+
+        bench->freq_min = bench->freq_min ? MIN(bench->freq_min, freq) : freq;
+        bench->freq_max = MAX(bench->freq_max, freq);
+}
+
+static inline
+void benchmark_frame(struct benchmark* bench)
+{
+        uint64_t start = 0;
+
+        if(!bench->first_frame)
+                start = perf_ticks();
+
+        rsched_host_yield(bench->sched);
+        rsched_requeue(bench->sched);
+
+        if(!bench->first_frame)
+                bench->first_frame = perf_ticks_to_ns(perf_ticks() - start);
+}
+
+/* Run the requested warm-up frames without recording anything, if
+ * cpufreq is available keep going until the frequency settles.
+ */
+static
+void benchmark_warmup(struct benchmark* bench)
+{
+        uint32_t max = bench->warmup * BENCH_WARMUP_MAX;
+        uint32_t prev, cur;
+        bool settled;
+
+        bench->warmup_done = 0;
+
+        if(!bench->warmup)
+                return;
+
+        rsched_set_user_context(bench->sched, &benchmark_proc_warmup_fun,
+                                bench);
+
+        prev = benchmark_cpu_freq(bench);
+
+        while(bench->warmup_done < max)
         {
-                rsched_host_yield(bench->sched);
-                rsched_requeue(bench->sched);
+                benchmark_frame(bench);
+                ++bench->warmup_done;
 
-                ++run;
+                cur = benchmark_cpu_freq(bench);
+                settled = fabs((double)cur - prev) <= BENCH_FREQ_SETTLE * prev;
+                prev = cur;
+
+                if(bench->warmup_done >= bench->warmup && settled)
+                        break;
         }
 
-        perf_timer_stop(&tm_kernel);
-        bench->total_exec_time = perf_timer_diff_sec(&tm_kernel);
+        rsched_set_user_context(bench->sched, bench->proc_fun, bench);
+}
+
+/* Record frame run, a zoom path restarts with every batch */
+static
+uint64_t benchmark_record_frame(struct benchmark* bench, uint32_t run)
+{
+        struct perf_timer tm_frame;
+        uint32_t runs = bench->runs / bench->batches;
+
+        if(bench->view && bench->view->type == VIEW_ZOOM)
+                view_apply(bench->view, bench->kernel, run % runs, runs);
+
+        perf_timer_start(&tm_frame);
+
+        benchmark_frame(bench);
+
+        perf_timer_stop(&tm_frame);
+        bench->frame_time[run] = perf_timer_diff_ns(&tm_frame);
+
+        if(bench->lane_stats)
+                benchmark_lanes_frame(bench);
+
+        return bench->frame_time[run];
+}
+
+static
+void benchmark_run_batch(struct benchmark* bench, uint32_t batch)
+{
+        struct perf_timer tm_batch;
+        uint32_t runs = bench->runs / bench->batches;
+        uint64_t sum = 0;
+        uint32_t run;
+
+        perf_timer_start(&tm_batch);
+
+        for(run = 0; run < runs; ++run)
+                sum += benchmark_record_frame(bench, batch * runs + run);
+
+        perf_timer_stop(&tm_batch);
+
+        bench->total_exec_time += perf_timer_diff_sec(&tm_batch);
+        bench->batch_time[batch] = sum / MAX(runs, 1);
+}
+
+void benchmark_run_warmup(struct benchmark* bench)
+{
+        benchmark_warmup(bench);
+}
+
+void benchmark_run_frame(struct benchmark* bench, uint32_t run)
+{
+        rsched_set_user_context(bench->sched, bench->proc_fun, bench);
+
+        bench->total_exec_time +=
+                ns_to_sec(benchmark_record_frame(bench, run));
 }
 
 void benchmark_run(struct benchmark* bench)
 {
-        benchmark_run_kernel(bench);
+        uint32_t batch;
+
+        benchmark_warmup(bench);
+
+        bench->total_exec_time = 0;
+        bench->freq_min = bench->freq_max = 0;
+
+        for(batch = 0; batch < bench->batches; ++batch)
+        {
+                benchmark_track_freq(bench);
+                benchmark_run_batch(bench, batch);
+        }
+
+        benchmark_track_freq(bench);
+}
+
+static
+void benchmark_print_lanes(struct benchmark* bench)
+{
+        struct perf_hist tiles;
+        struct perf_hist* frames = &bench->lanes_frame_hist;
+        uint32_t i;
+
+        perf_hist_init(&tiles);
+
+        for(i = 0; i < bench->n_threads; ++i)
+                perf_hist_merge(&tiles, &bench->threads[i].lane_hist);
+
+        /* Low efficiency is the bad tail, so low percentiles are shown */
+        PARAM_INFO("Lane efficiency", "%.2f %%",
+                   lane_efficiency(&bench->lanes_total) / 100.0);
+        PARAM_INFO("Lane iterations", "%'lu / %'lu",
+                   bench->lanes_total.active, bench->lanes_total.issued);
+        PARAM_INFO("Tile lane eff min", "%.2f %%", tiles.min / 100.0);
+        PARAM_INFO("Tile lane eff p1", "%.2f %%",
+                   perf_hist_percentile(&tiles, 1) / 100.0);
+        PARAM_INFO("Tile lane eff p10", "%.2f %%",
+                   perf_hist_percentile(&tiles, 10) / 100.0);
+        PARAM_INFO("Tile lane eff p50", "%.2f %%",
+                   perf_hist_percentile(&tiles, 50) / 100.0);
+        PARAM_INFO("Frame lane eff min", "%.2f %%", frames->min / 100.0);
+        PARAM_INFO("Frame lane eff p50", "%.2f %%",
+                   perf_hist_percentile(frames, 50) / 100.0);
+        PARAM_INFO("Frame lane eff max", "%.2f %%", frames->max / 100.0);
+
+        perf_hist_destroy(&tiles);
+}
+
+static
+void benchmark_print_iters(const struct bench_summary* sum)
+{
+        PARAM_INFO("Iterations", "%" PRIu64, sum->iters);
+        PARAM_INFO("Giga-iterations/s", "%f", sum->giga_iters);
+        PARAM_INFO("Time per iteration", "%f ns", sum->iter_ns);
+
+        if(sum->cycle_hz)
+                PARAM_INFO("Iterations per cycle", "%f at %.0f MHz",
+                           sum->iter_cycles, sum->cycle_hz / 1e6);
+        else
+                PARAM_INFO("Iterations per cycle", "%s", "unknown");
+}
+
+/* Merge block times of all threads, hist must be initialized */
+static
+uint64_t benchmark_block_hist(struct benchmark* bench, struct perf_hist* hist)
+{
+        uint64_t total = 0;
+        uint32_t i;
+
+        for(i = 0; i < bench->n_threads; ++i)
+        {
+                perf_hist_merge(hist, &bench->threads[i].block_hist);
+                total += bench->threads[i].block_total;
+        }
+
+        return total;
+}
+
+/* Core clock for cycle estimates in Hz, 0 if unknown */
+static
+double benchmark_cycle_hz(struct benchmark* bench)
+{
+        if(bench->freq_max)
+                return (bench->freq_min + bench->freq_max) / 2.0 * 1e3;
+
+        if(__perf_clock.source == PERF_CLOCK_TSC)
+                return (double)__perf_clock.freq;
+
+        return 0;
+}
+
+static
+void benchmark_summarize_iters(struct benchmark* bench,
+                               struct bench_summary* sum)
+{
+        uint32_t i;
+
+        sum->iters = 0;
+        sum->giga_iters = sum->iter_ns = sum->iter_cycles = 0;
+        sum->cycle_hz = benchmark_cycle_hz(bench);
+
+        if(!bench->iter_stats)
+                return;
+
+        for(i = 0; i < bench->n_threads; ++i)
+                sum->iters += bench->threads[i].iters;
+
+        if(!sum->iters)
+                return;
+
+        sum->giga_iters = sum->iters / bench->total_exec_time / 1e9;
+        sum->iter_ns = (double)sum->block_total / sum->iters;
+        sum->iter_cycles = sum->cycle_hz ? 1e9 / (sum->iter_ns
+                                                  * sum->cycle_hz)
+                                         : 0;
+}
+
+void benchmark_summarize(struct benchmark* bench, struct bench_summary* sum)
+{
+        struct perf_hist hist;
+        uint64_t* sorted;
+        uint32_t n = bench->runs;
+
+        sample_stats_compute(bench->frame_time, n, &sum->frame);
+
+        sorted = malloc(n * sizeof(*sorted));
+        memcpy(sorted, bench->frame_time, n * sizeof(*sorted));
+        sample_sort(sorted, n);
+
+        sum->frame_pct.p50  = sample_percentile(sorted, n, 50);
+        sum->frame_pct.p90  = sample_percentile(sorted, n, 90);
+        sum->frame_pct.p99  = sample_percentile(sorted, n, 99);
+        sum->frame_pct.p999 = sample_percentile(sorted, n, 99.9);
+
+        free(sorted);
+
+        n = bench->batches;
+
+        sample_stats_compute(bench->batch_time, n, &sum->batch);
+        sum->batch_ci = sample_mean_ci(&sum->batch, BENCH_CI_CONFIDENCE);
+
+        sorted = malloc(n * sizeof(*sorted));
+        memcpy(sorted, bench->batch_time, n * sizeof(*sorted));
+        sample_sort(sorted, n);
+
+        sum->batch_p50 = sample_percentile(sorted, n, 50);
+
+        free(sorted);
+
+        perf_hist_init(&hist);
+
+        sum->block_total = benchmark_block_hist(bench, &hist);
+        sum->blocks = hist.count;
+        sum->block_min = hist.count ? hist.min : 0;
+        sum->block_max = hist.max;
+
+        sum->block_pct.p50  = perf_hist_percentile(&hist, 50);
+        sum->block_pct.p90  = perf_hist_percentile(&hist, 90);
+        sum->block_pct.p99  = perf_hist_percentile(&hist, 99);
+        sum->block_pct.p999 = perf_hist_percentile(&hist, 99.9);
+
+        perf_hist_destroy(&hist);
+
+        benchmark_summarize_iters(bench, sum);
+}
+
+static
+void benchmark_print_frames(struct benchmark* bench,
+                            const struct bench_summary* sum)
+{
+        const struct sample_stats* st = &sum->frame;
+        struct perf_hist hist;
+        uint32_t i;
+
+        PARAM_INFO("Frame time avg", "%f ms", st->mean / 1e6);
+        PARAM_INFO("Frame time min", "%f ms", st->min / 1e6);
+        PARAM_INFO("Frame time p50", "%f ms", ns_to_ms(sum->frame_pct.p50));
+        PARAM_INFO("Frame time p90", "%f ms", ns_to_ms(sum->frame_pct.p90));
+        PARAM_INFO("Frame time p99", "%f ms", ns_to_ms(sum->frame_pct.p99));
+        PARAM_INFO("Frame time p99.9", "%f ms",
+                   ns_to_ms(sum->frame_pct.p999));
+        PARAM_INFO("Frame time max", "%f ms", st->max / 1e6);
+        PARAM_INFO("Frame time stddev", "%f ms", st->stddev / 1e6);
+        PARAM_INFO("Frame jitter", "%f ms", st->jitter / 1e6);
+
+        if(bench->runs < 2)
+                return;
+
+        perf_hist_init(&hist);
+
+        for(i = 0; i < bench->runs; ++i)
+                perf_hist_add(&hist, bench->frame_time[i]);
+
+        LOG_SAY("Frame time distribution");
+        perf_hist_print(&hist, 8, 0, 0, false);
+
+        perf_hist_destroy(&hist);
+}
+
+static
+void benchmark_print_blocks(struct benchmark* bench,
+                            const struct bench_summary* sum)
+{
+        struct perf_hist hist;
+
+        PARAM_INFO("Total blocks", "%lu", sum->blocks);
+        PARAM_INFO("Avg block time", "%f ms",
+                   ns_to_ms(sum->block_total / MAX(sum->blocks, 1)));
+        PARAM_INFO("Min block time", "%f ms", ns_to_ms(sum->block_min));
+        PARAM_INFO("Block time p50", "%f ms", ns_to_ms(sum->block_pct.p50));
+        PARAM_INFO("Block time p90", "%f ms", ns_to_ms(sum->block_pct.p90));
+        PARAM_INFO("Block time p99", "%f ms", ns_to_ms(sum->block_pct.p99));
+        PARAM_INFO("Block time p99.9", "%f ms",
+                   ns_to_ms(sum->block_pct.p999));
+        PARAM_INFO("Max block time", "%f ms", ns_to_ms(sum->block_max));
+        PARAM_INFO("Total block time", "%f sec",
+                   ns_to_ms(sum->block_total / bench->n_threads) / 1000.0);
+
+        perf_hist_init(&hist);
+        benchmark_block_hist(bench, &hist);
+
+        LOG_SAY("Block time distribution");
+        perf_hist_print(&hist, 8, 0, 0, true);
+
+        perf_hist_destroy(&hist);
+}
+
+static
+void benchmark_print_stability(struct benchmark* bench,
+                               const struct bench_summary* sum)
+{
+        double drift;
+
+        PARAM_INFO("Warm-up runs", "%u", bench->warmup_done);
+
+        if(bench->batches > 1)
+        {
+                PARAM_INFO("Batches", "%u x %u runs", bench->batches,
+                           bench->runs / bench->batches);
+                PARAM_INFO("Batch frame avg p50", "%f ms",
+                           ns_to_ms(sum->batch_p50));
+                PARAM_INFO("Batch frame avg", "%f ms +- %f ms (%.0f %% CI)",
+                           sum->batch.mean / 1e6, sum->batch_ci / 1e6,
+                           BENCH_CI_CONFIDENCE * 100.0);
+        }
+
+        if(!bench->freq_max)
+        {
+                PARAM_INFO("CPU frequency", "%s", "unknown");
+                return;
+        }
+
+        drift = (double)(bench->freq_max - bench->freq_min) / bench->freq_max;
+
+        PARAM_INFO("CPU frequency", "%u - %u MHz",
+                   bench->freq_min / 1000, bench->freq_max / 1000);
+
+        if(drift > BENCH_FREQ_DRIFT)
+                LOG_WARN("CPU frequency drifted by %.1f %% during the "
+                         "benchmark, results may be unreliable.",
+                         drift * 100.0);
 }
 
 void benchmark_print_summary(struct benchmark* bench)
 {
-        uint32_t threads = rsched_threads_count(bench->sched);
+        struct bench_summary sum;
 
-        double block_ms = ns_to_ms(atomic_load(&bench->total_block_time) / threads);
-        double min_block_ms = ns_to_ms(atomic_load(&bench->min_block_time));
-        double max_block_ms = ns_to_ms(atomic_load(&bench->max_block_time));
+        benchmark_summarize(bench, &sum);
 
-        uint64_t block_count = atomic_load(&bench->block_count);
+        benchmark_print_blocks(bench, &sum);
+        benchmark_print_frames(bench, &sum);
+        benchmark_print_stability(bench, &sum);
 
-        PARAM_INFO("Total blocks", "%du", (unsigned int)block_count);
-        PARAM_INFO("Avg block time", "%f ms", (block_ms / block_count));
-        PARAM_INFO("Min block time", "%f ms", min_block_ms);
-        PARAM_INFO("Max block time", "%f ms", max_block_ms);
-        PARAM_INFO("Total block time", "%f sec", (block_ms / 1000.0));
         PARAM_INFO("Total execution time", "%f sec", bench->total_exec_time);
         PARAM_INFO("Total runs", "%i", bench->runs);
         PARAM_INFO("Avg FPS", "%f",
                    ((double)bench->runs / bench->total_exec_time));
+
+        if(bench->lane_stats)
+                benchmark_print_lanes(bench);
+
+        if(bench->iter_stats)
+                benchmark_print_iters(&sum);
 }
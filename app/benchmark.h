@@ -1,7 +1,36 @@
 #pragma once
 
+#include <stdbool.h>
 #include <sched/rsched.h>
 #include <kernel/mdb_kernel.h>
+#include <tools/hist.h>
+#include <tools/stats.h>
+
+/* struct bench_thread - per-thread benchmark counters.
+ *
+ * Every scheduler thread writes only its own entry so blocks are
+ * accounted without any shared atomics, the host merges them after
+ * the run.
+ *
+ * @block_hist  - time of every processed block in ns.
+ * @block_total - sum of block times in ns.
+ * @lanes       - SIMD lane counters of the current frame, summed up
+ *                by the host after the frame.
+ * @lane_hist   - per-tile lane efficiency in 1/100 of a percent.
+ * @iters       - escape-time iterations of recorded blocks.
+ */
+struct __cache_aligned bench_thread
+{
+        struct perf_hist block_hist;
+        uint64_t block_total;
+
+        struct mdb_lane_stats lanes;
+        struct perf_hist lane_hist;
+
+        uint64_t iters;
+};
+
+struct view;
 
 struct benchmark
 {
@@ -10,26 +39,158 @@ struct benchmark
 
         int width, height;
 
+        /* Recorded frames of all batches */
         uint32_t runs;
         double total_exec_time;
 
-        __cache_aligned
-        __atomic
-        uint64_t total_block_time;
+        /* Requested and actually run warm-up frames */
+        uint32_t warmup;
+        uint32_t warmup_done;
+
+        /* Frames are recorded in batches of runs / batches */
+        uint32_t batches;
+
+        /* Mean frame time of every batch in ns */
+        uint64_t* batch_time;
+
+        /* Average frequency of the used cpus sampled around batches
+         * in kHz, 0 if unknown
+         */
+        uint32_t freq_min, freq_max;
+
+        rsched_user_fun proc_fun;
+
+        /* View of the set, a zoom path is replayed by every batch.
+         * NULL keeps the view of the kernel.
+         */
+        const struct view* view;
+
+        /* Bailout the kernel is set to for reports, 0 if unknown */
+        uint32_t bailout;
+
+        /* One per scheduler thread, see rsched_thread_id */
+        struct bench_thread* threads;
+        uint32_t n_threads;
+
+        /* Time of every frame in ns */
+        uint64_t* frame_time;
+
+        /* Time of the very first frame in ns, warm-up or not, it pays
+         * for lazily started workers and first page touches
+         */
+        uint64_t first_frame;
+
+        /* Count SIMD lane utilization */
+        bool lane_stats;
+
+        /* Count escape-time iterations, on if the kernel supports it */
+        bool iter_stats;
 
-        __atomic
-        uint64_t min_block_time;
+        struct mdb_lane_stats lanes_total;
 
-        __atomic
-        uint64_t max_block_time;
+        /* Per-frame lane efficiency in 1/100 of a percent */
+        struct perf_hist lanes_frame_hist;
+};
 
-        __atomic
-        uint64_t block_count;
+struct bench_percentiles
+{
+        uint64_t p50, p90, p99, p999;
 };
 
+/* struct bench_summary - results of a benchmark run, times are in ns.
+ *
+ * @frame       - statistics of frame times.
+ * @frame_pct   - exact percentiles of frame times.
+ * @blocks      - count of processed blocks.
+ * @block_total - sum of block times over all threads.
+ * @block_pct   - percentiles of block times within histogram precision.
+ * @batch       - statistics of mean frame times of batches.
+ * @batch_p50   - median of mean frame times of batches.
+ * @batch_ci    - half-width of the BENCH_CI_CONFIDENCE interval of
+ *                the mean over batches.
+ * @iters       - escape-time iterations of all recorded frames, 0 if
+ *                the kernel doesn't count them.
+ * @giga_iters  - billions of iterations per second of wall time.
+ * @iter_ns     - block time of all threads per iteration.
+ * @iter_cycles - iterations per core cycle, cycles are estimated from
+ *                block time and cycle_hz.
+ * @cycle_hz    - average cpufreq frequency of the run or the TSC
+ *                frequency if it's unknown, 0 if neither is available.
+ */
+struct bench_summary
+{
+        struct sample_stats frame;
+        struct bench_percentiles frame_pct;
+
+        uint64_t blocks;
+        uint64_t block_total;
+        uint64_t block_min, block_max;
+        struct bench_percentiles block_pct;
+
+        struct sample_stats batch;
+        uint64_t batch_p50;
+        double batch_ci;
+
+        uint64_t iters;
+        double giga_iters;
+        double iter_ns;
+        double iter_cycles;
+        double cycle_hz;
+};
+
+/* lane_stats - count SIMD lane utilization if the kernel supports it.
+ * Escape-time iterations are counted if the kernel supports either.
+ */
 void benchmark_create(struct benchmark** pbench, uint32_t runs,
                       struct  mdb_kernel* kernel,
-                      struct rsched* sched);
+                      struct rsched* sched,
+                      bool lane_stats);
 void benchmark_destroy(struct benchmark* bench);
+
+/* Set the view for the following runs, see app/views.h */
+int benchmark_set_view(struct benchmark* bench, const struct view* view);
+
+/* Run warmup frames before measuring and record the runs given to
+ * benchmark_create batches times. Must be called before benchmark_run.
+ */
+void benchmark_set_batches(struct benchmark* bench, uint32_t warmup,
+                           uint32_t batches);
 void benchmark_run(struct benchmark* bench);
+
+/* Frame by frame runs for benchmarks sharing a scheduler and a surface,
+ * e.g. interleaved comparisons. benchmark_run_frame switches the user
+ * context of the scheduler to bench and records frame run.
+ */
+void benchmark_run_warmup(struct benchmark* bench);
+void benchmark_run_frame(struct benchmark* bench, uint32_t run);
 void benchmark_print_summary(struct benchmark* bench);
+void benchmark_summarize(struct benchmark* bench, struct bench_summary* sum);
+
+/* Save results to a file, as CSV if its name ends with ".csv" and
+ * as JSON otherwise ( see benchmark_report.c ).
+ */
+int benchmark_save_report(struct benchmark* bench, const char* filename);
+
+/* Compare frame times against a JSON report saved earlier.
+ * Fails if frames got slower than the baseline by more than
+ * threshold percent with BENCH_BASELINE_CONFIDENCE.
+ */
+int benchmark_check_baseline(struct benchmark* bench, const char* filename,
+                             double threshold);
+
+/* Compare frame times of two JSON reports saved by --report and print
+ * whether the difference is significant with BENCH_CI_CONFIDENCE.
+ */
+int benchmark_compare_reports(const char* file_a, const char* file_b);
+
+#define BENCH_BASELINE_CONFIDENCE 0.95
+#define BENCH_CI_CONFIDENCE 0.95
+
+/* Warm-up goes on while the cpu frequency changes by more than this
+ * between frames, at most BENCH_WARMUP_MAX times the requested frames.
+ */
+#define BENCH_FREQ_SETTLE 0.01
+#define BENCH_WARMUP_MAX 4
+
+/* Warn if the cpu frequency drifts by more than this during a run */
+#define BENCH_FREQ_DRIFT 0.05
@@ -0,0 +1,725 @@
+#include "benchmark.h"
+#include "views.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <kernel/mdb_kernel_meta.h>
+#include <tools/cpu_features.h>
+#include <tools/compiler.h>
+#include <tools/timer.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+
+/* Machine-readable benchmark results.
+ *
+ * JSON keeps the whole run in one object with per-run frame times in
+ * "frame_ns", it's also the format --baseline reads back.
+ * CSV has a row per run with the configuration and summary repeated in
+ * every row, so reports of many builds can simply be concatenated.
+ */
+
+#define BENCH_REPORT_VERSION 5
+
+struct bench_info
+{
+        char kernel[64];
+        char version[32];
+        char cpu[64];
+        char features[256];
+};
+
+static
+void benchmark_query_info(struct benchmark* bench, struct bench_info* info)
+{
+        char maj[16] = {0}, min[16] = {0};
+
+        memset(info, 0, sizeof(*info));
+
+        mdb_kernel_metadata_query(bench->kernel, MDB_KERNEL_META_NAME,
+                                  info->kernel, sizeof(info->kernel));
+        mdb_kernel_metadata_query(bench->kernel, MDB_KERNEL_META_VER_MAJ,
+                                  maj, sizeof(maj));
+        mdb_kernel_metadata_query(bench->kernel, MDB_KERNEL_META_VER_MIN,
+                                  min, sizeof(min));
+
+        snprintf(info->version, sizeof(info->version), "%s.%s", maj, min);
+
+        cpu_model_name(info->cpu, sizeof(info->cpu));
+        cpu_features_to_str(cpu_supported_features(), info->features,
+                            sizeof(info->features));
+}
+
+static
+void json_put_str(FILE* f, const char* s)
+{
+        fputc('"', f);
+
+        for(; *s; ++s)
+        {
+                if(*s == '"' || *s == '\\')
+                        fputc('\\', f);
+
+                if((unsigned char)*s < 0x20)
+                        continue;
+
+                fputc(*s, f);
+        }
+
+        fputc('"', f);
+}
+
+/* Write a comma separated list as an array of strings */
+static
+void json_put_list(FILE* f, const char* s)
+{
+        const char* end;
+        char item[64];
+        size_t len;
+        bool first = true;
+
+        fputc('[', f);
+
+        while(*s)
+        {
+                end = strchr(s, ',');
+                end = end ? end : s + strlen(s);
+                len = MIN((size_t)(end - s), sizeof(item) - 1);
+
+                memcpy(item, s, len);
+                item[len] = '\0';
+
+                if(!first)
+                        fputs(", ", f);
+
+                json_put_str(f, item);
+                first = false;
+
+                s = *end ? end + 1 : end;
+        }
+
+        fputc(']', f);
+}
+
+static
+void json_put_percentiles(FILE* f, const struct bench_percentiles* pct)
+{
+        fprintf(f, "\"p50_ns\": %" PRIu64 ", \"p90_ns\": %" PRIu64 ", "
+                "\"p99_ns\": %" PRIu64 ", \"p999_ns\": %" PRIu64,
+                pct->p50, pct->p90, pct->p99, pct->p999);
+}
+
+static
+void benchmark_write_json(FILE* f, struct benchmark* bench,
+                          const struct bench_info* info,
+                          const struct bench_summary* sum)
+{
+        const struct sample_stats* st = &sum->frame;
+        uint32_t i;
+
+        fprintf(f, "{\n");
+        fprintf(f, "  \"version\": %d,\n", BENCH_REPORT_VERSION);
+
+        fprintf(f, "  \"kernel\": { \"name\": ");
+        json_put_str(f, info->kernel);
+        fprintf(f, ", \"version\": ");
+        json_put_str(f, info->version);
+        fprintf(f, " },\n");
+
+        fprintf(f, "  \"cpu\": { \"model\": ");
+        json_put_str(f, info->cpu);
+        fprintf(f, ", \"features\": ");
+        json_put_list(f, info->features);
+        fprintf(f, " },\n");
+
+        fprintf(f, "  \"threads\": %u,\n", bench->n_threads);
+        fprintf(f, "  \"grain\": [%u, %u],\n",
+                bench->sched->grain.x, bench->sched->grain.y);
+        fprintf(f, "  \"width\": %u,\n", bench->sched->width);
+        fprintf(f, "  \"height\": %u,\n", bench->sched->height);
+        fprintf(f, "  \"bailout\": %u,\n", bench->bailout);
+        fprintf(f, "  \"view\": ");
+        json_put_str(f, bench->view ? bench->view->name : "default");
+        fprintf(f, ",\n");
+        fprintf(f, "  \"timer\": ");
+        json_put_str(f, perf_clock_name());
+        fprintf(f, ",\n");
+
+        fprintf(f, "  \"runs\": %u,\n", bench->runs);
+        fprintf(f, "  \"warmup\": %u,\n", bench->warmup_done);
+        fprintf(f, "  \"batches\": %u,\n", bench->batches);
+        fprintf(f, "  \"cpu_freq_khz\": [%u, %u],\n",
+                bench->freq_min, bench->freq_max);
+        fprintf(f, "  \"total_sec\": %f,\n", bench->total_exec_time);
+        fprintf(f, "  \"fps\": %f,\n",
+                (double)bench->runs / bench->total_exec_time);
+        fprintf(f, "  \"iterations\": %" PRIu64 ",\n", sum->iters);
+        fprintf(f, "  \"giga_iters_per_sec\": %f,\n", sum->giga_iters);
+        fprintf(f, "  \"iter_ns\": %f,\n", sum->iter_ns);
+        fprintf(f, "  \"iters_per_cycle\": %f,\n", sum->iter_cycles);
+
+        fprintf(f, "  \"frame\": { \"avg_ns\": %.0f, \"min_ns\": %.0f, "
+                "\"max_ns\": %.0f, \"stddev_ns\": %.0f, "
+                "\"jitter_ns\": %.0f, ",
+                st->mean, st->min, st->max, st->stddev, st->jitter);
+        json_put_percentiles(f, &sum->frame_pct);
+        fprintf(f, " },\n");
+
+        fprintf(f, "  \"block\": { \"count\": %" PRIu64 ", "
+                "\"avg_ns\": %" PRIu64 ", \"min_ns\": %" PRIu64 ", "
+                "\"max_ns\": %" PRIu64 ", ",
+                sum->blocks, sum->block_total / MAX(sum->blocks, 1),
+                sum->block_min, sum->block_max);
+        json_put_percentiles(f, &sum->block_pct);
+        fprintf(f, " },\n");
+
+        fprintf(f, "  \"batch_ns\": [");
+
+        for(i = 0; i < bench->batches; ++i)
+                fprintf(f, "%s%" PRIu64, i ? ", " : "", bench->batch_time[i]);
+
+        fprintf(f, "],\n");
+
+        fprintf(f, "  \"frame_ns\": [");
+
+        for(i = 0; i < bench->runs; ++i)
+                fprintf(f, "%s%" PRIu64, i ? ", " : "", bench->frame_time[i]);
+
+        fprintf(f, "]\n}\n");
+}
+
+static
+void benchmark_write_csv(FILE* f, struct benchmark* bench,
+                         const struct bench_info* info,
+                         const struct bench_summary* sum)
+{
+        const struct sample_stats* st = &sum->frame;
+        const struct bench_percentiles* fp = &sum->frame_pct;
+        const struct bench_percentiles* bp = &sum->block_pct;
+        uint32_t i;
+
+        fprintf(f, "kernel,version,cpu,features,threads,grain_x,grain_y,"
+                "width,height,bailout,view,timer,runs,warmup,batches,"
+                "freq_min_khz,freq_max_khz,fps,iterations,"
+                "giga_iters_per_sec,iter_ns,iters_per_cycle,"
+                "frame_avg_ns,frame_min_ns,frame_max_ns,frame_stddev_ns,"
+                "frame_jitter_ns,frame_p50_ns,frame_p90_ns,frame_p99_ns,"
+                "frame_p999_ns,blocks,block_avg_ns,block_p50_ns,"
+                "block_p90_ns,block_p99_ns,block_p999_ns,"
+                "batch,run,frame_ns\n");
+
+        for(i = 0; i < bench->runs; ++i)
+        {
+                fprintf(f, "\"%s\",\"%s\",\"%s\",\"%s\",%u,%u,%u,%u,%u,%u,"
+                        "%s,%s,%u,%u,%u,%u,%u,%f,",
+                        info->kernel, info->version, info->cpu,
+                        info->features, bench->n_threads,
+                        bench->sched->grain.x, bench->sched->grain.y,
+                        bench->sched->width, bench->sched->height,
+                        bench->bailout,
+                        bench->view ? bench->view->name : "default",
+                        perf_clock_name(), bench->runs, bench->warmup_done,
+                        bench->batches, bench->freq_min, bench->freq_max,
+                        (double)bench->runs / bench->total_exec_time);
+
+                fprintf(f, "%" PRIu64 ",%f,%f,%f,", sum->iters,
+                        sum->giga_iters, sum->iter_ns, sum->iter_cycles);
+
+                fprintf(f, "%.0f,%.0f,%.0f,%.0f,%.0f,"
+                        "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+                        st->mean, st->min, st->max, st->stddev, st->jitter,
+                        fp->p50, fp->p90, fp->p99, fp->p999);
+
+                fprintf(f, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                        ",%" PRIu64 ",%" PRIu64 ",",
+                        sum->blocks, sum->block_total / MAX(sum->blocks, 1),
+                        bp->p50, bp->p90, bp->p99, bp->p999);
+
+                fprintf(f, "%u,%u,%" PRIu64 "\n",
+                        i / (bench->runs / bench->batches), i,
+                        bench->frame_time[i]);
+        }
+}
+
+static
+bool is_csv_file(const char* filename)
+{
+        size_t len = strlen(filename);
+
+        return len >= 4 && strcmp(filename + len - 4, ".csv") == 0;
+}
+
+int benchmark_save_report(struct benchmark* bench, const char* filename)
+{
+        struct bench_info info;
+        struct bench_summary sum;
+        FILE* f;
+
+        f = fopen(filename, "w");
+        if(!f)
+        {
+                LOG_ERROR("Failed to open '%s' for writing: %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        benchmark_query_info(bench, &info);
+        benchmark_summarize(bench, &sum);
+
+        if(is_csv_file(filename))
+                benchmark_write_csv(f, bench, &info, &sum);
+        else
+                benchmark_write_json(f, bench, &info, &sum);
+
+        if(fclose(f))
+        {
+                LOG_ERROR("Failed to write '%s': %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+char* read_file(const char* filename)
+{
+        FILE* f;
+        char* data;
+        long size;
+
+        f = fopen(filename, "r");
+        if(!f)
+        {
+                LOG_ERROR("Failed to open '%s': %s",
+                          filename, strerror(errno));
+                return NULL;
+        }
+
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        data = malloc((size_t)size + 1);
+
+        if(size < 0 || fread(data, 1, (size_t)size, f) != (size_t)size)
+        {
+                LOG_ERROR("Failed to read '%s'", filename);
+                free(data);
+                fclose(f);
+                return NULL;
+        }
+
+        data[size] = '\0';
+        fclose(f);
+
+        return data;
+}
+
+/* Not a general JSON parser, it only locates "key": in a report
+ * written by benchmark_write_json and returns a pointer past it.
+ */
+static
+char* json_find_key(char* data, const char* key)
+{
+        char pattern[64];
+        char* p;
+
+        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+        p = strstr(data, pattern);
+        if(!p)
+                return NULL;
+
+        p += strlen(pattern);
+
+        while(*p == ' ')
+                ++p;
+
+        return p;
+}
+
+/* Parse an array of integers, returns count of values or 0 */
+static
+size_t json_parse_u64_array(char* data, const char* key, uint64_t** pframes)
+{
+        uint64_t* frames = NULL;
+        size_t n = 0, cap = 0;
+        char* p;
+        char* end;
+        uint64_t v;
+
+        *pframes = NULL;
+
+        p = json_find_key(data, key);
+        if(!p || *p != '[')
+                return 0;
+
+        ++p;
+
+        for(;;)
+        {
+                while(*p == ' ' || *p == ',' || *p == '\n')
+                        ++p;
+
+                if(*p == ']')
+                        break;
+
+                errno = 0;
+                v = strtoull(p, &end, 10);
+
+                if(end == p || errno)
+                {
+                        free(frames);
+                        return 0;
+                }
+
+                if(n == cap)
+                {
+                        cap = cap ? cap * 2 : 128;
+                        frames = realloc(frames, cap * sizeof(*frames));
+                }
+
+                frames[n++] = v;
+                p = end;
+        }
+
+        *pframes = frames;
+        return n;
+}
+
+/* Copy the string value of "key" to buff */
+static
+void json_parse_str(char* data, const char* key, char* buff, size_t size)
+{
+        char* p = json_find_key(data, key);
+        size_t i = 0;
+
+        buff[0] = '\0';
+
+        if(!p || *p != '"')
+                return;
+
+        for(++p; *p && *p != '"' && i + 1 < size; ++p)
+        {
+                if(*p == '\\' && p[1])
+                        ++p;
+
+                buff[i++] = *p;
+        }
+
+        buff[i] = '\0';
+}
+
+/* Parse a non negative integer, -1 if there is none */
+static
+int64_t json_parse_int(char* data, const char* key)
+{
+        char* p = json_find_key(data, key);
+        char* end;
+        long long v;
+
+        if(!p)
+                return -1;
+
+        errno = 0;
+        v = strtoll(p, &end, 10);
+
+        if(end == p || errno || v < 0)
+                return -1;
+
+        return v;
+}
+
+/* struct report_config - run configuration of a saved report, numbers
+ * are -1 and strings empty for fields missing in older reports.
+ */
+struct report_config
+{
+        int64_t threads;
+        int64_t grain_x, grain_y;
+        int64_t width, height;
+        int64_t bailout;
+        char view[64];
+        char timer[16];
+};
+
+static
+void report_config_parse(char* data, struct report_config* rc)
+{
+        uint64_t* grain;
+
+        rc->threads = json_parse_int(data, "threads");
+        rc->width = json_parse_int(data, "width");
+        rc->height = json_parse_int(data, "height");
+        rc->bailout = json_parse_int(data, "bailout");
+
+        rc->grain_x = rc->grain_y = -1;
+
+        if(json_parse_u64_array(data, "grain", &grain) == 2)
+        {
+                rc->grain_x = (int64_t)grain[0];
+                rc->grain_y = (int64_t)grain[1];
+        }
+
+        free(grain);
+
+        json_parse_str(data, "view", rc->view, sizeof(rc->view));
+        json_parse_str(data, "timer", rc->timer, sizeof(rc->timer));
+}
+
+static
+bool report_config_check(const char* name, int64_t base, uint32_t cur)
+{
+        if(base < 0 || base == (int64_t)cur)
+                return true;
+
+        LOG_ERROR("Baseline %s is %" PRId64 ", the current run has %u.",
+                  name, base, cur);
+
+        return false;
+}
+
+static
+bool report_config_check_str(const char* name, const char* base,
+                             const char* cur)
+{
+        if(!base[0] || strcmp(base, cur) == 0)
+                return true;
+
+        LOG_ERROR("Baseline %s is '%s', the current run has '%s'.",
+                  name, base, cur);
+
+        return false;
+}
+
+/* A baseline of another configuration measures something else,
+ * every mismatch is reported.
+ */
+static
+bool report_config_match(const struct report_config* rc,
+                         struct benchmark* bench)
+{
+        bool match = true;
+
+        match &= report_config_check("threads", rc->threads,
+                                     bench->n_threads);
+        match &= report_config_check("grain x", rc->grain_x,
+                                     bench->sched->grain.x);
+        match &= report_config_check("grain y", rc->grain_y,
+                                     bench->sched->grain.y);
+        match &= report_config_check("width", rc->width,
+                                     bench->sched->width);
+        match &= report_config_check("height", rc->height,
+                                     bench->sched->height);
+
+        if(bench->bailout)
+                match &= report_config_check("bailout", rc->bailout,
+                                             bench->bailout);
+
+        match &= report_config_check_str("view", rc->view,
+                                         bench->view ? bench->view->name
+                                                     : "default");
+        match &= report_config_check_str("timer", rc->timer,
+                                         perf_clock_name());
+
+        return match;
+}
+
+/* struct report_samples - frame times of a saved report.
+ *
+ * Successive frames are correlated, so means of batches are the better
+ * samples for a comparison if there are at least two of them.
+ */
+struct report_samples
+{
+        char kernel[64];
+        struct report_config config;
+
+        uint64_t* frames;
+        size_t n_frames;
+
+        uint64_t* batches;
+        size_t n_batches;
+};
+
+static
+int report_samples_load(const char* filename, struct report_samples* rs)
+{
+        char* data;
+
+        memset(rs, 0, sizeof(*rs));
+
+        data = read_file(filename);
+        if(!data)
+                return MDB_FAIL;
+
+        json_parse_str(data, "name", rs->kernel, sizeof(rs->kernel));
+        report_config_parse(data, &rs->config);
+        rs->n_frames = json_parse_u64_array(data, "frame_ns", &rs->frames);
+        rs->n_batches = json_parse_u64_array(data, "batch_ns", &rs->batches);
+
+        free(data);
+
+        if(rs->n_frames < 2)
+        {
+                LOG_ERROR("Report '%s' has no frame times to compare.",
+                          filename);
+                return MDB_FAIL;
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+void report_samples_free(struct report_samples* rs)
+{
+        free(rs->frames);
+        free(rs->batches);
+}
+
+static
+void report_samples_stats(struct report_samples* rs, bool batches,
+                          struct sample_stats* st)
+{
+        if(batches)
+                sample_stats_compute(rs->batches, rs->n_batches, st);
+        else
+                sample_stats_compute(rs->frames, rs->n_frames, st);
+}
+
+int benchmark_check_baseline(struct benchmark* bench, const char* filename,
+                             double threshold)
+{
+        struct bench_info info;
+        struct report_samples rs;
+        struct sample_stats cur, base;
+        double scale, change, p;
+        bool batches;
+
+        if(report_samples_load(filename, &rs) != MDB_SUCCESS)
+        {
+                report_samples_free(&rs);
+                return MDB_FAIL;
+        }
+
+        benchmark_query_info(bench, &info);
+
+        if(strcmp(rs.kernel, info.kernel) != 0)
+                LOG_WARN("Baseline was measured with kernel '%s', "
+                         "comparing with '%s'.", rs.kernel, info.kernel);
+
+        if(!report_config_match(&rs.config, bench))
+        {
+                LOG_ERROR("Baseline '%s' was measured with another "
+                          "configuration, refusing to compare.", filename);
+                report_samples_free(&rs);
+                return MDB_FAIL;
+        }
+
+        /* Same samples as --compare-reports, frame times only if
+         * either side has a single batch.
+         */
+        batches = rs.n_batches >= 2 && bench->batches >= 2;
+
+        report_samples_stats(&rs, batches, &base);
+
+        if(batches)
+                sample_stats_compute(bench->batch_time, bench->batches, &cur);
+        else
+                sample_stats_compute(bench->frame_time, bench->runs, &cur);
+
+        report_samples_free(&rs);
+
+        if(!batches)
+                LOG_WARN("Comparing correlated frame times, the p-value is "
+                         "optimistic. Record both runs with --batches=2 "
+                         "or more.");
+
+        /* Throughput is inverse to the frame time, a regression beyond
+         * the threshold means frames slower than base / (1 - threshold).
+         */
+        scale = 1.0 / (1.0 - threshold / 100.0);
+        p = sample_welch_greater(&cur, &base, scale);
+        change = (base.mean / cur.mean - 1.0) * 100.0;
+
+        LOG_SAY("== Baseline comparison ==");
+        PARAM_INFO("Baseline", "%s", filename);
+        PARAM_INFO("Samples", "%s", batches ? "batch means" : "frame times");
+        PARAM_INFO("Baseline frame avg", "%f ms (%zu samples)",
+                   base.mean / 1e6, base.n);
+        PARAM_INFO("Current frame avg", "%f ms (%zu samples)",
+                   cur.mean / 1e6, cur.n);
+        PARAM_INFO("Throughput change", "%+.2f %%", change);
+        PARAM_INFO("Regression threshold", "%.2f %%", threshold);
+        PARAM_INFO("p-value", "%g", p);
+
+        if(p < 1.0 - BENCH_BASELINE_CONFIDENCE)
+        {
+                LOG_ERROR("Throughput regressed by more than %.2f %% "
+                          "with %.0f %% confidence.", threshold,
+                          BENCH_BASELINE_CONFIDENCE * 100.0);
+                return MDB_FAIL;
+        }
+
+        LOG_SAY("No significant regression against the baseline.");
+
+        return MDB_SUCCESS;
+}
+
+int benchmark_compare_reports(const char* file_a, const char* file_b)
+{
+        struct report_samples a, b;
+        struct sample_stats sa, sb;
+        double p, ci, change;
+        bool batches;
+
+        memset(&b, 0, sizeof(b));
+
+        if(report_samples_load(file_a, &a) != MDB_SUCCESS
+           || report_samples_load(file_b, &b) != MDB_SUCCESS)
+        {
+                report_samples_free(&a);
+                report_samples_free(&b);
+                return MDB_FAIL;
+        }
+
+        batches = a.n_batches >= 2 && b.n_batches >= 2;
+
+        report_samples_stats(&a, batches, &sa);
+        report_samples_stats(&b, batches, &sb);
+
+        p = sample_welch_diff(&sb, &sa, BENCH_CI_CONFIDENCE, &ci);
+        change = (sb.mean / sa.mean - 1.0) * 100.0;
+
+        LOG_SAY("== Report comparison ==");
+        PARAM_INFO("A", "%s (%s)", file_a, a.kernel);
+        PARAM_INFO("B", "%s (%s)", file_b, b.kernel);
+        PARAM_INFO("Samples", "%s", batches ? "batch means" : "frame times");
+        PARAM_INFO("A frame avg", "%f ms +- %f ms (%zu samples)",
+                   sa.mean / 1e6,
+                   sample_mean_ci(&sa, BENCH_CI_CONFIDENCE) / 1e6, sa.n);
+        PARAM_INFO("B frame avg", "%f ms +- %f ms (%zu samples)",
+                   sb.mean / 1e6,
+                   sample_mean_ci(&sb, BENCH_CI_CONFIDENCE) / 1e6, sb.n);
+        PARAM_INFO("Frame time change", "%+.2f %% +- %.2f %% (%.0f %% CI)",
+                   change, ci / sa.mean * 100.0,
+                   BENCH_CI_CONFIDENCE * 100.0);
+        PARAM_INFO("Speedup of B", "%.3fx", sa.mean / sb.mean);
+        PARAM_INFO("p-value", "%g", p);
+
+        if(p < 1.0 - BENCH_CI_CONFIDENCE)
+                LOG_SAY("B is significantly %s than A with %.0f %% "
+                        "confidence.", change < 0 ? "faster" : "slower",
+                        BENCH_CI_CONFIDENCE * 100.0);
+        else
+                LOG_SAY("No significant difference with %.0f %% "
+                        "confidence.", BENCH_CI_CONFIDENCE * 100.0);
+
+        report_samples_free(&a);
+        report_samples_free(&b);
+
+        return MDB_SUCCESS;
+}
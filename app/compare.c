@@ -0,0 +1,246 @@
+#include "compare.h"
+
+#include <string.h>
+#include <math.h>
+#include <app/benchmark.h>
+#include <app/views.h>
+#include <kernel/mdb_kernel.h>
+#include <surface/surface.h>
+#include <tools/nproc.h>
+#include <tools/stats.h>
+#include <tools/timer.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+#include <tools/compiler.h>
+
+/* Frames of A and B run in ABBA order, so both kernels see the same
+ * thermal and frequency state on average and a linear drift cancels
+ * out. Frames of the same index form a pair, the speedup is the
+ * geometric mean of the pair ratios A / B with a Student's t interval
+ * of the mean of their logarithms.
+ */
+
+struct compare
+{
+        struct arguments* args;
+
+        struct surface* surf;
+        struct rsched* sched;
+
+        struct mdb_kernel* kernel[2];
+        struct benchmark* bench[2];
+};
+
+static
+int compare_load_kernels(struct compare* cmp)
+{
+        struct arguments* args = cmp->args;
+        uint32_t i;
+
+        for(i = 0; i < 2; ++i)
+        {
+                if(mdb_kernel_create(&cmp->kernel[i], args->compare[i])
+                   != MDB_SUCCESS)
+                {
+                        LOG_ERROR("Cannot create the kernel '%s'",
+                                  args->compare[i]);
+                        return MDB_FAIL;
+                }
+
+                mdb_kernel_set_size(cmp->kernel[i], args->width,
+                                    args->height);
+                mdb_kernel_set_surface(cmp->kernel[i], cmp->surf);
+
+                if(mdb_kernel_set_bailout(cmp->kernel[i], args->bailout)
+                   != MDB_SUCCESS)
+                        LOG_WARN("Kernel '%s' doesn't accept bailout "
+                                 "changes.", args->compare[i]);
+
+                if(args->precision >= 0
+                   && mdb_kernel_set_precision(cmp->kernel[i],
+                                               args->precision)
+                      != MDB_SUCCESS)
+                        LOG_WARN("Kernel '%s' doesn't support the "
+                                 "precision.", args->compare[i]);
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+void compare_unload_kernels(struct compare* cmp)
+{
+        uint32_t i;
+
+        for(i = 0; i < 2; ++i)
+        {
+                if(cmp->bench[i])
+                        benchmark_destroy(cmp->bench[i]);
+
+                if(cmp->kernel[i])
+                        mdb_kernel_destroy(cmp->kernel[i]);
+        }
+}
+
+static
+void compare_interleave(struct compare* cmp)
+{
+        uint32_t runs = cmp->bench[0]->runs;
+        uint32_t first;
+        uint32_t i;
+
+        benchmark_run_warmup(cmp->bench[0]);
+        benchmark_run_warmup(cmp->bench[1]);
+
+        for(i = 0; i < runs; ++i)
+        {
+                first = i & 1;
+
+                benchmark_run_frame(cmp->bench[first], i);
+                benchmark_run_frame(cmp->bench[!first], i);
+        }
+}
+
+static
+void compare_print_kernel(const char* label, const char* name,
+                          struct benchmark* bench)
+{
+        struct bench_summary sum;
+
+        benchmark_summarize(bench, &sum);
+
+        LOG_SAY("%-2s %-16s %9.3f %9.3f %9.3f %9.3f %9.3f", label, name,
+                (double)bench->runs / bench->total_exec_time,
+                sum.frame.mean / 1e6,
+                sample_mean_ci(&sum.frame, BENCH_CI_CONFIDENCE) / 1e6,
+                ns_to_ms(sum.frame_pct.p50), ns_to_ms(sum.frame_pct.p99));
+}
+
+static
+void compare_print_speedup(struct compare* cmp)
+{
+        const uint64_t* a = cmp->bench[0]->frame_time;
+        const uint64_t* b = cmp->bench[1]->frame_time;
+        uint32_t n = cmp->bench[0]->runs;
+        double mean = 0, sq = 0, se = 0, h = 0, p = 1.0;
+        double d;
+        uint32_t i;
+
+        for(i = 0; i < n; ++i)
+                mean += log((double)a[i] / MAX(b[i], 1));
+
+        mean /= n;
+
+        for(i = 0; i < n; ++i)
+        {
+                d = log((double)a[i] / MAX(b[i], 1)) - mean;
+                sq += d * d;
+        }
+
+        if(n > 1)
+        {
+                se = sqrt(sq / (n - 1) / n);
+                h = student_t_isf((1.0 - BENCH_CI_CONFIDENCE) / 2.0, n - 1)
+                    * se;
+                p = se > 0 ? 2.0 * student_t_sf(fabs(mean) / se, n - 1)
+                           : (mean != 0 ? 0.0 : 1.0);
+        }
+
+        PARAM_INFO("Speedup of B", "%.4fx [%.4fx, %.4fx] (%.0f %% CI)",
+                   exp(mean), exp(mean - h), exp(mean + h),
+                   BENCH_CI_CONFIDENCE * 100.0);
+        PARAM_INFO("Frame pairs", "%u", n);
+        PARAM_INFO("p-value", "%g", p);
+
+        if(p < 1.0 - BENCH_CI_CONFIDENCE)
+                LOG_SAY("B is significantly %s than A with %.0f %% "
+                        "confidence.", mean > 0 ? "faster" : "slower",
+                        BENCH_CI_CONFIDENCE * 100.0);
+        else
+                LOG_SAY("No significant difference with %.0f %% "
+                        "confidence.", BENCH_CI_CONFIDENCE * 100.0);
+}
+
+static
+void compare_print(struct compare* cmp)
+{
+        struct arguments* args = cmp->args;
+
+        LOG_SAY("== Interleaved comparison ==");
+        LOG_SAY("%-2s %-16s %9s %9s %9s %9s %9s", "", "kernel", "fps",
+                "avg ms", "+- ms", "p50 ms", "p99 ms");
+
+        compare_print_kernel("A", args->compare[0], cmp->bench[0]);
+        compare_print_kernel("B", args->compare[1], cmp->bench[1]);
+
+        compare_print_speedup(cmp);
+}
+
+int compare_run(struct arguments* args, struct rsched_options* opts)
+{
+        struct compare cmp;
+        struct block_size grain;
+        const struct view* view = NULL;
+        uint32_t i;
+        int ret;
+
+        memset(&cmp, 0, sizeof(cmp));
+
+        cmp.args = args;
+
+        if(args->view_name)
+                view = view_find(args->view_name);
+
+        ret = surface_create(&cmp.surf, args->width, args->height,
+                             SURFACE_BUFFER_CREATE | SURFACE_BUFFER_F32);
+        if(ret != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create surface.");
+                return ret;
+        }
+
+        ret = compare_load_kernels(&cmp);
+        if(ret != MDB_SUCCESS)
+                goto exit;
+
+        opts->threads = args->threads <= -1 ? (uint32_t)nproc_active()
+                                            : (uint32_t)args->threads;
+
+        ret = rsched_create(&cmp.sched, opts);
+        if(ret != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create the scheduler.");
+                goto exit;
+        }
+
+        rsched_tune_thread_affinity(cmp.sched);
+
+        grain.x = args->block_size_x;
+        grain.y = args->block_size_y;
+
+        rsched_create_tasks(cmp.sched, args->width, args->height, &grain);
+
+        for(i = 0; i < 2; ++i)
+        {
+                benchmark_create(&cmp.bench[i],
+                                 (uint32_t)args->benchmark_runs,
+                                 cmp.kernel[i], cmp.sched, false);
+                benchmark_set_batches(cmp.bench[i], (uint32_t)args->warmup,
+                                      1);
+                benchmark_set_view(cmp.bench[i], view);
+        }
+
+        LOG_SAY("Comparing '%s' with '%s' over %d interleaved frames...",
+                args->compare[0], args->compare[1], args->benchmark_runs);
+
+        compare_interleave(&cmp);
+        compare_print(&cmp);
+
+        rsched_shutdown(cmp.sched);
+
+exit:
+        compare_unload_kernels(&cmp);
+        surface_destroy(cmp.surf);
+
+        return ret;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <tools/args_parser.h>
+#include <sched/rsched.h>
+
+/* Benchmark the two kernels of args->compare in one process, alternating
+ * frames between them on the same scheduler and surface, and report the
+ * relative speedup of the second one with a confidence interval.
+ * opts are the scheduler options.
+ */
+int compare_run(struct arguments* args, struct rsched_options* opts);
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <signal.h>
 
 
 #include <tools/args_parser.h>
@@ -8,6 +9,10 @@
 #include <string.h>
 #include <app/benchmark.h>
 #include <app/render.h>
+#include <app/sweep.h>
+#include <app/compare.h>
+#include <app/replay.h>
+#include <app/views.h>
 #include <surface/surface.h>
 #include <tools/log.h>
 
@@ -17,6 +22,8 @@
 #include <tools/error_codes.h>
 #include <tools/timer.h>
 #include <tools/nproc.h>
+#include <tools/metrics_server.h>
+#include <sched/rsched_metrics.h>
 
 static inline
 const char* mode_str(int mode)
@@ -29,6 +36,8 @@ const char* mode_str(int mode)
                 return "benchmark";
         case MODE_RENDER:
                 return "render";
+        case MODE_REPLAY:
+                return "replay";
 
         default:
                 return "unknown";
@@ -68,6 +77,70 @@ void print_input_params(struct arguments* args)
         PARAM_INFO("Width", "%i", args->width);
         PARAM_INFO("Height", "%i", args->height);
         PARAM_INFO("Bailout", "%i", args->bailout);
+        if(args->precision >= 0)
+                PARAM_INFO("Precision", "%s",
+                           args->precision == MDB_PRECISION_AUTO ? "auto"
+                           : args->precision == MDB_PRECISION_FLOAT ? "float"
+                           : "double");
+        PARAM_INFO("View", "%s", args->view_name ? args->view_name
+                                                 : "default");
+        PARAM_INFO("Timer", "%s", perf_clock_name());
+}
+
+/* Startup phases of a oneshot or benchmark run, shown in verbose mode */
+enum
+{
+        STARTUP_SCHED,
+        STARTUP_AFFINITY,
+        STARTUP_KERNEL,
+        STARTUP_TASKS,
+        STARTUP_SURFACE,
+        STARTUP_FIRST_FRAME,
+        STARTUP_PHASES
+};
+
+static const char* const startup_phase_name[STARTUP_PHASES] = {
+        "Scheduler create",
+        "Thread affinity",
+        "Kernel load",
+        "Task split",
+        "Surface create",
+        "First frame"
+};
+
+static struct
+{
+        uint64_t last;
+        uint64_t ns[STARTUP_PHASES];
+} startup;
+
+/* Time since the previous lap in ns */
+static
+uint64_t startup_lap(void)
+{
+        uint64_t now = perf_ticks();
+        uint64_t ns = perf_ticks_to_ns(now - startup.last);
+
+        startup.last = now;
+
+        return ns;
+}
+
+static
+void print_startup(void)
+{
+        uint64_t total = 0;
+        uint32_t i;
+
+        for(i = 0; i < STARTUP_PHASES; ++i)
+        {
+                LOG_VINFO(LOG_VERBOSE1, "Startup %-16s: %f ms",
+                          startup_phase_name[i], ns_to_ms(startup.ns[i]));
+                total += startup.ns[i];
+        }
+
+        LOG_VINFO(LOG_VERBOSE1, "Startup %-16s: %f ms", "total",
+                  ns_to_ms(total));
 }
 
 static
@@ -77,10 +150,18 @@ int run_benchmark_mode(struct mdb_kernel* kernel,
         struct surface* surf;
         struct benchmark* bench;
         uint32_t runs;
+        int flags;
         int ret;
 
-        ret = surface_create(&surf, args->width, args->height,
-                             SURFACE_BUFFER_CREATE | SURFACE_BUFFER_F32);
+        flags = SURFACE_BUFFER_CREATE | SURFACE_BUFFER_F32;
+
+        /* Every pixel is written by the kernel before it's saved, the
+         * vector kernels render the last column of the surface too.
+         */
+        if(args->fast_start)
+                flags |= SURFACE_BUFFER_UNINIT;
+
+        ret = surface_create(&surf, args->width, args->height, flags);
 
         if(ret != MDB_SUCCESS)
         {
@@ -88,6 +169,8 @@ int run_benchmark_mode(struct mdb_kernel* kernel,
                 return ret;
         }
 
+        startup.ns[STARTUP_SURFACE] = startup_lap();
+
         mdb_kernel_set_size(kernel, args->width, args->height);
         mdb_kernel_set_surface(kernel, surf);
 
@@ -95,15 +178,46 @@ int run_benchmark_mode(struct mdb_kernel* kernel,
         benchmark_create(&bench,
                          runs,
                          kernel,
-                         sched);
+                         sched,
+                         args->lane_stats);
+
+        bench->bailout = (uint32_t)args->bailout;
 
         if(args->mode == MODE_BENCHMARK)
+        {
+                benchmark_set_batches(bench, (uint32_t)args->warmup,
+                                      (uint32_t)args->batches);
+
+                if(args->view_name)
+                        benchmark_set_view(bench,
+                                           view_find(args->view_name));
+
                 LOG_SAY("Running benchmark...");
+        }
 
         benchmark_run(bench);
 
+        startup.ns[STARTUP_FIRST_FRAME] = bench->first_frame;
+        print_startup();
+
         benchmark_print_summary(bench);
 
+        if(args->mode == MODE_BENCHMARK && args->report_file)
+        {
+                if(benchmark_save_report(bench, args->report_file)
+                   == MDB_SUCCESS)
+                        LOG_SAY("Benchmark report saved to '%s'",
+                                args->report_file);
+        }
+
+        if(args->mode == MODE_BENCHMARK && args->baseline_file)
+        {
+                if(benchmark_check_baseline(bench, args->baseline_file,
+                                            args->regression_threshold)
+                   != MDB_SUCCESS)
+                        ret = MDB_FAIL;
+        }
+
         if(args->mode == MODE_ONESHOT)
         {
                 errno = 0;
@@ -119,7 +233,7 @@ int run_benchmark_mode(struct mdb_kernel* kernel,
         benchmark_destroy(bench);
         surface_destroy(surf);
 
-        return MDB_SUCCESS;
+        return ret;
 }
 
 static
@@ -143,7 +257,8 @@ int run_render_mode(struct mdb_kernel* kernel, struct rsched* sched,
 
 
         ret = render_run(sched, kernel, surf, args->width, args->height,
-                         args->shader_colors? true : false);
+                         args->shader_colors? true : false,
+                         args->record_keys);
 
         if(ret != MDB_SUCCESS)
         {
@@ -155,6 +270,90 @@ int run_render_mode(struct mdb_kernel* kernel, struct rsched* sched,
         return ret;
 }
 
+static
+int save_heatmap(struct rsched* sched, struct arguments* args)
+{
+        struct rsched_cost_map map;
+        struct surface* surf;
+        double scale = 1.0;
+        bool per_pixel = false;
+        int ret;
+
+        if(rsched_get_costs(sched, &map) != MDB_SUCCESS)
+                return MDB_FAIL;
+
+        if(args->heatmap_unit == HEATMAP_CPP)
+        {
+                if(__perf_clock.source == PERF_CLOCK_TSC)
+                {
+                        scale = (double)__perf_clock.freq / NS_IN_SEC;
+                        per_pixel = true;
+                }
+                else
+                {
+                        LOG_WARN("Cycles per pixel require the tsc timer, "
+                                 "saving tile time instead.");
+                }
+        }
+
+        ret = surface_create(&surf, map.width, map.height,
+                             SURFACE_BUFFER_CREATE | SURFACE_BUFFER_F32);
+        if(ret != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create surface.");
+                rsched_costs_free(&map);
+                return ret;
+        }
+
+        rsched_costs_render(&map, surf->data, scale, per_pixel);
+
+        errno = 0;
+        ret = surface_save_image_hdr(surf, args->heatmap_file);
+        if(ret != MDB_SUCCESS)
+                LOG_ERROR("Failed to save heatmap to '%s', errno: %s",
+                          args->heatmap_file, strerror(errno));
+
+        surface_destroy(surf);
+        rsched_costs_free(&map);
+
+        return ret;
+}
+
+static
+int write_metrics(FILE* f, void* ctx)
+{
+        return rsched_write_metrics(ctx, f);
+}
+
+/* Scheduler toggled by SIGUSR1 */
+static struct rsched* profile_sched;
+
+static
+void profile_signal_handler(int sig)
+{
+        UNUSED_PARAM(sig);
+
+        if(profile_sched)
+                rsched_toggle_profiling(profile_sched);
+}
+
+static
+void install_profile_signal(struct rsched* sched)
+{
+        struct sigaction sa;
+
+        profile_sched = sched;
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = &profile_signal_handler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+
+        if(sigaction(SIGUSR1, &sa, NULL) != 0)
+                LOG_WARN("Cannot install SIGUSR1 handler: %s",
+                         strerror(errno));
+}
+
 static
 void configure_rsched_options(struct rsched_options* opts,
                               struct arguments* args)
@@ -164,8 +363,19 @@ void configure_rsched_options(struct rsched_options* opts,
         else
                 opts->threads = (uint32_t)args->threads;
 
+        opts->record_costs = args->rsched.cost_file != NULL
+                             || args->heatmap_file != NULL;
+        opts->pmu = args->rsched.pmu;
+        opts->lazy_start = args->fast_start;
+
+        if(args->rsched.trace_file)
+                opts->trace_size = optional_get(&args->rsched.trace_size,
+                                                1 << 16);
+
+        opts->profile.enabled =
+                optional_get(&args->rsched.profile,
+                             IS_ENABLED(CONFIG_RSCHED_PROFILE));
 
-#if defined(CONFIG_RSCHED_PROFILE)
         opts->profile.run_hist.show =
                 optional_get(&args->rsched.run_hist.show, true);
 
@@ -176,10 +386,10 @@ void configure_rsched_options(struct rsched_options* opts,
                 optional_get(&args->rsched.run_hist.size, 8);
 
         opts->profile.run_hist.min =
-                optional_get(&args->rsched.run_hist.min, 1 * NS_IN_MS);
+                optional_get(&args->rsched.run_hist.min, 0);
 
         opts->profile.run_hist.max =
-                optional_get(&args->rsched.run_hist.max, 30 * NS_IN_MS);
+                optional_get(&args->rsched.run_hist.max, 0);
 
 
         opts->profile.task_hist.show =
@@ -192,16 +402,14 @@ void configure_rsched_options(struct rsched_options* opts,
                 optional_get(&args->rsched.task_hist.size, 16);
 
         opts->profile.task_hist.min =
-                optional_get(&args->rsched.task_hist.min, 20 * NS_IN_MCS);
+                optional_get(&args->rsched.task_hist.min, 0);
 
         opts->profile.task_hist.max =
-                optional_get(&args->rsched.task_hist.max, 143 * NS_IN_MCS);
+                optional_get(&args->rsched.task_hist.max, 0);
 
 
         memcpy(&opts->profile.payload_hist, &opts->profile.task_hist,
                sizeof(opts->profile.task_hist));
-
-#endif
 }
 
 int main(int argc, char** argv)
@@ -210,6 +418,7 @@ int main(int argc, char** argv)
 
         struct mdb_kernel* kernel;
         struct rsched* sched;
+        struct metrics_server* metrics = NULL;
         struct rsched_options rsched_opts = {0};
         struct block_size block_size;
 
@@ -225,27 +434,119 @@ int main(int argc, char** argv)
                  args.verbose,
                  NULL);
 
+        perf_clock_init(args.timer);
+
+        if(args.view_list)
+        {
+                views_print();
+                log_shutdown();
+                exit(EXIT_SUCCESS);
+        }
+
+        if(views_resolve(&args) != MDB_SUCCESS)
+        {
+                log_shutdown();
+                exit(EXIT_FAILURE);
+        }
+
+        if(args.compare_reports[0])
+        {
+                exit_failure =
+                        benchmark_compare_reports(args.compare_reports[0],
+                                                  args.compare_reports[1])
+                        != MDB_SUCCESS;
+
+                log_shutdown();
+                exit(exit_failure ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+
+        if(args.compare[0])
+        {
+                configure_rsched_options(&rsched_opts, &args);
+
+                exit_failure = compare_run(&args, &rsched_opts)
+                               != MDB_SUCCESS;
+
+                log_shutdown();
+                exit(exit_failure ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+
+        if(arg_sweep_size(&args.sweep) > 1 || args.scaling)
+        {
+                if(args.mode == MODE_BENCHMARK)
+                {
+                        configure_rsched_options(&rsched_opts, &args);
+
+                        exit_failure = sweep_run(&args, &rsched_opts)
+                                       != MDB_SUCCESS;
+
+                        log_shutdown();
+                        exit(exit_failure ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+
+                LOG_WARN("Option lists are swept only in benchmark mode, "
+                         "using the first values.");
+        }
+
+        configure_rsched_options(&rsched_opts, &args);
+
+        startup_lap();
+
+        /* With lazy start workers come up while the kernel is loaded */
+        if(rsched_create(&sched, &rsched_opts) != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create the scheduler");
+                log_shutdown();
+                exit(EXIT_FAILURE);
+        }
+
+        startup.ns[STARTUP_SCHED] = startup_lap();
+
+        rsched_tune_thread_affinity(sched);
+
+        startup.ns[STARTUP_AFFINITY] = startup_lap();
 
         if(mdb_kernel_create(&kernel, args.kernel_name) != MDB_SUCCESS)
         {
                 LOG_ERROR("Cannot create the kernel");
+                rsched_shutdown(sched);
                 log_shutdown();
                 exit(EXIT_FAILURE);
         }
 
+        startup.ns[STARTUP_KERNEL] = startup_lap();
 
         print_input_params(&args);
 
+        if(mdb_kernel_set_bailout(kernel, args.bailout) != MDB_SUCCESS)
+                LOG_WARN("The kernel doesn't accept bailout changes.");
+
+        if(args.precision >= 0
+           && mdb_kernel_set_precision(kernel, args.precision) != MDB_SUCCESS)
+                LOG_WARN("The kernel doesn't support the precision.");
+
+        if(args.view_name && view_apply(view_find(args.view_name), kernel,
+                                        0, 1) != MDB_SUCCESS)
+                LOG_WARN("The kernel doesn't accept view changes.");
+
         block_size.x = args.block_size_x;
         block_size.y = args.block_size_y;
 
-        configure_rsched_options(&rsched_opts, &args);
-
-        rsched_create(&sched, &rsched_opts);
-        rsched_tune_thread_affinity(sched);
         rsched_create_tasks(sched, (uint32_t) args.width, (uint32_t) args.height,
                             &block_size);
 
+        startup.ns[STARTUP_TASKS] = startup_lap();
+
+        install_profile_signal(sched);
+
+        if(args.metrics_addr)
+        {
+                if(metrics_server_start(&metrics, args.metrics_addr,
+                                        &write_metrics, sched)
+                   == MDB_SUCCESS)
+                        LOG_SAY("Serving metrics on '%s'", args.metrics_addr);
+        }
+
         switch(args.mode)
         {
         case MODE_BENCHMARK:
@@ -263,6 +564,13 @@ int main(int argc, char** argv)
                         goto shutdown;
                 }
                 break;
+        case MODE_REPLAY:
+                if(replay_run(sched, kernel, &args) != MDB_SUCCESS)
+                {
+                        exit_failure = true;
+                        goto shutdown;
+                }
+                break;
         default:
                 LOG_ERROR("Unknown run mode %i", args.mode);
                 exit_failure = true;
@@ -271,6 +579,37 @@ int main(int argc, char** argv)
 
 
 shutdown:
+        if(metrics)
+                metrics_server_stop(metrics);
+
+        if(args.rsched.cost_file)
+        {
+                if(rsched_save_costs(sched, args.rsched.cost_file)
+                   == MDB_SUCCESS)
+                        LOG_SAY("Tile costs saved to '%s'",
+                                args.rsched.cost_file);
+        }
+
+        if(args.heatmap_file)
+        {
+                if(save_heatmap(sched, &args) == MDB_SUCCESS)
+                        LOG_SAY("Heatmap saved to '%s'", args.heatmap_file);
+        }
+
+        if(args.rsched.trace_file)
+        {
+                if(rsched_save_trace(sched, args.rsched.trace_file)
+                   == MDB_SUCCESS)
+                        LOG_SAY("Scheduler trace saved to '%s'",
+                                args.rsched.trace_file);
+        }
+
+        if(args.rsched.pmu)
+                rsched_print_pmu_stats(sched);
+
+        signal(SIGUSR1, SIG_IGN);
+        profile_sched = NULL;
+
         rsched_print_stats(sched);
         rsched_shutdown(sched);
         mdb_kernel_destroy(kernel);
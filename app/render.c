@@ -8,6 +8,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 
 #include <sched/rsched.h>
@@ -16,6 +17,8 @@
 #include <tools/log.h>
 #include <kernel/mdb_kernel_event.h>
 #include <tools/error_codes.h>
+#include <tools/timer.h>
+#include <app/replay.h>
 
 
 static const char* control_keys_doc[] = {
@@ -35,6 +38,10 @@ struct render_ctx
         uint32_t width;
         uint32_t height;
         struct block_size grain;
+
+        /* Keyboard events are recorded here if not NULL */
+        FILE* record;
+        uint64_t record_start;
 };
 
 static inline
@@ -63,6 +70,12 @@ void render_key_callback(void* context, int key, int scancode,
                         .mods = mods
                 };
 
+        if(ctx->record)
+                replay_write_event(ctx->record,
+                                   perf_ticks_to_ns(perf_ticks()
+                                                    - ctx->record_start),
+                                   &event);
+
         mdb_kernel_event(ctx->kernel, MDB_EVENT_KEYBOARD, &event);
 }
 
@@ -131,7 +144,7 @@ void run_ogl_render(struct render_ctx* ctx, bool color_enabled)
 
 int render_run(struct rsched* sched, struct mdb_kernel* kernel,
                struct surface* surf, uint32_t width, uint32_t height,
-               bool color_enabled)
+               bool color_enabled, const char* record_file)
 {
         struct render_ctx ctx;
 
@@ -141,6 +154,17 @@ int render_run(struct rsched* sched, struct mdb_kernel* kernel,
         ctx.sched = sched;
         ctx.kernel = kernel;
         ctx.surf = surf;
+        ctx.record = NULL;
+
+        if(record_file)
+        {
+                ctx.record = fopen(record_file, "w");
+                if(!ctx.record)
+                        LOG_ERROR("Failed to open '%s' for writing: %s",
+                                  record_file, strerror(errno));
+
+                ctx.record_start = perf_ticks();
+        }
 
         rsched_set_user_context(sched, &render_kernel_proc_fun, &ctx);
 
@@ -151,10 +175,19 @@ int render_run(struct rsched* sched, struct mdb_kernel* kernel,
 #if defined(CONFIG_OGL_RENDER)
         run_ogl_render(&ctx, color_enabled);
 
+        if(ctx.record)
+        {
+                fclose(ctx.record);
+                LOG_SAY("Keyboard events saved to '%s'", record_file);
+        }
+
         return MDB_SUCCESS;
 #else
     UNUSED_PARAM(color_enabled);
 
+    if(ctx.record)
+            fclose(ctx.record);
+
     LOG_ERROR("OGL Render disabled at the build time.");
     return MDB_FAIL;
 #endif
@@ -5,6 +5,9 @@
 #include <kernel/mdb_kernel.h>
 #include <sched/rsched.h>
 
+/* record_file - save keyboard events as a replay script, see
+ * app/replay.h, NULL if disabled
+ */
 int render_run(struct rsched* sched, struct mdb_kernel* kernel,
                struct surface* surf, uint32_t width, uint32_t height,
-               bool color_enabled);
+               bool color_enabled, const char* record_file);
@@ -0,0 +1,552 @@
+#include "replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <surface/surface.h>
+#include <tools/stats.h>
+#include <tools/timer.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+#include <tools/compiler.h>
+
+/* Frames are paced by slots of 1 / fps like a vsynced render loop.
+ * A frame starts at the beginning of its slot after the events due
+ * by then are sent to the kernel. A frame that isn't complete by the
+ * end of its slot misses the deadline and the next frame waits for
+ * the slot following its completion, the slots in between are dropped.
+ * Event latency is the time from when an event is due by the script
+ * to the completion of the frame that shows it, so it includes the
+ * wait for a late frame. The session lasts until every event has
+ * been shown by a completed frame, so it's extended past the last
+ * event when frames are late.
+ */
+
+struct replay_event
+{
+        /* Time from the start of the session in ns */
+        uint64_t time;
+
+        /* Order in the script, keeps sorting stable */
+        uint32_t seq;
+
+        struct mdb_event_keyboard key;
+};
+
+struct replay
+{
+        struct rsched* sched;
+        struct mdb_kernel* kernel;
+
+        struct replay_event* ev;
+        uint32_t n_ev, cap_ev;
+
+        /* Slot length in ns */
+        uint64_t period;
+
+        /* Session start in perf ticks */
+        uint64_t t0;
+
+        /* Time of every rendered frame in ns */
+        uint64_t* frame_time;
+        uint32_t frames;
+
+        /* Latency of every event in ns */
+        uint64_t* latency;
+        uint32_t n_latency;
+
+        uint32_t slots;
+        uint32_t misses;
+};
+
+struct replay_key
+{
+        const char* name;
+        int key;
+};
+
+static const struct replay_key replay_keys[] = {
+        { "UP",     MDB_KEY_UP     },
+        { "DOWN",   MDB_KEY_DOWN   },
+        { "LEFT",   MDB_KEY_LEFT   },
+        { "RIGHT",  MDB_KEY_RIGHT  },
+        { "1",      MDB_KEY_1      },
+        { "2",      MDB_KEY_2      },
+        { "3",      MDB_KEY_3      },
+        { "4",      MDB_KEY_4      },
+        { "5",      MDB_KEY_5      },
+        { "6",      MDB_KEY_6      },
+        { "F1",     MDB_KEY_F1     },
+        { "F2",     MDB_KEY_F2     },
+        { "F3",     MDB_KEY_F3     },
+        { "F4",     MDB_KEY_F4     },
+        { "ESCAPE", MDB_KEY_ESCAPE },
+        { "SPACE",  MDB_KEY_SPACE  }
+};
+
+static const char* const replay_actions[] = {
+        [MDB_ACTION_RELEASE] = "release",
+        [MDB_ACTION_PRESS]   = "press",
+        [MDB_ACTION_REPEAT]  = "repeat"
+};
+
+/* Built-in session: visit the F1-F4 positions, zoom in and out, pan
+ * and change the bailout, holding keys like a user would.
+ */
+static const char replay_tour[] =
+        "0    F1\n"
+        "500  F3\n"
+        "600  2     hold 1000\n"
+        "1700 RIGHT hold 500\n"
+        "2300 4     hold 500\n"
+        "2900 1     hold 1000\n"
+        "4000 F4\n"
+        "4100 LEFT  hold 300\n"
+        "4500 F2\n"
+        "4600 3     hold 500\n"
+        "5200 F1\n";
+
+static const struct
+{
+        const char* name;
+        const char* script;
+} replay_builtin[] = {
+        { "tour", replay_tour }
+};
+
+static
+const char* replay_key_name(int key)
+{
+        uint32_t i;
+
+        for(i = 0; i < ARRAY_SIZE(replay_keys); ++i)
+        {
+                if(replay_keys[i].key == key)
+                        return replay_keys[i].name;
+        }
+
+        return NULL;
+}
+
+void replay_write_event(FILE* f, uint64_t time,
+                        const struct mdb_event_keyboard* event)
+{
+        const char* name = replay_key_name(event->key);
+        const char* action = "press";
+
+        if(event->action >= 0
+           && event->action < (int)ARRAY_SIZE(replay_actions))
+                action = replay_actions[event->action];
+
+        if(name)
+                fprintf(f, "%" PRIu64 " %s %s\n", time / NS_IN_MS, name,
+                        action);
+        else
+                fprintf(f, "%" PRIu64 " %d %s\n", time / NS_IN_MS,
+                        event->key, action);
+}
+
+static
+int replay_parse_key(const char* s, int* key)
+{
+        char* end;
+        long v;
+        uint32_t i;
+
+        for(i = 0; i < ARRAY_SIZE(replay_keys); ++i)
+        {
+                if(strcmp(replay_keys[i].name, s) == 0)
+                {
+                        *key = replay_keys[i].key;
+                        return MDB_SUCCESS;
+                }
+        }
+
+        errno = 0;
+        v = strtol(s, &end, 10);
+
+        if(errno || *end || end == s || v < 0 || v > MDB_KEY_LAST)
+                return MDB_FAIL;
+
+        *key = (int)v;
+
+        return MDB_SUCCESS;
+}
+
+static
+int replay_parse_ms(const char* s, uint64_t* ns)
+{
+        char* end;
+        unsigned long long v;
+
+        if(!s || *s == '-')
+                return MDB_FAIL;
+
+        errno = 0;
+        v = strtoull(s, &end, 10);
+
+        if(errno || *end || end == s)
+                return MDB_FAIL;
+
+        *ns = (uint64_t)v * NS_IN_MS;
+
+        return MDB_SUCCESS;
+}
+
+static
+void replay_add(struct replay* rp, uint64_t time, int key, int action)
+{
+        struct replay_event* ev;
+
+        if(rp->n_ev == rp->cap_ev)
+        {
+                rp->cap_ev = rp->cap_ev ? rp->cap_ev * 2 : 64;
+                rp->ev = realloc(rp->ev, rp->cap_ev * sizeof(*rp->ev));
+        }
+
+        ev = &rp->ev[rp->n_ev];
+
+        memset(ev, 0, sizeof(*ev));
+        ev->time = time;
+        ev->seq = rp->n_ev;
+        ev->key.key = key;
+        ev->key.action = action;
+
+        ++rp->n_ev;
+}
+
+static
+int replay_parse_line(struct replay* rp, char* line)
+{
+        char* save = NULL;
+        char* tok[4];
+        uint64_t time, hold, t;
+        uint32_t n = 0;
+        int key, action;
+        char* s;
+
+        for(s = strtok_r(line, " \t\r\n", &save); s && n < 4;
+            s = strtok_r(NULL, " \t\r\n", &save))
+                tok[n++] = s;
+
+        if(!n || tok[0][0] == '#')
+                return MDB_SUCCESS;
+
+        if(s || n < 2 || replay_parse_ms(tok[0], &time) != MDB_SUCCESS
+           || replay_parse_key(tok[1], &key) != MDB_SUCCESS)
+                return MDB_FAIL;
+
+        if(n == 2 || strcmp(tok[2], "press") == 0)
+                action = MDB_ACTION_PRESS;
+        else if(strcmp(tok[2], "repeat") == 0)
+                action = MDB_ACTION_REPEAT;
+        else if(strcmp(tok[2], "release") == 0)
+                action = MDB_ACTION_RELEASE;
+        else if(strcmp(tok[2], "hold") == 0)
+        {
+                if(n < 4 || replay_parse_ms(tok[3], &hold) != MDB_SUCCESS)
+                        return MDB_FAIL;
+
+                replay_add(rp, time, key, MDB_ACTION_PRESS);
+
+                for(t = REPLAY_REPEAT_MS * NS_IN_MS; t < hold;
+                    t += REPLAY_REPEAT_MS * NS_IN_MS)
+                        replay_add(rp, time + t, key, MDB_ACTION_REPEAT);
+
+                replay_add(rp, time + hold, key, MDB_ACTION_RELEASE);
+
+                return MDB_SUCCESS;
+        }
+        else
+                return MDB_FAIL;
+
+        if(n > 3)
+                return MDB_FAIL;
+
+        replay_add(rp, time, key, action);
+
+        return MDB_SUCCESS;
+}
+
+static
+int replay_event_cmp(const void* a, const void* b)
+{
+        const struct replay_event* x = a;
+        const struct replay_event* y = b;
+
+        if(x->time != y->time)
+                return x->time < y->time ? -1 : 1;
+
+        return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static
+int replay_load(struct replay* rp, const char* script)
+{
+        char* line = NULL;
+        size_t len = 0;
+        uint32_t lineno = 0;
+        uint32_t i;
+        int ret = MDB_SUCCESS;
+        FILE* f = NULL;
+
+        for(i = 0; i < ARRAY_SIZE(replay_builtin); ++i)
+        {
+                if(strcmp(replay_builtin[i].name, script) == 0)
+                {
+                        f = fmemopen((void*)replay_builtin[i].script,
+                                     strlen(replay_builtin[i].script), "r");
+                        break;
+                }
+        }
+
+        if(i == ARRAY_SIZE(replay_builtin))
+                f = fopen(script, "r");
+
+        if(!f)
+        {
+                LOG_ERROR("Failed to open replay script '%s': %s",
+                          script, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        while(getline(&line, &len, f) != -1)
+        {
+                ++lineno;
+
+                if(replay_parse_line(rp, line) != MDB_SUCCESS)
+                {
+                        LOG_ERROR("Invalid event at '%s' line %u",
+                                  script, lineno);
+                        ret = MDB_FAIL;
+                        break;
+                }
+        }
+
+        free(line);
+        fclose(f);
+
+        if(ret == MDB_SUCCESS && !rp->n_ev)
+        {
+                LOG_ERROR("Replay script '%s' has no events", script);
+                ret = MDB_FAIL;
+        }
+
+        if(ret == MDB_SUCCESS)
+                qsort(rp->ev, rp->n_ev, sizeof(*rp->ev), &replay_event_cmp);
+
+        return ret;
+}
+
+/* Time since the start of the session in ns */
+static inline
+uint64_t replay_now(struct replay* rp)
+{
+        return perf_ticks_to_ns(perf_ticks() - rp->t0);
+}
+
+static
+void replay_sleep_until(struct replay* rp, uint64_t t)
+{
+        struct timespec ts;
+        uint64_t now = replay_now(rp);
+
+        if(now >= t)
+                return;
+
+        ts.tv_sec = (time_t)((t - now) / NS_IN_SEC);
+        ts.tv_nsec = (long)((t - now) % NS_IN_SEC);
+
+        nanosleep(&ts, NULL);
+}
+
+/* Same scheduler path as render_update */
+static
+int replay_frame(struct replay* rp)
+{
+        if(rsched_host_yield(rp->sched) != MDB_SUCCESS)
+        {
+                LOG_ERROR("Scheduler failed to yield.");
+                return MDB_FAIL;
+        }
+
+        rsched_requeue(rp->sched);
+
+        return MDB_SUCCESS;
+}
+
+static
+void replay_proc_fun(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                     void* ctx)
+{
+        struct replay* rp = ctx;
+
+        mdb_kernel_process_block(rp->kernel, x0, x1, y0, y1);
+}
+
+static
+int replay_session(struct replay* rp)
+{
+        uint64_t end = rp->ev[rp->n_ev - 1].time;
+        uint64_t start, done, deadline;
+        uint32_t slot = 0;
+        uint32_t next = 0;
+        uint32_t first;
+
+        /* The last frame starts after the last event */
+        rp->slots = (uint32_t)(end / rp->period) + 2;
+        rp->frame_time = calloc(rp->slots, sizeof(*rp->frame_time));
+        rp->latency = calloc(rp->n_ev, sizeof(*rp->latency));
+
+        /* The session starts with a rendered screen */
+        if(replay_frame(rp) != MDB_SUCCESS)
+                return MDB_FAIL;
+
+        rp->t0 = perf_ticks();
+
+        while(slot < rp->slots || next < rp->n_ev)
+        {
+                if(slot >= rp->slots)
+                {
+                        /* A late frame skipped past the end with events
+                         * still pending, a frame is rendered per slot
+                         * at most so the session grows by that slot.
+                         */
+                        rp->slots = slot + 1;
+                        rp->frame_time = realloc(rp->frame_time,
+                                                 rp->slots *
+                                                 sizeof(*rp->frame_time));
+                }
+
+                replay_sleep_until(rp, slot * rp->period);
+
+                start = replay_now(rp);
+                first = next;
+
+                while(next < rp->n_ev && rp->ev[next].time <= start)
+                {
+                        mdb_kernel_event(rp->kernel, MDB_EVENT_KEYBOARD,
+                                         &rp->ev[next].key);
+                        ++next;
+                }
+
+                if(replay_frame(rp) != MDB_SUCCESS)
+                        return MDB_FAIL;
+
+                done = replay_now(rp);
+                deadline = (uint64_t)(slot + 1) * rp->period;
+
+                rp->frame_time[rp->frames++] = done - start;
+
+                for(; first < next; ++first)
+                        rp->latency[rp->n_latency++] =
+                                done - rp->ev[first].time;
+
+                if(done > deadline)
+                {
+                        ++rp->misses;
+                        slot = (uint32_t)(done / rp->period) + 1;
+                }
+                else
+                {
+                        ++slot;
+                }
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+void replay_print_times(const char* what, uint64_t* v, uint32_t n)
+{
+        struct sample_stats st;
+        char label[64];
+
+        if(!n)
+                return;
+
+        sample_stats_compute(v, n, &st);
+        sample_sort(v, n);
+
+        snprintf(label, sizeof(label), "%s avg", what);
+        PARAM_INFO(label, "%f ms", st.mean / 1e6);
+        snprintf(label, sizeof(label), "%s p50", what);
+        PARAM_INFO(label, "%f ms", ns_to_ms(sample_percentile(v, n, 50)));
+        snprintf(label, sizeof(label), "%s p99", what);
+        PARAM_INFO(label, "%f ms", ns_to_ms(sample_percentile(v, n, 99)));
+        snprintf(label, sizeof(label), "%s max", what);
+        PARAM_INFO(label, "%f ms", st.max / 1e6);
+}
+
+static
+void replay_print_summary(struct replay* rp, const char* script,
+                          uint32_t fps)
+{
+        uint64_t duration = (uint64_t)rp->slots * rp->period;
+
+        PARAM_INFO("Replay script", "%s", script);
+        PARAM_INFO("Replay events", "%u", rp->n_ev);
+        PARAM_INFO("Replay duration", "%f sec", ns_to_sec(duration));
+        PARAM_INFO("Target FPS", "%u", fps);
+        PARAM_INFO("Rendered frames", "%u", rp->frames);
+        PARAM_INFO("Dropped frames", "%u", rp->slots - rp->frames);
+        PARAM_INFO("Deadline misses", "%u (%.1f %%)", rp->misses,
+                   100.0 * rp->misses / MAX(rp->frames, 1));
+        PARAM_INFO("Avg FPS", "%f", rp->frames / ns_to_sec(duration));
+
+        replay_print_times("Frame time", rp->frame_time, rp->frames);
+        replay_print_times("Event latency", rp->latency, rp->n_latency);
+}
+
+int replay_run(struct rsched* sched, struct mdb_kernel* kernel,
+               struct arguments* args)
+{
+        const char* script = args->replay_script ? args->replay_script
+                                                 : "tour";
+        struct surface* surf;
+        struct replay rp;
+        int ret;
+
+        memset(&rp, 0, sizeof(rp));
+
+        rp.sched = sched;
+        rp.kernel = kernel;
+        rp.period = NS_IN_SEC / (uint32_t)args->replay_fps;
+
+        if(replay_load(&rp, script) != MDB_SUCCESS)
+        {
+                free(rp.ev);
+                return MDB_FAIL;
+        }
+
+        ret = surface_create(&surf, args->width, args->height,
+                             SURFACE_BUFFER_CREATE | SURFACE_BUFFER_F32);
+
+        if(ret != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create surface.");
+                free(rp.ev);
+                return ret;
+        }
+
+        mdb_kernel_set_size(kernel, args->width, args->height);
+        mdb_kernel_set_surface(kernel, surf);
+
+        rsched_set_user_context(sched, &replay_proc_fun, &rp);
+
+        LOG_SAY("Replaying '%s' at %d FPS...", script, args->replay_fps);
+
+        ret = replay_session(&rp);
+
+        if(ret == MDB_SUCCESS)
+                replay_print_summary(&rp, script, (uint32_t)args->replay_fps);
+
+        surface_destroy(surf);
+        free(rp.frame_time);
+        free(rp.latency);
+        free(rp.ev);
+
+        return ret;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <tools/args_parser.h>
+#include <kernel/mdb_kernel.h>
+#include <kernel/mdb_kernel_event.h>
+#include <sched/rsched.h>
+
+/* A replay script is a text file with one keyboard event per line:
+ *
+ *   TIME_MS KEY [press|repeat|release|hold DURATION_MS]
+ *
+ * TIME_MS is counted from the start of the session, KEY is a name like
+ * UP, F1 or 2 or a GLFW key code, the default action is press. hold
+ * expands to a press, auto-repeats every REPLAY_REPEAT_MS and a release
+ * after DURATION_MS. Empty lines and lines starting with '#' are
+ * skipped. Render mode writes this format with --record-keys.
+ */
+
+/* Auto-repeat interval of a hold in ms */
+#define REPLAY_REPEAT_MS 33
+
+/* Write a keyboard event that happened time ns after the start of
+ * a recording as a script line.
+ */
+void replay_write_event(FILE* f, uint64_t time,
+                        const struct mdb_event_keyboard* event);
+
+/* Feed the events of args->replay_script, a file or a built-in script
+ * name, to the kernel without a window while rendering frames at
+ * args->replay_fps the way render mode does, then report frame time,
+ * deadline misses and event to frame complete latency.
+ */
+int replay_run(struct rsched* sched, struct mdb_kernel* kernel,
+               struct arguments* args);
@@ -0,0 +1,525 @@
+/* mdb-schedbench - scheduler overhead microbenchmarks.
+ *
+ * Measures the cost of the scheduler itself independently of a kernel:
+ *
+ *   pop       - uncontended rsched_queue_pop on the calling thread.
+ *   requeue   - rsched_requeue between frames.
+ *   fork-join - rsched_host_yield round trip of a frame of a single
+ *               empty task.
+ *   frame     - frames of an empty or a synthetic fixed-cost payload,
+ *               the overhead per task is the frame time over all threads
+ *               minus the payload time, divided by the count of tasks.
+ *
+ * A fixed-cost payload spins on the timer, so it keeps a core busy
+ * without touching memory.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <argp.h>
+
+#include <tools/compiler.h>
+#include <tools/log.h>
+#include <tools/timer.h>
+#include <tools/stats.h>
+#include <tools/nproc.h>
+#include <tools/error_codes.h>
+#include <sched/rsched.h>
+
+#define BENCH_LIST_MAX 64
+
+struct bench_args
+{
+        uint32_t threads[BENCH_LIST_MAX];
+        uint32_t n_threads;
+
+        struct block_size grain[BENCH_LIST_MAX];
+        uint32_t n_grain;
+
+        uint64_t payload[BENCH_LIST_MAX];
+        uint32_t n_payload;
+
+        uint32_t width, height;
+        uint32_t frames;
+};
+
+struct payload
+{
+        uint64_t ticks;
+};
+
+enum
+{
+        KEY_PAYLOAD = 0xFF00
+};
+
+const char* argp_program_version = "mdb-schedbench 1.0";
+
+static char doc[] =
+        "Measure task pop rate, fork-join latency and requeue cost of the "
+        "scheduler with empty and synthetic fixed-cost payloads.";
+
+static const struct argp_option options[] = {
+        {"threads",    't', "N[,N...]", 0,
+                "Thread counts | default: powers of two up to all "
+                "processors", 0},
+        {"block-size", 'b', "NxM[,NxM...]", 0,
+                "Grains | default: 8x8,16x16,32x32,64x64", 0},
+        {"payload",    KEY_PAYLOAD, "NS[,NS...]", 0,
+                "Payload time of every task in ns, 0 is an empty task "
+                "| default: 0,1000,10000", 0},
+        {"width",      'w', "SIZE", 0,
+                "Surface width in pixels | default: 1024", 0},
+        {"height",     'h', "SIZE", 0,
+                "Surface height in pixels | default: 1024", 0},
+        {"frames",     'n', "N", 0,
+                "Frames per measurement | default: 100", 0},
+        {0, 0, 0, 0, 0, 0}
+};
+
+static
+uint64_t parse_u64(const char* key, const char* val)
+{
+        char* pend = NULL;
+        unsigned long long v;
+
+        errno = 0;
+        v = strtoull(val, &pend, 10);
+
+        if(errno != 0 || pend == val || (*pend != '\0' && *pend != 'x'))
+        {
+                fprintf(stderr, "Failed to parse '--%s=%s'\n", key, val);
+                exit(EXIT_FAILURE);
+        }
+
+        return v;
+}
+
+/* Split a comma separated list in place, returns count of items */
+static
+uint32_t parse_list(const char* key, char* arg, char** items)
+{
+        char* tok;
+        char* save = NULL;
+        uint32_t n = 0;
+
+        for(tok = strtok_r(arg, ",", &save); tok;
+            tok = strtok_r(NULL, ",", &save))
+        {
+                if(n >= BENCH_LIST_MAX)
+                {
+                        fprintf(stderr, "Too many values for '--%s'\n", key);
+                        exit(EXIT_FAILURE);
+                }
+
+                items[n++] = tok;
+        }
+
+        return n;
+}
+
+static
+void parse_threads(char* arg, struct bench_args* args)
+{
+        char* items[BENCH_LIST_MAX];
+        uint32_t i;
+
+        args->n_threads = parse_list("threads", arg, items);
+
+        for(i = 0; i < args->n_threads; ++i)
+        {
+                args->threads[i] = (uint32_t)parse_u64("threads", items[i]);
+
+                if(!args->threads[i])
+                {
+                        fprintf(stderr, "Invalid --threads list\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+}
+
+static
+void parse_grains(char* arg, struct bench_args* args)
+{
+        char* items[BENCH_LIST_MAX];
+        const char* sep;
+        uint32_t i;
+
+        args->n_grain = parse_list("block-size", arg, items);
+
+        for(i = 0; i < args->n_grain; ++i)
+        {
+                sep = strchr(items[i], 'x');
+
+                args->grain[i].x = (uint32_t)parse_u64("block-size",
+                                                       items[i]);
+                args->grain[i].y = sep ? (uint32_t)parse_u64("block-size",
+                                                             sep + 1)
+                                       : args->grain[i].x;
+
+                if(!args->grain[i].x || !args->grain[i].y)
+                {
+                        fprintf(stderr, "Invalid --block-size list\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+}
+
+static
+void parse_payloads(char* arg, struct bench_args* args)
+{
+        char* items[BENCH_LIST_MAX];
+        uint32_t i;
+
+        args->n_payload = parse_list("payload", arg, items);
+
+        for(i = 0; i < args->n_payload; ++i)
+                args->payload[i] = parse_u64("payload", items[i]);
+}
+
+static
+error_t parse_opt(int key, char* arg, struct argp_state* state)
+{
+        struct bench_args* args = state->input;
+
+        switch(key)
+        {
+        case 't':
+                parse_threads(arg, args);
+                break;
+
+        case 'b':
+                parse_grains(arg, args);
+                break;
+
+        case KEY_PAYLOAD:
+                parse_payloads(arg, args);
+                break;
+
+        case 'w':
+                args->width = (uint32_t)parse_u64("width", arg);
+                break;
+
+        case 'h':
+                args->height = (uint32_t)parse_u64("height", arg);
+                break;
+
+        case 'n':
+                args->frames = (uint32_t)parse_u64("frames", arg);
+                break;
+
+        case ARGP_KEY_ARG:
+                argp_usage(state);
+                break;
+
+        case ARGP_KEY_END:
+                if(!args->width || !args->height || !args->frames)
+                        argp_error(state, "size and frames must be > 0");
+                break;
+
+        default:
+                return ARGP_ERR_UNKNOWN;
+        }
+
+        return 0;
+}
+
+static
+void bench_default_args(struct bench_args* args)
+{
+        static const uint32_t default_grains[] = {8, 16, 32, 64};
+        static const uint64_t default_payloads[] = {0, 1000, 10000};
+
+        uint32_t np = (uint32_t)nproc_active();
+        uint32_t t;
+        uint32_t i;
+
+        memset(args, 0, sizeof(*args));
+
+        for(t = 1; t < np && args->n_threads < BENCH_LIST_MAX - 1; t *= 2)
+                args->threads[args->n_threads++] = t;
+
+        args->threads[args->n_threads++] = np;
+
+        for(i = 0; i < ARRAY_SIZE(default_grains); ++i)
+        {
+                args->grain[i].x = default_grains[i];
+                args->grain[i].y = default_grains[i];
+        }
+
+        args->n_grain = ARRAY_SIZE(default_grains);
+
+        for(i = 0; i < ARRAY_SIZE(default_payloads); ++i)
+                args->payload[i] = default_payloads[i];
+
+        args->n_payload = ARRAY_SIZE(default_payloads);
+
+        args->width = 1024;
+        args->height = 1024;
+        args->frames = 100;
+}
+
+static
+void payload_empty(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   void* ctx)
+{
+        UNUSED_PARAM(x0);
+        UNUSED_PARAM(x1);
+        UNUSED_PARAM(y0);
+        UNUSED_PARAM(y1);
+        UNUSED_PARAM(ctx);
+}
+
+static
+void payload_spin(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                  void* ctx)
+{
+        const struct payload* payload = ctx;
+        uint64_t end = perf_ticks() + payload->ticks;
+
+        UNUSED_PARAM(x0);
+        UNUSED_PARAM(x1);
+        UNUSED_PARAM(y0);
+        UNUSED_PARAM(y1);
+
+        while(perf_ticks() < end)
+                ;
+}
+
+/* Uncontended pops and requeues of a standalone queue, ns per operation.
+ * tasks is the count of tasks the surface is split into.
+ */
+static
+void bench_pop(const struct bench_args* args, struct block_size* grain,
+               uint32_t* tasks, double* pop_ns, double* requeue_ns)
+{
+        struct rsched_queue queue;
+        uint64_t pop_ticks = 0, requeue_ticks = 0;
+        uint64_t pops = 0;
+        uint64_t t0, t1;
+        uint32_t i;
+
+        /* Enough for the split, blocks share their edges so the split
+         * makes at most as many tasks.
+         */
+        rsched_queue_init(&queue);
+        rsched_queue_resize(&queue,
+                            ((args->width + grain->x - 1) / grain->x)
+                            * ((args->height + grain->y - 1) / grain->y),
+                            RS_QUE_DISCARD | RS_QUE_ZERO);
+        rsched_split_task(&queue, 0, args->width - 1, 0, args->height - 1,
+                          grain);
+
+        *tasks = queue.length;
+
+        for(i = 0; i < args->frames; ++i)
+        {
+                t0 = perf_ticks();
+
+                while(rsched_queue_pop(&queue, NULL))
+                        ++pops;
+
+                t1 = perf_ticks();
+
+                rsched_queue_requeue(&queue);
+
+                pop_ticks += t1 - t0;
+                requeue_ticks += perf_ticks() - t1;
+        }
+
+        *pop_ns = (double)perf_ticks_to_ns(pop_ticks) / MAX(pops, 1);
+        *requeue_ns = (double)perf_ticks_to_ns(requeue_ticks) / args->frames;
+
+        rsched_queue_destroy(&queue);
+}
+
+/* Time frames of the current tasks, frame_ns must hold args->frames */
+static
+void bench_frames(struct rsched* sched, const struct bench_args* args,
+                  uint64_t* frame_ns, double* requeue_ns)
+{
+        uint64_t requeue_ticks = 0;
+        uint64_t t0, t1;
+        uint32_t i;
+
+        /* Warm up workers and caches */
+        rsched_host_yield(sched);
+        rsched_requeue(sched);
+
+        for(i = 0; i < args->frames; ++i)
+        {
+                t0 = perf_ticks();
+
+                rsched_host_yield(sched);
+
+                t1 = perf_ticks();
+
+                rsched_requeue(sched);
+
+                requeue_ticks += perf_ticks() - t1;
+                frame_ns[i] = perf_ticks_to_ns(t1 - t0);
+        }
+
+        *requeue_ns = (double)perf_ticks_to_ns(requeue_ticks) / args->frames;
+}
+
+static
+void print_fork_join(struct rsched* sched, const struct bench_args* args,
+                     uint64_t* frame_ns)
+{
+        struct sample_stats st;
+        struct block_size one;
+        double requeue_ns;
+        uint32_t n = args->frames;
+
+        one.x = args->width;
+        one.y = args->height;
+
+        rsched_create_tasks(sched, args->width, args->height, &one);
+        rsched_set_user_context(sched, &payload_empty, NULL);
+
+        bench_frames(sched, args, frame_ns, &requeue_ns);
+
+        sample_stats_compute(frame_ns, n, &st);
+        sample_sort(frame_ns, n);
+
+        printf("%7u  %12.2f  %12.2f  %12.2f  %12.2f\n",
+               rsched_threads_count(sched), st.mean / 1e3,
+               sample_percentile(frame_ns, n, 50) / 1e3,
+               sample_percentile(frame_ns, n, 99) / 1e3,
+               st.max / 1e3);
+}
+
+static
+void print_frames(struct rsched* sched, const struct bench_args* args,
+                  struct block_size* grain, uint64_t payload_ns,
+                  uint64_t* frame_ns)
+{
+        struct payload payload;
+        struct sample_stats st;
+        uint32_t threads = rsched_threads_count(sched);
+        uint32_t tasks = sched->queue.length;
+        double requeue_ns, overhead;
+        char grain_s[16];
+
+        payload.ticks = payload_ns * __perf_clock.freq / NS_IN_SEC;
+
+        if(payload_ns)
+                rsched_set_user_context(sched, &payload_spin, &payload);
+        else
+                rsched_set_user_context(sched, &payload_empty, NULL);
+
+        bench_frames(sched, args, frame_ns, &requeue_ns);
+
+        sample_stats_compute(frame_ns, args->frames, &st);
+
+        /* Everything but the payload, spread over all threads */
+        overhead = (st.mean * threads - (double)tasks * payload_ns) / tasks;
+
+        snprintf(grain_s, sizeof(grain_s), "%ux%u", grain->x, grain->y);
+
+        printf("%7u  %9s  %8u  %10lu  %12.2f  %14.0f  %12.1f  %10.1f\n",
+               threads, grain_s, tasks, (unsigned long)payload_ns,
+               st.mean / 1e3, tasks / (st.mean / NS_IN_SEC), overhead,
+               requeue_ns);
+}
+
+int main(int argc, char** argv)
+{
+        static const struct argp argp = {
+                .options = options,
+                .parser = parse_opt,
+                .args_doc = NULL,
+                .doc = doc
+        };
+
+        struct bench_args args;
+        struct rsched_options opts;
+        struct rsched* sched;
+        uint64_t* frame_ns;
+        double pop_ns, requeue_ns;
+        char grain_s[16];
+        uint32_t tasks;
+        uint32_t t, g, p;
+
+        bench_default_args(&args);
+
+        argp_parse(&argp, argc, argv, 0, 0, &args);
+
+        log_init(LOGLEVEL_WARN, LOG_NO_VERBOSE, NULL);
+        perf_clock_init(PERF_CLOCK_DEFAULT);
+
+        frame_ns = calloc(args.frames, sizeof(*frame_ns));
+
+        printf("Surface %ux%u, %u frames per measurement, timer %s\n\n",
+               args.width, args.height, args.frames, perf_clock_name());
+
+        printf("Uncontended queue\n");
+        printf("%9s  %8s  %12s  %12s\n",
+               "grain", "tasks", "pop ns", "requeue ns");
+
+        for(g = 0; g < args.n_grain; ++g)
+        {
+                bench_pop(&args, &args.grain[g], &tasks, &pop_ns,
+                          &requeue_ns);
+
+                snprintf(grain_s, sizeof(grain_s), "%ux%u",
+                         args.grain[g].x, args.grain[g].y);
+
+                printf("%9s  %8u  %12.2f  %12.2f\n", grain_s, tasks,
+                       pop_ns, requeue_ns);
+        }
+
+        printf("\nFork-join latency of a single empty task, us\n");
+        printf("%7s  %12s  %12s  %12s  %12s\n",
+               "threads", "avg", "p50", "p99", "max");
+
+        for(t = 0; t < args.n_threads; ++t)
+        {
+                memset(&opts, 0, sizeof(opts));
+                opts.threads = args.threads[t];
+
+                if(rsched_create(&sched, &opts) != MDB_SUCCESS)
+                        continue;
+
+                rsched_tune_thread_affinity(sched);
+                print_fork_join(sched, &args, frame_ns);
+                rsched_shutdown(sched);
+        }
+
+        printf("\nFrames\n");
+        printf("%7s  %9s  %8s  %10s  %12s  %14s  %12s  %10s\n",
+               "threads", "grain", "tasks", "payload ns", "frame us",
+               "tasks/s", "overhead ns", "requeue ns");
+
+        for(t = 0; t < args.n_threads; ++t)
+        {
+                memset(&opts, 0, sizeof(opts));
+                opts.threads = args.threads[t];
+
+                if(rsched_create(&sched, &opts) != MDB_SUCCESS)
+                        continue;
+
+                rsched_tune_thread_affinity(sched);
+
+                for(g = 0; g < args.n_grain; ++g)
+                {
+                        rsched_create_tasks(sched, args.width, args.height,
+                                            &args.grain[g]);
+
+                        for(p = 0; p < args.n_payload; ++p)
+                                print_frames(sched, &args, &args.grain[g],
+                                             args.payload[p], frame_ns);
+                }
+
+                rsched_shutdown(sched);
+        }
+
+        free(frame_ns);
+        log_shutdown();
+
+        return EXIT_SUCCESS;
+}
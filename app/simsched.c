@@ -0,0 +1,494 @@
+/* mdb-simsched - offline scheduler simulator.
+ *
+ * Replays a per-tile cost map recorded by the scheduler
+ * ( mdb --rsched=costs,file=FILE ) under the shared queue policy used by
+ * rsched and a few alternative policies for any virtual thread count,
+ * and predicts makespan, idle tail and efficiency of a frame
+ * without running a kernel.
+ *
+ * The model assumes tile costs don't depend on the thread count, so effects
+ * like SMT, memory bandwidth and frequency scaling are not taken into account.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <argp.h>
+
+#include <tools/compiler.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+#include <sched/rsched_costs.h>
+
+#define SIM_LIST_MAX 64
+
+enum
+{
+        POLICY_SHARED,
+        POLICY_LPT,
+        POLICY_STATIC,
+        POLICY_INTERLEAVED,
+
+        POLICY_LAST
+};
+
+static const char* policy_names[POLICY_LAST] = {
+        "shared",
+        "lpt",
+        "static",
+        "interleaved"
+};
+
+struct sim_args
+{
+        char* cost_file;
+
+        uint32_t threads[SIM_LIST_MAX];
+        uint32_t n_threads;
+
+        bool policy[POLICY_LAST];
+
+        uint32_t grain_x, grain_y;
+
+        uint64_t overhead;
+};
+
+struct sim_result
+{
+        uint64_t work;
+        uint64_t makespan;
+        uint64_t tail;
+        uint64_t idle;
+        uint64_t bound;
+};
+
+enum
+{
+        KEY_OVERHEAD = 0xFF00
+};
+
+const char* argp_program_version = "mdb-simsched 1.0";
+
+static char doc[] =
+        "Replay recorded per-tile costs under various scheduling policies."
+        "\vPolicies:\n"
+        "  shared      - rsched shared queue, tiles in the queue order\n"
+        "  lpt         - shared queue, tiles sorted by decreasing cost\n"
+        "  static      - contiguous equal chunks of tiles per worker\n"
+        "  interleaved - tile i goes to worker i mod threads\n";
+
+static char args_doc[] = "COSTFILE";
+
+static const struct argp_option options[] = {
+        {"threads",    't', "N[,N...]", 0,
+                "Virtual thread counts | default: 1,2,4,8,16,32", 0},
+        {"policy",     'p', "NAME[,NAME...]|all", 0,
+                "Policies to simulate | default: all", 0},
+        {"block-size", 'b', "NxM", 0,
+                "Merge recorded tiles to a coarser grain, must be "
+                "a multiple of the recorded grain", 0},
+        {"overhead",   KEY_OVERHEAD, "NS", 0,
+                "Scheduling overhead added to every task in ns | default: 0",
+                0},
+        {0, 0, 0, 0, 0, 0}
+};
+
+static
+uint32_t parse_u32(const char* key, const char* val)
+{
+        char* pend = NULL;
+        unsigned long v;
+
+        errno = 0;
+        v = strtoul(val, &pend, 10);
+
+        if(errno != 0 || pend == val || (*pend != '\0' && *pend != ','
+                                         && *pend != 'x'))
+        {
+                fprintf(stderr, "Failed to parse '--%s=%s'\n", key, val);
+                exit(EXIT_FAILURE);
+        }
+
+        return (uint32_t)v;
+}
+
+static
+void parse_threads(char* arg, struct sim_args* args)
+{
+        char* tok;
+        char* save = NULL;
+
+        args->n_threads = 0;
+
+        for(tok = strtok_r(arg, ",", &save); tok;
+            tok = strtok_r(NULL, ",", &save))
+        {
+                uint32_t n = parse_u32("threads", tok);
+
+                if(n == 0 || args->n_threads >= SIM_LIST_MAX)
+                {
+                        fprintf(stderr, "Invalid --threads list\n");
+                        exit(EXIT_FAILURE);
+                }
+
+                args->threads[args->n_threads++] = n;
+        }
+}
+
+static
+void parse_policy(char* arg, struct sim_args* args)
+{
+        char* tok;
+        char* save = NULL;
+        int i;
+
+        memset(args->policy, 0, sizeof(args->policy));
+
+        for(tok = strtok_r(arg, ",", &save); tok;
+            tok = strtok_r(NULL, ",", &save))
+        {
+                bool found = false;
+
+                for(i = 0; i < POLICY_LAST; ++i)
+                {
+                        if(strcmp(tok, "all") == 0
+                           || strcmp(tok, policy_names[i]) == 0)
+                        {
+                                args->policy[i] = true;
+                                found = true;
+                        }
+                }
+
+                if(!found)
+                {
+                        fprintf(stderr, "Unknown policy '%s'\n", tok);
+                        exit(EXIT_FAILURE);
+                }
+        }
+}
+
+static
+void parse_block_size(const char* arg, struct sim_args* args)
+{
+        const char* sep = strchr(arg, 'x');
+
+        args->grain_x = parse_u32("block-size", arg);
+        args->grain_y = sep ? parse_u32("block-size", sep + 1) : args->grain_x;
+
+        if(args->grain_x == 0 || args->grain_y == 0)
+        {
+                fprintf(stderr, "Invalid --block-size=%s\n", arg);
+                exit(EXIT_FAILURE);
+        }
+}
+
+static
+error_t parse_opt(int key, char* arg, struct argp_state* state)
+{
+        struct sim_args* args = state->input;
+
+        switch(key)
+        {
+        case 't':
+                parse_threads(arg, args);
+                break;
+
+        case 'p':
+                parse_policy(arg, args);
+                break;
+
+        case 'b':
+                parse_block_size(arg, args);
+                break;
+
+        case KEY_OVERHEAD:
+                args->overhead = parse_u32("overhead", arg);
+                break;
+
+        case ARGP_KEY_ARG:
+                if(args->cost_file)
+                        argp_usage(state);
+
+                args->cost_file = arg;
+                break;
+
+        case ARGP_KEY_END:
+                if(!args->cost_file)
+                        argp_usage(state);
+                break;
+
+        default:
+                return ARGP_ERR_UNKNOWN;
+        }
+
+        return 0;
+}
+
+/* Merge recorded tiles into tiles of a coarser grain.
+ * Merged tiles follow the row-major order of rsched_split_task.
+ */
+static
+int regroup_tiles(const struct rsched_cost_map* map,
+                  uint32_t grain_x, uint32_t grain_y,
+                  uint64_t** pcost, uint32_t* pn)
+{
+        uint32_t cols, rows, i;
+        uint64_t* cost;
+
+        if(grain_x % map->grain_x || grain_y % map->grain_y)
+        {
+                LOG_ERROR("Block size %ux%u is not a multiple of "
+                          "the recorded grain %ux%u",
+                          grain_x, grain_y, map->grain_x, map->grain_y);
+                return MDB_FAIL;
+        }
+
+        cols = (map->width + grain_x - 1) / grain_x;
+        rows = (map->height + grain_y - 1) / grain_y;
+
+        cost = calloc((size_t)cols * rows, sizeof(*cost));
+
+        for(i = 0; i < map->n_tiles; ++i)
+        {
+                const struct rsched_tile_cost* t = &map->tile[i];
+                size_t idx = (size_t)(t->y0 / grain_y) * cols
+                             + t->x0 / grain_x;
+
+                if(idx >= (size_t)cols * rows)
+                {
+                        LOG_ERROR("Tile {%u, %u, %u, %u} is out of the surface",
+                                  t->x0, t->x1, t->y0, t->y1);
+                        free(cost);
+                        return MDB_FAIL;
+                }
+
+                cost[idx] += t->cost;
+        }
+
+        *pcost = cost;
+        *pn = cols * rows;
+
+        return MDB_SUCCESS;
+}
+
+static
+int cmp_cost_desc(const void* a, const void* b)
+{
+        uint64_t ca = *(const uint64_t*)a;
+        uint64_t cb = *(const uint64_t*)b;
+
+        return ca < cb ? 1 : (ca > cb ? -1 : 0);
+}
+
+/* Greedy list scheduling: the worker which gets free first pops the next
+ * task, this is exactly what rsched workers do with the shared queue.
+ */
+static
+void sim_shared_queue(const uint64_t* cost, uint32_t n, uint32_t threads,
+                      uint64_t overhead, uint64_t* finish)
+{
+        uint32_t i, w, next;
+
+        for(i = 0; i < n; ++i)
+        {
+                next = 0;
+                for(w = 1; w < threads; ++w)
+                {
+                        if(finish[w] < finish[next])
+                                next = w;
+                }
+
+                finish[next] += cost[i] + overhead;
+        }
+}
+
+static
+void sim_static(const uint64_t* cost, uint32_t n, uint32_t threads,
+                uint64_t overhead, uint64_t* finish)
+{
+        uint32_t chunk = (n + threads - 1) / threads;
+        uint32_t i;
+
+        for(i = 0; i < n; ++i)
+                finish[i / chunk] += cost[i] + overhead;
+}
+
+static
+void sim_interleaved(const uint64_t* cost, uint32_t n, uint32_t threads,
+                     uint64_t overhead, uint64_t* finish)
+{
+        uint32_t i;
+
+        for(i = 0; i < n; ++i)
+                finish[i % threads] += cost[i] + overhead;
+}
+
+static
+void simulate(int policy, const uint64_t* cost, const uint64_t* cost_sorted,
+              uint32_t n, uint32_t threads, uint64_t overhead,
+              struct sim_result* res)
+{
+        uint64_t* finish = calloc(threads, sizeof(*finish));
+        uint64_t first = UINT64_MAX;
+        uint32_t i;
+
+        switch(policy)
+        {
+        case POLICY_SHARED:
+                sim_shared_queue(cost, n, threads, overhead, finish);
+                break;
+
+        case POLICY_LPT:
+                sim_shared_queue(cost_sorted, n, threads, overhead, finish);
+                break;
+
+        case POLICY_STATIC:
+                sim_static(cost, n, threads, overhead, finish);
+                break;
+
+        case POLICY_INTERLEAVED:
+                sim_interleaved(cost, n, threads, overhead, finish);
+                break;
+
+        default:
+                break;
+        }
+
+        res->work = 0;
+        res->makespan = 0;
+        res->idle = 0;
+
+        for(i = 0; i < n; ++i)
+                res->work += cost[i];
+
+        for(i = 0; i < threads; ++i)
+        {
+                res->makespan = MAX(res->makespan, finish[i]);
+                first = MIN(first, finish[i]);
+        }
+
+        for(i = 0; i < threads; ++i)
+                res->idle += res->makespan - finish[i];
+
+        res->tail = res->makespan - first;
+
+        /* Nothing can beat a perfect split of the work
+         * or the most expensive tile */
+        res->bound = MAX((res->work + threads - 1) / threads,
+                         n ? cost_sorted[0] : 0);
+
+        free(finish);
+}
+
+static
+void print_result(uint32_t threads, int policy, const struct sim_result* res)
+{
+        double eff = res->makespan
+                     ? 100.0 * res->work / ((double)threads * res->makespan)
+                     : 0.0;
+
+        double speedup = res->makespan
+                         ? (double)res->work / res->makespan
+                         : 0.0;
+
+        printf("%7u  %-11s  %12.1f  %12.1f  %12.1f  %12.1f  %6.2f%%  %7.2f\n",
+               threads, policy_names[policy],
+               res->makespan / 1e3, res->tail / 1e3,
+               res->idle / 1e3 / threads, res->bound / 1e3,
+               eff, speedup);
+}
+
+int main(int argc, char** argv)
+{
+        static const struct argp argp = {
+                .options = options,
+                .parser = parse_opt,
+                .args_doc = args_doc,
+                .doc = doc
+        };
+
+        static const uint32_t default_threads[] = {1, 2, 4, 8, 16, 32};
+
+        struct sim_args args;
+        struct rsched_cost_map map;
+        struct sim_result res;
+        uint64_t* cost;
+        uint64_t* cost_sorted;
+        uint32_t n, i;
+        int p;
+
+        memset(&args, 0, sizeof(args));
+
+        for(i = 0; i < ARRAY_SIZE(default_threads); ++i)
+                args.threads[i] = default_threads[i];
+
+        args.n_threads = ARRAY_SIZE(default_threads);
+
+        for(p = 0; p < POLICY_LAST; ++p)
+                args.policy[p] = true;
+
+        argp_parse(&argp, argc, argv, 0, 0, &args);
+
+        log_init(LOGLEVEL_WARN, LOG_NO_VERBOSE, NULL);
+
+        if(rsched_costs_load(&map, args.cost_file) != MDB_SUCCESS)
+        {
+                log_shutdown();
+                return EXIT_FAILURE;
+        }
+
+        if(!args.grain_x)
+        {
+                args.grain_x = map.grain_x;
+                args.grain_y = map.grain_y;
+        }
+
+        if(regroup_tiles(&map, args.grain_x, args.grain_y, &cost, &n)
+           != MDB_SUCCESS)
+        {
+                rsched_costs_free(&map);
+                log_shutdown();
+                return EXIT_FAILURE;
+        }
+
+        cost_sorted = malloc(n * sizeof(*cost_sorted));
+        memcpy(cost_sorted, cost, n * sizeof(*cost_sorted));
+        qsort(cost_sorted, n, sizeof(*cost_sorted), &cmp_cost_desc);
+
+        printf("Surface %ux%u, recorded grain %ux%u over %llu frames\n",
+               map.width, map.height, map.grain_x, map.grain_y,
+               (unsigned long long)map.frames);
+        printf("Simulated grain %ux%u, %u tiles, overhead %llu ns per task\n",
+               args.grain_x, args.grain_y, n,
+               (unsigned long long)args.overhead);
+        printf("Times are per frame in us. tail - makespan minus the first "
+               "worker finish, idle - average idle time per worker, "
+               "bound - lower bound of makespan.\n\n");
+
+        printf("%7s  %-11s  %12s  %12s  %12s  %12s  %7s  %7s\n",
+               "threads", "policy", "makespan", "tail", "idle", "bound",
+               "eff", "speedup");
+
+        for(i = 0; i < args.n_threads; ++i)
+        {
+                for(p = 0; p < POLICY_LAST; ++p)
+                {
+                        if(!args.policy[p])
+                                continue;
+
+                        simulate(p, cost, cost_sorted, n, args.threads[i],
+                                 args.overhead, &res);
+
+                        print_result(args.threads[i], p, &res);
+                }
+        }
+
+        free(cost_sorted);
+        free(cost);
+        rsched_costs_free(&map);
+        log_shutdown();
+
+        return 0;
+}
@@ -0,0 +1,393 @@
+#include "sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <app/benchmark.h>
+#include <app/views.h>
+#include <kernel/mdb_kernel.h>
+#include <surface/surface.h>
+#include <tools/nproc.h>
+#include <tools/timer.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+#include <tools/compiler.h>
+
+/* Kernels are loaded once and the scheduler is created once per thread
+ * count, a grain change only splits the surface again and a bailout
+ * change is an event to the kernel.
+ *
+ * A strong scaling run is a sweep over 1..N threads, every other
+ * configuration is then compared with its single thread result.
+ */
+
+struct sweep_result
+{
+        const char* kernel;
+        uint32_t threads;
+        struct block_size grain;
+        uint32_t bailout;
+        const char* view;
+        double fps;
+        struct bench_summary sum;
+};
+
+struct sweep
+{
+        struct arguments* args;
+        struct arg_sweep* list;
+
+        struct mdb_kernel* kernel[ARG_LIST_MAX];
+        struct surface* surf;
+
+        struct sweep_result* result;
+        uint32_t n_result;
+};
+
+static
+int sweep_load_kernels(struct sweep* sw)
+{
+        uint32_t i;
+
+        for(i = 0; i < sw->list->n_kernel; ++i)
+        {
+                if(mdb_kernel_create(&sw->kernel[i], sw->list->kernel[i])
+                   != MDB_SUCCESS)
+                {
+                        LOG_ERROR("Cannot create the kernel '%s'",
+                                  sw->list->kernel[i]);
+                        return MDB_FAIL;
+                }
+
+                mdb_kernel_set_size(sw->kernel[i], sw->args->width,
+                                    sw->args->height);
+                mdb_kernel_set_surface(sw->kernel[i], sw->surf);
+
+                if(sw->args->precision >= 0
+                   && mdb_kernel_set_precision(sw->kernel[i],
+                                               sw->args->precision)
+                      != MDB_SUCCESS)
+                        LOG_WARN("Kernel '%s' doesn't support the "
+                                 "precision.", sw->list->kernel[i]);
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+void sweep_unload_kernels(struct sweep* sw)
+{
+        uint32_t i;
+
+        for(i = 0; i < sw->list->n_kernel; ++i)
+        {
+                if(sw->kernel[i])
+                        mdb_kernel_destroy(sw->kernel[i]);
+        }
+}
+
+static
+void sweep_run_config(struct sweep* sw, struct rsched* sched, uint32_t k,
+                      uint32_t bailout, const char* view)
+{
+        struct sweep_result* res = &sw->result[sw->n_result];
+        struct benchmark* bench;
+        uint32_t size = arg_sweep_size(sw->list);
+
+        res->kernel = sw->list->kernel[k];
+        res->threads = rsched_threads_count(sched);
+        res->grain = sched->grain;
+        res->bailout = bailout;
+        res->view = view ? view : "default";
+
+        LOG_SAY("[%u/%u] %s threads=%u grain=%ux%u bailout=%u view=%s",
+                sw->n_result + 1, size, res->kernel, res->threads,
+                res->grain.x, res->grain.y, res->bailout, res->view);
+
+        if(mdb_kernel_set_bailout(sw->kernel[k], bailout) != MDB_SUCCESS)
+                LOG_WARN("Kernel '%s' doesn't accept bailout changes.",
+                         res->kernel);
+
+        benchmark_create(&bench, (uint32_t)sw->args->benchmark_runs,
+                         sw->kernel[k], sched, false);
+        benchmark_set_batches(bench, (uint32_t)sw->args->warmup,
+                              (uint32_t)sw->args->batches);
+
+        if(view)
+                benchmark_set_view(bench, view_find(view));
+        benchmark_run(bench);
+        benchmark_summarize(bench, &res->sum);
+
+        res->fps = (double)bench->runs / bench->total_exec_time;
+
+        benchmark_destroy(bench);
+
+        ++sw->n_result;
+}
+
+static
+int sweep_run_threads(struct sweep* sw, struct rsched_options* opts,
+                      int threads)
+{
+        struct arg_sweep* list = sw->list;
+        struct block_size grain;
+        struct rsched* sched;
+        uint32_t g, k, b, v;
+
+        opts->threads = threads <= -1 ? (uint32_t)nproc_active()
+                                      : (uint32_t)threads;
+
+        if(rsched_create(&sched, opts) != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create the scheduler with %u threads",
+                          opts->threads);
+                return MDB_FAIL;
+        }
+
+        rsched_tune_thread_affinity(sched);
+
+        for(g = 0; g < list->n_block; ++g)
+        {
+                grain.x = list->block_x[g];
+                grain.y = list->block_y[g];
+
+                rsched_create_tasks(sched, sw->args->width, sw->args->height,
+                                    &grain);
+
+                for(k = 0; k < list->n_kernel; ++k)
+                        for(b = 0; b < list->n_bailout; ++b)
+                                for(v = 0; v < list->n_view; ++v)
+                                        sweep_run_config(sw, sched, k,
+                                                         list->bailout[b],
+                                                         list->view[v]);
+        }
+
+        rsched_shutdown(sched);
+
+        return MDB_SUCCESS;
+}
+
+static
+void sweep_print_table(struct sweep* sw)
+{
+        const struct sweep_result* res;
+        char grain[16];
+        uint32_t i;
+
+        LOG_SAY("== Sweep results ==");
+        LOG_SAY("%-16s %7s %9s %7s %-14s %9s %9s %9s %9s %9s %9s",
+                "kernel", "threads", "grain", "bailout", "view", "fps",
+                "avg ms", "p50 ms", "p99 ms", "stddev ms", "giga it/s");
+
+        for(i = 0; i < sw->n_result; ++i)
+        {
+                res = &sw->result[i];
+
+                snprintf(grain, sizeof(grain), "%ux%u",
+                         res->grain.x, res->grain.y);
+
+                LOG_SAY("%-16s %7u %9s %7u %-14s %9.3f %9.3f %9.3f %9.3f "
+                        "%9.3f %9.3f",
+                        res->kernel, res->threads, grain, res->bailout,
+                        res->view, res->fps, res->sum.frame.mean / 1e6,
+                        ns_to_ms(res->sum.frame_pct.p50),
+                        ns_to_ms(res->sum.frame_pct.p99),
+                        res->sum.frame.stddev / 1e6, res->sum.giga_iters);
+        }
+}
+
+/* Thread counts of a strong scaling run: every count up to n or evenly
+ * spaced steps if they don't fit the list.
+ */
+static
+void sweep_scaling_threads(struct arg_sweep* list, int n)
+{
+        uint32_t max = n <= -1 ? (uint32_t)nproc_active() : (uint32_t)n;
+        uint32_t step = 1;
+        uint32_t t;
+
+        if(max > ARG_LIST_MAX)
+                step = (max + ARG_LIST_MAX - 2) / (ARG_LIST_MAX - 1);
+
+        list->n_threads = 0;
+        list->threads[list->n_threads++] = 1;
+
+        for(t = MAX(step, 2); t < max; t += step)
+                list->threads[list->n_threads++] = (int)t;
+
+        if(max > 1)
+                list->threads[list->n_threads++] = (int)max;
+}
+
+static
+void sweep_print_scaling(struct sweep* sw)
+{
+        struct arg_sweep* list = sw->list;
+        const struct sweep_result* base;
+        const struct sweep_result* res;
+        uint32_t group = sw->n_result / list->n_threads;
+        uint32_t max = (uint32_t)list->threads[list->n_threads - 1];
+        uint32_t ncpu = (uint32_t)nproc_active();
+        double speedup, eff;
+        const char* mark;
+        char kf[16];
+        uint32_t c, t;
+        int smt;
+
+        smt = nproc_first_smt_sibling((int)MIN(max, ncpu));
+
+        for(c = 0; c < group; ++c)
+        {
+                base = &sw->result[c];
+
+                LOG_SAY("== Strong scaling: %s grain=%ux%u bailout=%u "
+                        "view=%s ==", base->kernel, base->grain.x,
+                        base->grain.y, base->bailout, base->view);
+                LOG_SAY("%7s %9s %9s %10s %10s",
+                        "threads", "fps", "speedup", "efficiency",
+                        "karp-flatt");
+
+                for(t = 0; t < list->n_threads; ++t)
+                {
+                        res = &sw->result[t * group + c];
+
+                        speedup = base->sum.frame.mean / res->sum.frame.mean;
+                        eff = speedup / res->threads;
+
+                        /* Experimentally determined serial fraction */
+                        if(res->threads > 1)
+                                snprintf(kf, sizeof(kf), "%.4f",
+                                         (1.0 / speedup
+                                          - 1.0 / res->threads)
+                                         / (1.0 - 1.0 / res->threads));
+                        else
+                                snprintf(kf, sizeof(kf), "-");
+
+                        if(res->threads > ncpu)
+                                mark = " oversubscribed";
+                        else if(smt >= 0 && res->threads > (uint32_t)smt)
+                                mark = " smt";
+                        else
+                                mark = "";
+
+                        LOG_SAY("%7u %9.3f %9.3f %8.1f %% %10s%s",
+                                res->threads, res->fps, speedup,
+                                eff * 100.0, kf, mark);
+                }
+        }
+
+        if(smt < 0)
+                LOG_SAY("SMT topology is unknown.");
+        else if((uint32_t)smt >= MIN(max, ncpu))
+                LOG_SAY("No SMT siblings are used up to %u threads.",
+                        MIN(max, ncpu));
+        else
+                LOG_SAY("SMT siblings are used from %d threads.", smt + 1);
+}
+
+static
+int sweep_save_csv(struct sweep* sw, const char* filename)
+{
+        const struct sweep_result* res;
+        FILE* f;
+        uint32_t i;
+
+        f = fopen(filename, "w");
+        if(!f)
+        {
+                LOG_ERROR("Failed to open '%s' for writing: %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        fprintf(f, "kernel,threads,grain_x,grain_y,bailout,view,width,"
+                "height,runs,fps,frame_avg_ns,frame_stddev_ns,frame_p50_ns,"
+                "frame_p90_ns,frame_p99_ns,frame_p999_ns,block_p50_ns,"
+                "block_p99_ns,iterations,giga_iters_per_sec\n");
+
+        for(i = 0; i < sw->n_result; ++i)
+        {
+                res = &sw->result[i];
+
+                fprintf(f, "\"%s\",%u,%u,%u,%u,%s,%u,%u,%d,%f,%.0f,%.0f,"
+                        "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                        ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%f\n",
+                        res->kernel, res->threads, res->grain.x,
+                        res->grain.y, res->bailout, res->view,
+                        sw->args->width,
+                        sw->args->height, sw->args->benchmark_runs, res->fps,
+                        res->sum.frame.mean, res->sum.frame.stddev,
+                        res->sum.frame_pct.p50, res->sum.frame_pct.p90,
+                        res->sum.frame_pct.p99, res->sum.frame_pct.p999,
+                        res->sum.block_pct.p50, res->sum.block_pct.p99,
+                        res->sum.iters, res->sum.giga_iters);
+        }
+
+        if(fclose(f))
+        {
+                LOG_ERROR("Failed to write '%s': %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        return MDB_SUCCESS;
+}
+
+int sweep_run(struct arguments* args, struct rsched_options* opts)
+{
+        struct sweep sw;
+        uint32_t t;
+        int ret;
+
+        memset(&sw, 0, sizeof(sw));
+
+        sw.args = args;
+        sw.list = &args->sweep;
+
+        if(args->scaling)
+                sweep_scaling_threads(sw.list, args->scaling);
+        sw.result = calloc(arg_sweep_size(sw.list), sizeof(*sw.result));
+
+        /* Per-configuration outputs make no sense for a sweep */
+        opts->record_costs = false;
+        opts->trace_size = 0;
+        opts->pmu = false;
+
+        ret = surface_create(&sw.surf, args->width, args->height,
+                             SURFACE_BUFFER_CREATE | SURFACE_BUFFER_F32);
+        if(ret != MDB_SUCCESS)
+        {
+                LOG_ERROR("Cannot create surface.");
+                free(sw.result);
+                return ret;
+        }
+
+        ret = sweep_load_kernels(&sw);
+
+        LOG_SAY("Running benchmark sweep of %u configurations...",
+                arg_sweep_size(sw.list));
+
+        for(t = 0; t < sw.list->n_threads && ret == MDB_SUCCESS; ++t)
+                ret = sweep_run_threads(&sw, opts, sw.list->threads[t]);
+
+        if(sw.n_result)
+                sweep_print_table(&sw);
+
+        if(args->scaling && sw.n_result == arg_sweep_size(sw.list))
+                sweep_print_scaling(&sw);
+
+        if(sw.n_result && args->report_file)
+        {
+                if(sweep_save_csv(&sw, args->report_file) == MDB_SUCCESS)
+                        LOG_SAY("Sweep results saved to '%s'",
+                                args->report_file);
+        }
+
+        sweep_unload_kernels(&sw);
+        surface_destroy(sw.surf);
+        free(sw.result);
+
+        return ret;
+}
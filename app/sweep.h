@@ -0,0 +1,12 @@
+#pragma once
+
+#include <tools/args_parser.h>
+#include <sched/rsched.h>
+
+/* Benchmark every combination of kernels, thread counts, block sizes
+ * and bailouts given in args->sweep and print a single results table.
+ * With args->scaling thread counts are 1..N and a strong scaling
+ * report follows the table.
+ * opts are the scheduler options, threads are taken from the sweep.
+ */
+int sweep_run(struct arguments* args, struct rsched_options* opts);
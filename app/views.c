@@ -0,0 +1,159 @@
+#include "views.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <tools/compiler.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+
+/* Regions are picked by the share of points reaching bailout 256:
+ * none for easy views, all for interior ones, and a mix with a high
+ * average iteration count for boundary ones.
+ */
+static const struct view views[] = {
+        {"exterior", VIEW_EASY,
+         "Outside of the set, every point escapes in a few iterations",
+         1.0, 1.0, 1.0, 0,
+         NULL, NULL, 0},
+        {"full", VIEW_MIXED,
+         "The whole set",
+         -0.75, 0.0, 2.8, 0,
+         NULL, NULL, 0},
+        {"cardioid", VIEW_INTERIOR,
+         "Inside of the main cardioid, every point reaches bailout",
+         -0.15, 0.0, 0.4, 0,
+         NULL, NULL, 0},
+        {"bulb", VIEW_INTERIOR,
+         "Inside of the period-2 bulb, every point reaches bailout",
+         -1.0, 0.0, 0.3, 0,
+         NULL, NULL, 0},
+        {"seahorse", VIEW_BOUNDARY,
+         "Seahorse valley",
+         -0.7436, 0.1318, 0.01, 0,
+         NULL, NULL, 0},
+        {"elephant", VIEW_BOUNDARY,
+         "Elephant valley",
+         0.28, 0.008, 0.02, 0,
+         NULL, NULL, 0},
+        {"default", VIEW_BOUNDARY,
+         "Start-up view of the kernels",
+         -1.347385054652062, -0.063483549665202, 0.00188964, 0,
+         NULL, NULL, 0},
+        {"tendrils", VIEW_BOUNDARY,
+         "Filaments of the upper half",
+         0.356868, -0.348140, 0.003869, 0,
+         NULL, NULL, 0},
+        {"zoom-seahorse", VIEW_ZOOM,
+         "Zoom from the whole set deep into seahorse valley",
+         -0.743643887, 0.131825904, 2.8, 1e-4,
+         NULL, NULL, 0},
+        {"zoom-elephant", VIEW_ZOOM,
+         "Zoom from the whole set deep into elephant valley",
+         0.2821, 0.0101, 2.8, 1e-3,
+         NULL, NULL, 0},
+        {"zoom-deep", VIEW_ZOOM,
+         "Zoom from 1e-10 to 1e-320 into the Misiurewicz point i, "
+         "needs a deep zoom kernel and bailout 1024",
+         0.0, 1.0, 1.0, 1e-310,
+         "0", "1", -10},
+};
+
+const struct view* view_find(const char* name)
+{
+        size_t i;
+
+        for(i = 0; i < ARRAY_SIZE(views); ++i)
+        {
+                if(strcmp(views[i].name, name) == 0)
+                        return &views[i];
+        }
+
+        return NULL;
+}
+
+const char* view_type_str(int type)
+{
+        switch(type)
+        {
+        case VIEW_EASY:
+                return "easy";
+        case VIEW_MIXED:
+                return "mixed";
+        case VIEW_INTERIOR:
+                return "interior";
+        case VIEW_BOUNDARY:
+                return "boundary";
+        case VIEW_ZOOM:
+                return "zoom";
+        default:
+                return "unknown";
+        }
+}
+
+void views_print(void)
+{
+        const struct view* v;
+        size_t i;
+
+        printf("%-14s %-9s %s\n", "name", "type", "description");
+
+        for(i = 0; i < ARRAY_SIZE(views); ++i)
+        {
+                v = &views[i];
+
+                printf("%-14s %-9s %s\n", v->name, view_type_str(v->type),
+                       v->desc);
+        }
+}
+
+int view_apply(const struct view* view, struct mdb_kernel* kernel,
+               uint32_t frame, uint32_t n)
+{
+        double scale = view->scale;
+
+        if(view->scale_end > 0 && n > 1)
+                scale *= pow(view->scale_end / view->scale,
+                             (double)frame / (n - 1));
+
+        if(view->deep_x
+           && mdb_kernel_set_view_deep(kernel, view->deep_x, view->deep_y,
+                                       scale, view->scale_exp10)
+              == MDB_SUCCESS)
+                return MDB_SUCCESS;
+
+        if(view->scale_exp10)
+                scale *= pow(10, view->scale_exp10);
+
+        return mdb_kernel_set_view(kernel, view->shift_x, view->shift_y,
+                                   scale);
+}
+
+int views_resolve(struct arguments* args)
+{
+        struct arg_sweep* sweep = &args->sweep;
+        size_t i;
+
+        if(sweep->n_view == 1 && sweep->view[0]
+           && strcmp(sweep->view[0], "all") == 0)
+        {
+                for(i = 0; i < ARRAY_SIZE(views); ++i)
+                        sweep->view[i] = (char*)views[i].name;
+
+                sweep->n_view = ARRAY_SIZE(views);
+        }
+
+        for(i = 0; i < sweep->n_view; ++i)
+        {
+                if(sweep->view[i] && !view_find(sweep->view[i]))
+                {
+                        LOG_ERROR("Unknown view '%s', see --view-list.",
+                                  sweep->view[i]);
+                        return MDB_FAIL;
+                }
+        }
+
+        args->view_name = sweep->view[0];
+
+        return MDB_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <kernel/mdb_kernel.h>
+#include <tools/args_parser.h>
+
+/* Named views of the set for benchmarking.
+ *
+ * Static views cover regions with different cost profiles, zoom paths
+ * move to a new region every frame so a frame can't reuse anything
+ * cached by the previous one.
+ */
+
+enum
+{
+        VIEW_EASY,
+        VIEW_MIXED,
+        VIEW_INTERIOR,
+        VIEW_BOUNDARY,
+        VIEW_ZOOM
+};
+
+/* struct view - a named region of the complex plane.
+ *
+ * @shift_x, @shift_y - center of the view.
+ * @scale             - height of the view.
+ * @scale_end         - height at the last frame of a zoom path,
+ *                      0 for a static view. The height changes
+ *                      geometrically towards the same center.
+ * @deep_x, @deep_y   - center as decimal strings for kernels zooming
+ *                      beyond double, NULL if shift_x, shift_y are
+ *                      exact. Heights of such a view are multiplied
+ *                      by 10^scale_exp10, other kernels get the
+ *                      rounded view.
+ */
+struct view
+{
+        const char* name;
+        int type;
+        const char* desc;
+
+        double shift_x, shift_y;
+        double scale;
+        double scale_end;
+
+        const char* deep_x, *deep_y;
+        int scale_exp10;
+};
+
+/* Find a view by name, NULL if there is none */
+const struct view* view_find(const char* name);
+
+const char* view_type_str(int type);
+
+/* Print the whole corpus */
+void views_print(void);
+
+/* Set the kernel view of the frame of n frames */
+int view_apply(const struct view* view, struct mdb_kernel* kernel,
+               uint32_t frame, uint32_t n);
+
+/* Expand "all" in the --view list and check every name.
+ * The first view is stored to args->view_name.
+ */
+int views_resolve(struct arguments* args);
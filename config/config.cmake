@@ -46,6 +46,18 @@ set(CONFIG_LOG_PATH On)
 # If enabled protect logging functions with a mutex
 set(CONFIG_LOG_MULTITHREADING On)
 
+#======================================================
+# Timer parameters                                    #
+#======================================================
+
+# Use the CPU time stamp counter as a default timer for
+# profiling and benchmarking instead of clock_gettime.
+# The TSC is used only if it's invariant, otherwise
+# clock_gettime is used anyway.
+# Can be overridden at run time by --timer option.
+#
+set(CONFIG_TIMER_TSC On)
+
 #======================================================
 # Scheduler parameters                                #
 #======================================================
@@ -60,8 +72,22 @@ set(CONFIG_RSCHED_DEBUG Off)
 # Enable scheduler profiling
 # This records various performance timers and shows statistics on exit
 #
+# Profiling is always built in, the option only enables it from the
+# start. It can be switched with --rsched=profile[,off] or SIGUSR1.
+#
 set(CONFIG_RSCHED_PROFILE Off)
 
+#======================================================
+# Tracing parameters                                  #
+#======================================================
+
+# Build USDT static tracepoints into the scheduler, the kernel
+# loader and the render loop for perf and bpftrace.
+# A probe is a single nop while no tracer is attached.
+# Uses sys/sdt.h if available, otherwise works only on x86-64.
+#
+set(CONFIG_USDT_PROBES On)
+
 #======================================================
 # Kernel parameters                                   #
 #======================================================
@@ -79,6 +105,13 @@ set(CONFIG_MDB_KERNEL_DEBUG Off)
 #
 set(CONFIG_MDB_AVX2_FMA_KERNEL On)
 
+# Enable building a deep zoom kernel using perturbation theory on avx2 and fma.
+# It iterates pixels as double deltas to one reference orbit of the view center
+# computed in fixed point, so views can go far below double range ( ~1e-400 ).
+# Your CPU and compiler must support AVX2 and FMA features.
+#
+set(CONFIG_MDB_PERTURB_KERNEL On)
+
 # Enable building a kernel that using avx2 instruction set ( without using FMA )
 # thus this may be slightly slower than that one above which using FMA.
 # This kernel is also written in intrinsics to maximize performance gain of vectorisation CPU extension.
@@ -48,6 +48,18 @@
 /* If enabled protect logging functions with a mutex */
 #define CONFIG_LOG_MULTITHREADING 1
 
+/* ---------------------------------------------------
+ * Timer parameters
+ * -------------------------------------------------*/
+
+/* Use the CPU time stamp counter as a default timer for
+ * profiling and benchmarking instead of clock_gettime.
+ * The TSC is used only if it's invariant, otherwise
+ * clock_gettime is used anyway.
+ * Can be overridden at run time by --timer option.
+ */
+#define CONFIG_TIMER_TSC 1
+
 /* ---------------------------------------------------
  * Scheduler parameters
  * -------------------------------------------------*/
@@ -61,9 +73,23 @@
 
 /* Enable scheduler profiling
  * This records various performance timers and shows statistics on exit
+ *
+ * Profiling is always built in, the option only enables it from the
+ * start. It can be switched with --rsched=profile[,off] or SIGUSR1.
  */
 /* #undef CONFIG_RSCHED_PROFILE */
 
+/* ---------------------------------------------------
+ * Tracing parameters
+ * -------------------------------------------------*/
+
+/* Build USDT static tracepoints into the scheduler, the kernel
+ * loader and the render loop for perf and bpftrace.
+ * A probe is a single nop while no tracer is attached.
+ * Uses sys/sdt.h if available, otherwise works only on x86-64.
+ */
+#define CONFIG_USDT_PROBES 1
+
 /* ---------------------------------------------------
  * Kernel parameters
  * -------------------------------------------------*/
@@ -80,6 +106,13 @@
  */
 #define CONFIG_MDB_AVX2_FMA_KERNEL 1
 
+/* Enable building a deep zoom kernel using perturbation theory on avx2 and fma.
+ * It iterates pixels as double deltas to one reference orbit of the view center
+ * computed in fixed point, so views can go far below double range ( ~1e-400 ).
+ * Your CPU and compiler must support AVX2 and FMA features.
+ */
+#define CONFIG_MDB_PERTURB_KERNEL 1
+
 /* Enable building a kernel that using avx2 instruction set ( without using FMA )
  * thus this may be slightly slower than that one above which using FMA.
  * This kernel is also written in intrinsics to maximize performance gain of vectorisation CPU extension.
@@ -6,8 +6,10 @@
 #include <tools/compiler.h>
 #include <tools/log.h>
 #include <tools/error_codes.h>
+#include <tools/usdt.h>
 
 #include <tools/cpu_features.h>
+#include <kernel/mdb_kernel_event.h>
 #include <stdio.h>
 
 
@@ -84,6 +86,13 @@ static int mdb_kernel_load(struct mdb_kernel* mdb, const char* kernel_name)
                  "mdb_kernel_process_block"))
         return MDB_FAIL;
 
+    /* Optional symbol */
+    mdb->block_stats_fun = dlsym(handle, "mdb_kernel_process_block_stats");
+    dlerror();
+
+    mdb->block_iters_fun = dlsym(handle, "mdb_kernel_process_block_iters");
+    dlerror();
+
     if(!load_sym(handle, (void**)&mdb->set_size_fun,
                  "mdb_kernel_set_size"))
         return MDB_FAIL;
@@ -102,6 +111,8 @@ static int mdb_kernel_load(struct mdb_kernel* mdb, const char* kernel_name)
     mdb->dl_handle = handle;
     mdb->state     = MDB_KRN_LOADED;
 
+    MDB_PROBE2(kernel_load, kernel_name, handle);
+
     LOG_SAY("Kernel '%s' has been successfully loaded.", kernel_name);
 
     return MDB_SUCCESS;
@@ -211,11 +222,57 @@ void mdb_kernel_destroy(struct mdb_kernel* mdb)
     free(mdb);
 }
 
+int mdb_kernel_metadata_query(struct mdb_kernel* mdb, int query, char* buff,
+                              uint32_t buff_size)
+{
+    return mdb->metadata_query_fun(query, buff, buff_size);
+}
+
 int mdb_kernel_event(struct mdb_kernel* mdb, int event_type, void* event)
 {
     return mdb->event_handler_fun(event_type, event);
 }
 
+int mdb_kernel_set_bailout(struct mdb_kernel* mdb, uint32_t bailout)
+{
+    struct mdb_event_bailout event = { .bailout = bailout };
+
+    return mdb_kernel_event(mdb, MDB_EVENT_BAILOUT, &event);
+}
+
+int mdb_kernel_set_precision(struct mdb_kernel* mdb, int precision)
+{
+    struct mdb_event_precision event = { .precision = precision };
+
+    return mdb_kernel_event(mdb, MDB_EVENT_PRECISION, &event);
+}
+
+int mdb_kernel_set_view(struct mdb_kernel* mdb, double shift_x,
+                        double shift_y, double scale)
+{
+    struct mdb_event_view event = {
+            .shift_x = shift_x,
+            .shift_y = shift_y,
+            .scale = scale
+    };
+
+    return mdb_kernel_event(mdb, MDB_EVENT_VIEW, &event);
+}
+
+int mdb_kernel_set_view_deep(struct mdb_kernel* mdb, const char* shift_x,
+                             const char* shift_y, double scale,
+                             int scale_exp10)
+{
+    struct mdb_event_view_deep event = {
+            .shift_x = shift_x,
+            .shift_y = shift_y,
+            .scale = scale,
+            .scale_exp10 = scale_exp10
+    };
+
+    return mdb_kernel_event(mdb, MDB_EVENT_VIEW_DEEP, &event);
+}
+
 int mdb_kernel_set_surface(struct mdb_kernel* mdb, struct surface* surf)
 {
     return mdb->set_surface_fun(surf);
@@ -231,3 +288,19 @@ void mdb_kernel_process_block(struct mdb_kernel* mdb, uint32_t x0, uint32_t x1,
 {
     mdb->block_fun(x0, x1, y0, y1);
 }
+
+void mdb_kernel_process_block_stats(struct mdb_kernel* mdb,
+                                    uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    struct mdb_lane_stats* stats)
+{
+    mdb->block_stats_fun(x0, x1, y0, y1, stats);
+}
+
+void mdb_kernel_process_block_iters(struct mdb_kernel* mdb,
+                                    uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+    mdb->block_iters_fun(x0, x1, y0, y1, iters);
+}
@@ -19,9 +19,11 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <surface/surface.h>
 #include <config/config.h>
 #include <kernel/mdb_kernel_meta.h>
+#include <kernel/mdb_kernel_stats.h>
 #include <surface/surface.h>
 
 /* TODO kernel load parameters support
@@ -45,6 +47,14 @@ typedef int (*mdb_kernel_event_handler_t)(int type, void* event_ctx);
 typedef void (*mdb_kernel_process_block_t)(uint32_t x0, uint32_t x1,
                                            uint32_t y0, uint32_t y1);
 
+typedef void (*mdb_kernel_process_block_stats_t)(uint32_t x0, uint32_t x1,
+                                                 uint32_t y0, uint32_t y1,
+                                                 struct mdb_lane_stats* stats);
+
+typedef void (*mdb_kernel_process_block_iters_t)(uint32_t x0, uint32_t x1,
+                                                 uint32_t y0, uint32_t y1,
+                                                 uint64_t* iters);
+
 typedef int (*mdb_kernel_set_size_t)(uint32_t width, uint32_t height);
 
 typedef int (*mdb_kernel_set_surface_t)(struct surface* surf);
@@ -67,6 +77,13 @@ struct mdb_kernel
         mdb_kernel_metadata_query_t metadata_query_fun;
         mdb_kernel_event_handler_t  event_handler_fun;
         mdb_kernel_process_block_t  block_fun;
+
+        /* Optional, NULL if the kernel doesn't count lane utilization */
+        mdb_kernel_process_block_stats_t block_stats_fun;
+
+        /* Optional, NULL if the kernel doesn't count iterations */
+        mdb_kernel_process_block_iters_t block_iters_fun;
+
         mdb_kernel_set_size_t       set_size_fun;
         mdb_kernel_set_surface_t    set_surface_fun;
 
@@ -84,9 +101,35 @@ int mdb_kernel_create(struct mdb_kernel** pmdb, const char* kernel_name);
 /* Destroy kernel and release all resources */
 void mdb_kernel_destroy(struct mdb_kernel* mdb);
 
+/* Query kernel metadata ( see mdb_kernel_meta.h ) as a string to buff.
+ * Returns MDB_QUERY_OK on success.
+ */
+int mdb_kernel_metadata_query(struct mdb_kernel* mdb, int query, char* buff,
+                              uint32_t buff_size);
+
 /* Create a new event in the kernel */
 int mdb_kernel_event(struct mdb_kernel* mdb, int event_type, void* event);
 
+/* Set max iteration depth of the kernel ( MDB_EVENT_BAILOUT ) */
+int mdb_kernel_set_bailout(struct mdb_kernel* mdb, uint32_t bailout);
+
+/* Set floating point precision of the kernel ( MDB_EVENT_PRECISION ),
+ * fails if the kernel doesn't support it.
+ */
+int mdb_kernel_set_precision(struct mdb_kernel* mdb, int precision);
+
+/* Set the viewed region of the kernel ( MDB_EVENT_VIEW ) */
+int mdb_kernel_set_view(struct mdb_kernel* mdb, double shift_x,
+                        double shift_y, double scale);
+
+/* Set the viewed region with the center as decimal strings and the
+ * height scale * 10^scale_exp10 ( MDB_EVENT_VIEW_DEEP ), fails if the
+ * kernel can't zoom beyond double.
+ */
+int mdb_kernel_set_view_deep(struct mdb_kernel* mdb, const char* shift_x,
+                             const char* shift_y, double scale,
+                             int scale_exp10);
+
 /* Set dimensions of the kernel */
 int mdb_kernel_set_size(struct mdb_kernel* mdb, uint32_t width, uint32_t height);
 
@@ -98,3 +141,35 @@ int mdb_kernel_set_surface(struct mdb_kernel* mdb, struct surface* surf);
  */
 void mdb_kernel_process_block(struct mdb_kernel* mdb, uint32_t x0, uint32_t x1,
                               uint32_t y0, uint32_t y1);
+
+/* Returns true if the kernel can count SIMD lane utilization */
+static inline
+bool mdb_kernel_has_lane_stats(struct mdb_kernel* mdb)
+{
+        return mdb->block_stats_fun != NULL;
+}
+
+/* Same as mdb_kernel_process_block but also adds SIMD lane utilization
+ * of the block to stats, the kernel must support it.
+ */
+void mdb_kernel_process_block_stats(struct mdb_kernel* mdb,
+                                    uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    struct mdb_lane_stats* stats);
+
+/* Returns true if the kernel can count escape-time iterations */
+static inline
+bool mdb_kernel_has_iter_stats(struct mdb_kernel* mdb)
+{
+        return mdb->block_iters_fun != NULL;
+}
+
+/* Same as mdb_kernel_process_block but also adds the count of escape-time
+ * iterations of the block to iters, the kernel must support it.
+ * Neighbour blocks share their edge row and column, each pixel is counted
+ * only by one of them, so a frame counts every pixel of the surface once.
+ */
+void mdb_kernel_process_block_iters(struct mdb_kernel* mdb,
+                                    uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 enum
 {
 
@@ -202,7 +204,29 @@ enum
 
 enum
 {
-        MDB_EVENT_KEYBOARD = 0x100
+        MDB_EVENT_KEYBOARD = 0x100,
+
+        /* Set max iteration depth, struct mdb_event_bailout */
+        MDB_EVENT_BAILOUT  = 0x101,
+
+        /* Set the viewed region, struct mdb_event_view */
+        MDB_EVENT_VIEW     = 0x102,
+
+        /* Set floating point precision, struct mdb_event_precision */
+        MDB_EVENT_PRECISION = 0x103,
+
+        /* Set the viewed region beyond double range,
+         * struct mdb_event_view_deep
+         */
+        MDB_EVENT_VIEW_DEEP = 0x104
+};
+
+enum
+{
+        /* Float while it resolves pixels of the view, double below */
+        MDB_PRECISION_AUTO   = 0,
+        MDB_PRECISION_FLOAT  = 1,
+        MDB_PRECISION_DOUBLE = 2
 };
 
 
@@ -214,3 +238,34 @@ struct mdb_event_keyboard
         int action;
         int mods;
 };
+
+struct mdb_event_bailout
+{
+        uint32_t bailout;
+};
+
+/* Center of the view and its height in the complex plane */
+struct mdb_event_view
+{
+        double shift_x;
+        double shift_y;
+        double scale;
+};
+
+struct mdb_event_precision
+{
+        int precision;
+};
+
+/* Same as mdb_event_view for kernels that zoom deeper than double
+ * allows. The center is a decimal string of any length like
+ * "-1.2500000000000000000000000001", the height is
+ * scale * 10^scale_exp10.
+ */
+struct mdb_event_view_deep
+{
+        const char* shift_x;
+        const char* shift_y;
+        double scale;
+        int scale_exp10;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+/* struct mdb_lane_stats - SIMD lane utilization of processed blocks.
+ *
+ * @issued - lane-iterations issued: vector iterations times vector width.
+ * @active - lane-iterations of lanes which hadn't escaped yet.
+ *
+ * A vector keeps iterating until its slowest lane escapes, active / issued
+ * is the lane efficiency and the rest is lost to divergence.
+ */
+struct mdb_lane_stats
+{
+        uint64_t issued;
+        uint64_t active;
+};
@@ -5,6 +5,7 @@
 
 #include <kernel/mdb_kernel_meta.h>
 #include <kernel/mdb_kernel_event.h>
+#include <kernel/mdb_kernel_stats.h>
 #include <tools/error_codes.h>
 #include <tools/cpu_features.h>
 #include <tools/compiler.h>
@@ -14,6 +15,22 @@ __hot
 __export_symbol
 void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                               uint32_t y0, uint32_t y1);
+/* Optional. Same as mdb_kernel_process_block but also adds SIMD lane
+ * utilization of the block to stats. Kernels without vector loops
+ * don't export it.
+ */
+__export_symbol
+void mdb_kernel_process_block_stats(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    struct mdb_lane_stats* stats);
+/* Optional. Same as mdb_kernel_process_block but also adds the count of
+ * escape-time iterations of the block to iters, a pixel takes the
+ * iteration it escapes at plus one or bailout if it doesn't.
+ */
+__export_symbol
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters);
 __export_symbol
 int mdb_kernel_set_surface(struct surface* surf);
 __export_symbol
@@ -553,9 +553,43 @@ mdb_kernel_set_surface:
     mov [surface_ptr],rdi
     ret
 
+%define MDB_EVENT_BAILOUT 0x101
+%define MDB_EVENT_VIEW    0x102
+%define MDB_EVENT_PRECISION 0x103
+%define MDB_PRECISION_FLOAT 1
+
 ; rdi - type
 ; rsi - pointer to event
 mdb_kernel_event_handler:
+    cmp edi,MDB_EVENT_BAILOUT
+    je .bailout
+    cmp edi,MDB_EVENT_VIEW
+    je .view
+    cmp edi,MDB_EVENT_PRECISION
+    je .precision
+    ; unknown events, MDB_FAIL lets the host fall back
+    mov rax,-1
+    ret
+.precision:
+    ; struct mdb_event_precision - int precision, float only
+    cmp dword [rsi],MDB_PRECISION_FLOAT
+    je .exit
+    mov rax,-1
+    ret
+.bailout:
+    mov eax,[rsi]
+    mov [bailout_si],eax
+    jmp .exit
+.view:
+    ; struct mdb_event_view - double shift_x, shift_y, scale
+    vcvtsd2ss xmm0,xmm0,[rsi]
+    vcvtsd2ss xmm1,xmm1,[rsi+8]
+    vcvtsd2ss xmm2,xmm2,[rsi+16]
+    vmovss [shift_x_ss],xmm0
+    vmovss [shift_y_ss],xmm1
+    vmovss [scale_ss],xmm2
+    call mdb_kernel_submit_changes
+.exit:
     xor rax,rax
     ret
 
@@ -10,6 +10,8 @@
 GLOBAL_VAR_INIT(const char*, name, "Mandelbrot AVX2 intrinsic kernel");
 GLOBAL_VAR_INIT(const char*, ver_maj, "1");
 GLOBAL_VAR_INIT(const char*, ver_min, "0");
+GLOBAL_VAR_INIT(uint32_t, precisions, PRECISION_BIT(MDB_PRECISION_FLOAT));
+GLOBAL_VAR_INIT(mdb_event_hook_t, event_hook, NULL);
 
 
 int mdb_kernel_cpu_features(void)
@@ -17,8 +19,10 @@ int mdb_kernel_cpu_features(void)
         return CPU_FEATURE_AVX2;
 }
 
+/* n_iter - set to the count of vector iterations made */
 static inline
-__m256 mdb_point_probe(__m256 v_cx, __m256 v_cy, uint32_t bailout)
+__m256 mdb_point_probe(__m256 v_cx, __m256 v_cy, uint32_t bailout,
+                       uint32_t* n_iter)
 {
         __m256 v_zx2, v_zy2, v_zxzy;
         __m256 v_zx = v_cx;
@@ -67,11 +71,39 @@ __m256 mdb_point_probe(__m256 v_cx, __m256 v_cy, uint32_t bailout)
 
         }
 
+        *n_iter = i < bailout ? i + 1 : bailout;
+
         return v_i;
 }
 
-void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
-                              uint32_t y0, uint32_t y1)
+/* Add lane utilization of one vector, n is the count of vector iterations.
+ * A lane is active until the iteration it escapes at, so it's active for
+ * min(v_i + 1, n) iterations. Only the first lanes are on pixels the
+ * block owns, the rest are issued but never counted active.
+ */
+static inline
+void lane_stats_add(struct mdb_lane_stats* stats, __m256 v_i, uint32_t n,
+                    uint32_t lanes)
+{
+        __aligned(32) float active[8];
+        __m256 v_active;
+        uint32_t k;
+
+        v_active = _mm256_add_ps(v_i, _mm256_set1_ps(1));
+        v_active = _mm256_min_ps(v_active, _mm256_set1_ps(n));
+
+        _mm256_store_ps(active, v_active);
+
+        for(k = 0; k < lanes; ++k)
+                stats->active += (uint64_t)active[k];
+
+        stats->issued += 8 * (uint64_t)n;
+}
+
+/* stats is NULL in the plain version, the counting is compiled out */
+static __always_inline
+void process_block(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   struct mdb_lane_stats* stats)
 {
         __m256 v_scale = _mm256_set1_ps(mdb.scale);
         __m256 v_shift_x = _mm256_set1_ps(mdb.shift_x);
@@ -86,6 +118,9 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
 
         uint32_t y, x;
 
+        uint32_t x_end = mdb_block_end(x1, mdb.width);
+        uint32_t y_end = mdb_block_end(y1, mdb.height);
+
         __aligned(32) float pixels[8];
 
         for (y = y0; y <= y1; ++y)
@@ -98,9 +133,10 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                 v_cy = _mm256_mul_ps(v_cy, v_scale);
                 v_cy = _mm256_add_ps(v_cy, v_shift_y);
 
-                for (x = x0; x < x1; x += 8)
+                for (x = x0; x < x_end; x += 8)
                 {
                         __m256 v_i;
+                        uint32_t n_iter;
                         __m256 v_bailout;
                         __m256 bailout_mask;
 
@@ -115,7 +151,11 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         v_cx = _mm256_add_ps(v_cx, v_shift_x);
 
 
-                        v_i = mdb_point_probe(v_cx, v_cy, bailout);
+                        v_i = mdb_point_probe(v_cx, v_cy, bailout, &n_iter);
+
+                        if(stats && y < y_end)
+                                lane_stats_add(stats, v_i, n_iter,
+                                               MIN(x_end - x, 8));
 
                         v_bailout = _mm256_set1_ps(bailout);
                         bailout_mask = _mm256_cmp_ps(v_i, v_bailout, _CMP_NEQ_OQ);
@@ -129,4 +169,32 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         surface_set_pixels(mdb.surf, x, y, 8, pixels);
                 }
         }
-}
\ No newline at end of file
+}
+
+__hot
+void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
+                              uint32_t y0, uint32_t y1)
+{
+        process_block(x0, x1, y0, y1, NULL);
+}
+
+void mdb_kernel_process_block_stats(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    struct mdb_lane_stats* stats)
+{
+        process_block(x0, x1, y0, y1, stats);
+}
+
+/* Every lane is active until it escapes, so active lane-iterations
+ * are the escape-time iterations of the block.
+ */
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+        struct mdb_lane_stats stats = {0, 0};
+
+        process_block(x0, x1, y0, y1, &stats);
+
+        *iters += stats.active;
+}
@@ -1,4 +1,7 @@
 #include <immintrin.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
 
 #include <mandelbrot/mdb_kernel_common.h>
 
@@ -13,6 +16,18 @@
 GLOBAL_VAR_INIT(const char*, name, "Mandelbrot AVX2 FMA intrinsic kernel");
 GLOBAL_VAR_INIT(const char*, ver_maj, "1");
 GLOBAL_VAR_INIT(const char*, ver_min, "0");
+GLOBAL_VAR_INIT(uint32_t, precisions,
+                PRECISION_BIT(MDB_PRECISION_AUTO)
+                | PRECISION_BIT(MDB_PRECISION_FLOAT)
+                | PRECISION_BIT(MDB_PRECISION_DOUBLE));
+GLOBAL_VAR_INIT(mdb_event_hook_t, event_hook, NULL);
+
+/* In auto precision float is used while a pixel step spans at least
+ * FLOAT_MIN_ULPS float ulps of the largest coordinate in view, the
+ * margin absorbs rounding errors accumulating over iterations.
+ * Doubles run half as many lanes, so they're used only below that.
+ */
+#define FLOAT_MIN_ULPS 8
 
 int mdb_kernel_cpu_features(void)
 {
@@ -39,8 +54,10 @@ void set_pixels(__m256 v_i, uint32_t x, uint32_t y, uint32_t bailout)
         surface_set_pixels(mdb.surf, x, y, 8, pixels);
 }
 
+/* n_iter - set to the count of vector iterations made */
 static inline
-__m256 mdb_point_probe(__m256 v_cx, __m256 v_cy, uint32_t bailout)
+__m256 mdb_point_probe(__m256 v_cx, __m256 v_cy, uint32_t bailout,
+                       uint32_t* n_iter)
 {
         __m256 v_zy2_cx, v_zx1, v_zy1, v_zxzy_cy;
         __m256 v_zx = v_cx;
@@ -96,12 +113,38 @@ __m256 mdb_point_probe(__m256 v_cx, __m256 v_cy, uint32_t bailout)
                         break;
         }
 
+        *n_iter = i < bailout ? i + 1 : bailout;
+
         return v_i;
 }
 
-__hot
-void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
-                              uint32_t y0, uint32_t y1)
+/* Add lane utilization of one vector, n is the count of vector iterations.
+ * A lane is active until the iteration it escapes at, so it's active for
+ * min(v_i + 1, n) iterations. Only the first lanes are on pixels the
+ * block owns, the rest are issued but never counted active.
+ */
+static inline
+void lane_stats_add(struct mdb_lane_stats* stats, __m256 v_i, uint32_t n,
+                    uint32_t lanes)
+{
+        __aligned(32) float active[8];
+        __m256 v_active;
+        uint32_t k;
+
+        v_active = _mm256_add_ps(v_i, _mm256_set1_ps(1));
+        v_active = _mm256_min_ps(v_active, _mm256_set1_ps(n));
+
+        _mm256_store_ps(active, v_active);
+
+        for(k = 0; k < lanes; ++k)
+                stats->active += (uint64_t)active[k];
+
+        stats->issued += 8 * (uint64_t)n;
+}
+
+static __always_inline
+void process_block_ps(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                      struct mdb_lane_stats* stats)
 {
 
         __m256 v_scale = _mm256_set1_ps(mdb.scale);
@@ -115,6 +158,9 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
         __m256 v_height_r = _mm256_set1_ps(mdb.height_r);
         __m256 v_wxh = _mm256_set1_ps(mdb.aspect_ratio);
 
+        uint32_t x_end = mdb_block_end(x1, mdb.width);
+        uint32_t y_end = mdb_block_end(y1, mdb.height);
+
         uint32_t y;
         for (y = y0; y <= y1; ++y)
         {
@@ -125,9 +171,10 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                 v_cy = _mm256_fmadd_ps(v_cy, v_height_r, v_center);
                 v_cy = _mm256_fmadd_ps(v_cy, v_scale, v_shift_y);
 
-                for (x = x0; x < x1; x += 8)
+                for (x = x0; x < x_end; x += 8)
                 {
                         __m256 v_i;
+                        uint32_t n_iter;
 
                         v_cx = _mm256_set_ps(x + 7, x + 6, x + 5, x + 4,
                                              x + 3, x + 2, x + 1, x + 0);
@@ -138,9 +185,211 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         v_cx = _mm256_fmadd_ps(v_cx, v_scale, v_shift_x);
 
 
-                        v_i = mdb_point_probe(v_cx, v_cy, bailout);
+                        v_i = mdb_point_probe(v_cx, v_cy, bailout, &n_iter);
+
+                        if(stats && y < y_end)
+                                lane_stats_add(stats, v_i, n_iter,
+                                               MIN(x_end - x, 8));
 
                         set_pixels(v_i, x, y, bailout);
                 }
         }
 }
+
+static inline
+void set_pixels_pd(__m256d v_i, uint32_t x, uint32_t y, uint32_t bailout)
+{
+        __aligned(16) float pixels[4];
+        __m128 v_if;
+        __m128 v_bailout;
+        __m128 bailout_mask;
+
+        v_if = _mm256_cvtpd_ps(v_i);
+
+        v_bailout = _mm_set1_ps(bailout);
+        bailout_mask = _mm_cmp_ps(v_if, v_bailout, _CMP_NEQ_OQ);
+
+        v_if = _mm_and_ps(v_if, bailout_mask);
+
+        v_if = _mm_div_ps(v_if, v_bailout);
+
+        _mm_store_ps(pixels, v_if);
+
+        surface_set_pixels(mdb.surf, x, y, 4, pixels);
+}
+
+/* Same as mdb_point_probe for 4 points in double precision */
+static inline
+__m256d mdb_point_probe_pd(__m256d v_cx, __m256d v_cy, uint32_t bailout,
+                           uint32_t* n_iter)
+{
+        __m256d v_zy2_cx, v_zx1, v_zy1, v_zxzy_cy;
+        __m256d v_zx = v_cx;
+        __m256d v_zy = v_cy;
+
+        __m256d v_mag2;
+        __m256d bound_mask;
+        __m256d add_mask;
+
+        int zero_mask;
+        uint32_t i = 0;
+
+        __m256d v_i = _mm256_set1_pd(i);
+        __m256d v_bound2 = _mm256_set1_pd(4);
+        __m256d v_one = _mm256_set1_pd(1);
+
+        for (; i < bailout; ++i)
+        {
+                v_zy2_cx = _mm256_fmsub_pd(v_zy, v_zy, v_cx);
+                v_zx1 = _mm256_fmsub_pd(v_zx, v_zx, v_zy2_cx);
+
+                v_zxzy_cy = _mm256_fmadd_pd(v_zx, v_zy, v_cy);
+                v_zy1 = _mm256_fmadd_pd(v_zx, v_zy, v_zxzy_cy);
+
+                v_mag2 = _mm256_fmadd_pd(v_zx1, v_zx1,
+                                         _mm256_mul_pd(v_zy1, v_zy1));
+
+                bound_mask = _mm256_cmp_pd(v_mag2, v_bound2, _CMP_LT_OQ);
+
+                zero_mask = _mm256_movemask_pd(bound_mask);
+
+                if (zero_mask)
+                {
+                        add_mask = _mm256_and_pd(bound_mask, v_one);
+                        v_i = _mm256_add_pd(v_i, add_mask);
+
+                        v_zx = v_zx1;
+                        v_zy = v_zy1;
+                }
+                else
+                        break;
+        }
+
+        *n_iter = i < bailout ? i + 1 : bailout;
+
+        return v_i;
+}
+
+static inline
+void lane_stats_add_pd(struct mdb_lane_stats* stats, __m256d v_i,
+                       uint32_t n, uint32_t lanes)
+{
+        __aligned(32) double active[4];
+        __m256d v_active;
+        uint32_t k;
+
+        v_active = _mm256_add_pd(v_i, _mm256_set1_pd(1));
+        v_active = _mm256_min_pd(v_active, _mm256_set1_pd(n));
+
+        _mm256_store_pd(active, v_active);
+
+        for(k = 0; k < lanes; ++k)
+                stats->active += (uint64_t)active[k];
+
+        stats->issued += 4 * (uint64_t)n;
+}
+
+/* Pixel coordinates are computed from the double view directly,
+ * without the float reciprocals of the size.
+ */
+static __always_inline
+void process_block_pd(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                      struct mdb_lane_stats* stats)
+{
+        __m256d v_scale = _mm256_set1_pd(mdb.scale);
+        __m256d v_shift_x = _mm256_set1_pd(mdb.shift_x);
+        __m256d v_shift_y = _mm256_set1_pd(mdb.shift_y);
+        __m256d v_center = _mm256_set1_pd(-0.5);
+
+        uint32_t bailout = mdb.bailout;
+
+        __m256d v_height_r = _mm256_set1_pd(1.0 / mdb.height);
+
+        uint32_t x_end = mdb_block_end(x1, mdb.width);
+        uint32_t y_end = mdb_block_end(y1, mdb.height);
+
+        uint32_t y;
+        for (y = y0; y <= y1; ++y)
+        {
+                __m256d v_cy, v_cx;
+                uint32_t x;
+
+                v_cy = _mm256_set1_pd(y);
+                v_cy = _mm256_fmadd_pd(v_cy, v_height_r, v_center);
+                v_cy = _mm256_fmadd_pd(v_cy, v_scale, v_shift_y);
+
+                for (x = x0; x < x_end; x += 4)
+                {
+                        __m256d v_i;
+                        uint32_t n_iter;
+
+                        /* x * width_r * aspect_ratio is x / height */
+                        v_cx = _mm256_set_pd(x + 3, x + 2, x + 1, x + 0);
+
+                        v_cx = _mm256_fmadd_pd(v_cx, v_height_r, v_center);
+                        v_cx = _mm256_fmadd_pd(v_cx, v_scale, v_shift_x);
+
+                        v_i = mdb_point_probe_pd(v_cx, v_cy, bailout,
+                                                 &n_iter);
+
+                        if(stats && y < y_end)
+                                lane_stats_add_pd(stats, v_i, n_iter,
+                                                  MIN(x_end - x, 4));
+
+                        set_pixels_pd(v_i, x, y, bailout);
+                }
+        }
+}
+
+static inline
+bool use_double(void)
+{
+        double step, mag;
+
+        if(mdb.precision != MDB_PRECISION_AUTO)
+                return mdb.precision == MDB_PRECISION_DOUBLE;
+
+        step = mdb.scale / mdb.height;
+        mag = MAX(fabs(mdb.shift_x), fabs(mdb.shift_y)) + mdb.scale;
+
+        return step < mag * FLT_EPSILON * FLOAT_MIN_ULPS;
+}
+
+/* stats is NULL in the plain version, the counting is compiled out */
+static __always_inline
+void process_block(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   struct mdb_lane_stats* stats)
+{
+        if(use_double())
+                process_block_pd(x0, x1, y0, y1, stats);
+        else
+                process_block_ps(x0, x1, y0, y1, stats);
+}
+
+__hot
+void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
+                              uint32_t y0, uint32_t y1)
+{
+        process_block(x0, x1, y0, y1, NULL);
+}
+
+void mdb_kernel_process_block_stats(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    struct mdb_lane_stats* stats)
+{
+        process_block(x0, x1, y0, y1, stats);
+}
+
+/* Every lane is active until it escapes, so active lane-iterations
+ * are the escape-time iterations of the block.
+ */
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+        struct mdb_lane_stats stats = {0, 0};
+
+        process_block(x0, x1, y0, y1, &stats);
+
+        *iters += stats.active;
+}
@@ -4,6 +4,8 @@
 GLOBAL_VAR_INIT(const char*, name, "Mandelbrot generic kernel");
 GLOBAL_VAR_INIT(const char*, ver_maj, "1");
 GLOBAL_VAR_INIT(const char*, ver_min, "0");
+GLOBAL_VAR_INIT(uint32_t, precisions, PRECISION_BIT(MDB_PRECISION_FLOAT));
+GLOBAL_VAR_INIT(mdb_event_hook_t, event_hook, NULL);
 
 
 int mdb_kernel_cpu_features(void)
@@ -16,10 +18,15 @@ int mdb_kernel_cpu_features(void)
  * without any vector extension like mmx,sse,avx,fma, etc.
  * and force it to use x87 math coprocessor instead of the default sse on x86-64
  */
-__attribute__((target("arch=x86-64,no-mmx,no-sse,no-sse2,no-sse3,no-ssse3,"
-                      "no-sse4,no-avx,no-avx2,no-fma")))
-void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
-                              uint32_t y0, uint32_t y1)
+#define GENERIC_TARGET \
+        __attribute__((target("arch=x86-64,no-mmx,no-sse,no-sse2,no-sse3," \
+                              "no-ssse3,no-sse4,no-avx,no-avx2,no-fma")))
+
+/* iters is NULL in the plain version, the counting is compiled out */
+GENERIC_TARGET
+static __always_inline
+void process_block(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   uint64_t* iters)
 {
         const float scale = mdb.scale;
         const float shift_x = mdb.shift_x;
@@ -32,6 +39,9 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
 
         const uint32_t bailout = mdb.bailout;
         const float di = (float) 1 / bailout;
+        const uint32_t x_end = mdb_block_end(x1, mdb.width);
+        const uint32_t y_end = mdb_block_end(y1, mdb.height);
+        uint64_t count = 0;
         uint32_t y, x;
         uint32_t i;
         float cy, cx, zx, zy, zx2, zy2, zxzy, mag2, norm_color;
@@ -75,6 +85,9 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                                         break;
                         }
 
+                        if(iters && x < x_end && y < y_end)
+                                count += i < bailout ? i + 1 : bailout;
+
                         if (i == bailout)
                                 i = 0;
 
@@ -83,5 +96,22 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         surface_set_pixels(mdb.surf, x, y, 1, &norm_color);
                 }
         }
+
+        if(iters)
+                *iters += count;
 }
 
+GENERIC_TARGET
+void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
+                              uint32_t y0, uint32_t y1)
+{
+        process_block(x0, x1, y0, y1, NULL);
+}
+
+GENERIC_TARGET
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+        process_block(x0, x1, y0, y1, iters);
+}
@@ -72,27 +72,27 @@ static int event_keyboard(struct mdb_event_keyboard* event)
                         break;
 
                 case MDB_KEY_F1:
-                        mdb.scale = 2.793042f;
-                        mdb.shift_x = -0.860787f;
-                        mdb.shift_y = 0.0f;
+                        mdb.scale = 2.793042;
+                        mdb.shift_x = -0.860787;
+                        mdb.shift_y = 0.0;
                         break;
 
                 case MDB_KEY_F2:
-                        mdb.scale = 0.00188964f;
-                        mdb.shift_x = -1.347385054652062f;
-                        mdb.shift_y = -0.063483549665202f;
+                        mdb.scale = 0.00188964;
+                        mdb.shift_x = -1.347385054652062;
+                        mdb.shift_y = -0.063483549665202;
                         break;
 
                 case MDB_KEY_F3:
-                        mdb.shift_x = -0.715882f;
-                        mdb.shift_y = -0.287651f;
-                        mdb.scale = 0.057683f;
+                        mdb.shift_x = -0.715882;
+                        mdb.shift_y = -0.287651;
+                        mdb.scale = 0.057683;
                         break;
 
                 case MDB_KEY_F4:
-                        mdb.shift_x = 0.356868f;
-                        mdb.shift_y = -0.348140f;
-                        mdb.scale = 0.003869f;
+                        mdb.shift_x = 0.356868;
+                        mdb.shift_y = -0.348140;
+                        mdb.scale = 0.003869;
                         break;
 
                 default:
@@ -104,6 +104,40 @@ static int event_keyboard(struct mdb_event_keyboard* event)
         return MDB_SUCCESS;
 }
 
+static void event_view(struct mdb_event_view* event)
+{
+        mdb.shift_x = event->shift_x;
+        mdb.shift_y = event->shift_y;
+        mdb.scale = event->scale;
+}
+
+static const char* precision_str(int precision)
+{
+        switch(precision)
+        {
+        case MDB_PRECISION_AUTO:
+                return "auto";
+        case MDB_PRECISION_FLOAT:
+                return "float";
+        case MDB_PRECISION_DOUBLE:
+                return "double";
+        default:
+                return "unknown";
+        }
+}
+
+static int event_precision(struct mdb_event_precision* event)
+{
+        if(event->precision < 0 || event->precision > MDB_PRECISION_DOUBLE
+           || !(GLOBAL_VAR(precisions) & PRECISION_BIT(event->precision)))
+                return MDB_FAIL;
+
+        mdb.precision = event->precision;
+        KPARAM_INFO("PRECISION", "%s", precision_str(mdb.precision));
+
+        return MDB_SUCCESS;
+}
+
 int mdb_kernel_init(void)
 {
         /* View */
@@ -111,17 +145,17 @@ int mdb_kernel_init(void)
         {
         case 1:
                 mdb.bailout = 1;
-                mdb.scale   = 2.793042f;
-                mdb.shift_x = -0.860787f;
-                mdb.shift_y = 0.0f;
+                mdb.scale   = 2.793042;
+                mdb.shift_x = -0.860787;
+                mdb.shift_y = 0.0;
                 break;
 
         default:
         case 2:
                 mdb.bailout = 256;
-                mdb.scale   = 0.00188964f;
-                mdb.shift_x = -1.347385054652062f;
-                mdb.shift_y = -0.063483549665202f;
+                mdb.scale   = 0.00188964;
+                mdb.shift_x = -1.347385054652062;
+                mdb.shift_y = -0.063483549665202;
                 break;
 
         }
@@ -131,6 +165,11 @@ int mdb_kernel_init(void)
         KPARAM_INFO("SHIFT-X", "%f", mdb.shift_x);
         KPARAM_INFO("SHIFT-Y", "%f", mdb.shift_y);
 
+        /* The first supported of auto, float and double */
+        mdb.precision = __builtin_ctz(GLOBAL_VAR(precisions));
+
+        KPARAM_INFO("PRECISION", "%s", precision_str(mdb.precision));
+
         return MDB_SUCCESS;
 }
 
@@ -142,11 +181,27 @@ int mdb_kernel_shutdown(void)
 
 int mdb_kernel_event_handler(int type, void* event)
 {
+        if(GLOBAL_VAR(event_hook)
+           && GLOBAL_VAR(event_hook)(type, event) == MDB_SUCCESS)
+                return MDB_SUCCESS;
+
         switch(type)
         {
         case MDB_EVENT_KEYBOARD:
                 return event_keyboard((struct mdb_event_keyboard*)event);
 
+        case MDB_EVENT_BAILOUT:
+                mdb.bailout = ((struct mdb_event_bailout*)event)->bailout;
+                KPARAM_INFO("BAILOUT", "%d", mdb.bailout);
+                break;
+
+        case MDB_EVENT_VIEW:
+                event_view((struct mdb_event_view*)event);
+                break;
+
+        case MDB_EVENT_PRECISION:
+                return event_precision((struct mdb_event_precision*)event);
+
         default:
                 return MDB_FAIL;
         }
@@ -11,13 +11,16 @@ struct mdb_t
         uint32_t bailout;
         uint32_t width;
         uint32_t height;
-        float shift_x;
-        float shift_y;
-        float scale;
+        double shift_x;
+        double shift_y;
+        double scale;
         struct surface* surf;
         float width_r;
         float height_r;
         float aspect_ratio;
+
+        /* MDB_PRECISION_*, one of GLOBAL_VAR(precisions) */
+        int precision;
 };
 
 struct mdb_t mdb;
@@ -25,3 +28,26 @@ struct mdb_t mdb;
 GLOBAL_VAR_DEFINE(const char*, name);
 GLOBAL_VAR_DEFINE(const char*, ver_maj);
 GLOBAL_VAR_DEFINE(const char*, ver_min);
+
+/* Bitmask of supported precisions, see PRECISION_BIT */
+GLOBAL_VAR_DEFINE(uint32_t, precisions);
+
+#define PRECISION_BIT(p) (1u << (p))
+
+/* Kernel handler called before the common one, which runs only if
+ * it returns MDB_FAIL. NULL in kernels without their own events.
+ */
+typedef int (*mdb_event_hook_t)(int type, void* event);
+
+GLOBAL_VAR_DEFINE(mdb_event_hook_t, event_hook);
+
+/* Neighbour blocks share their edge row and column. A block owns
+ * [v0, end) where end is v1, or v1 + 1 if v1 is the last row or column
+ * of the surface, so every pixel is owned by exactly one block.
+ * Kernels render at least the owned pixels and count only them.
+ */
+static inline
+uint32_t mdb_block_end(uint32_t v1, uint32_t size)
+{
+        return v1 == size - 1 ? v1 + 1 : v1;
+}
@@ -6,6 +6,8 @@
 GLOBAL_VAR_INIT(const char*, name, "Mandelbrot native kernel");
 GLOBAL_VAR_INIT(const char*, ver_maj, "1");
 GLOBAL_VAR_INIT(const char*, ver_min, "0");
+GLOBAL_VAR_INIT(uint32_t, precisions, PRECISION_BIT(MDB_PRECISION_FLOAT));
+GLOBAL_VAR_INIT(mdb_event_hook_t, event_hook, NULL);
 
 int mdb_kernel_cpu_features(void)
 {
@@ -303,12 +305,35 @@ void vec8i_cvt2_vec8f(struct vec8* vf, const struct vec8* vi)
         vf->f7 = (float)vi->i7;
 }
 
-void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
-                              uint32_t y0, uint32_t y1)
+/* Iterations of a vector of pixels, a lane takes the iteration it
+ * escapes at plus one or bailout if it doesn't. Only the first lanes
+ * are on pixels the block owns, the rest aren't counted.
+ */
+static inline
+uint64_t vec8i_iters(const struct vec8* vi, uint32_t bailout,
+                     uint32_t lanes)
+{
+        uint64_t n = 0;
+        uint32_t k;
+
+        for(k = 0; k < lanes; ++k)
+                n += MIN((uint32_t)vi->i[k] + 1, bailout);
+
+        return n;
+}
+
+/* iters is NULL in the plain version, the counting is compiled out */
+static __always_inline
+void process_block(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   uint64_t* iters)
 {
+        uint64_t count = 0;
         uint32_t y, x;
         uint32_t i;
 
+        const uint32_t x_end = mdb_block_end(x1, mdb.width);
+        const uint32_t y_end = mdb_block_end(y1, mdb.height);
+
         const uint32_t bailout = mdb.bailout;
 
         struct vec8 scale, shift_x, shift_y, center, width_r, height_r, wxh;
@@ -376,6 +401,10 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
 
                         }
 
+                        if(iters && y < y_end && x < x_end)
+                                count += vec8i_iters(&vi, bailout,
+                                                     MIN(x_end - x, 8));
+
                         vec8i_ne3_mask_s(&mask, &vi, bailout);
                         vec8i_and2_v(&vi, &mask);
 
@@ -385,4 +414,20 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         surface_set_pixels(mdb.surf, x, y, 8, vi.f);
                 }
         }
+
+        if(iters)
+                *iters += count;
+}
+
+void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
+                              uint32_t y0, uint32_t y1)
+{
+        process_block(x0, x1, y0, y1, NULL);
+}
+
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+        process_block(x0, x1, y0, y1, iters);
 }
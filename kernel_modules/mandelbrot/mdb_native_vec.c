@@ -7,6 +7,8 @@
 GLOBAL_VAR_INIT(const char*, name, "Mandelbrot native kernel");
 GLOBAL_VAR_INIT(const char*, ver_maj, "1");
 GLOBAL_VAR_INIT(const char*, ver_min, "0");
+GLOBAL_VAR_INIT(uint32_t, precisions, PRECISION_BIT(MDB_PRECISION_FLOAT));
+GLOBAL_VAR_INIT(mdb_event_hook_t, event_hook, NULL);
 
 int mdb_kernel_cpu_features(void)
 {
@@ -101,14 +103,36 @@ void vec8f_store(float* dst, vec8f* v)
 #endif
 
 
-void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
-                              uint32_t y0, uint32_t y1)
+/* Iterations of a vector of pixels, a lane takes the iteration it
+ * escapes at plus one or bailout if it doesn't. Only the first lanes
+ * are on pixels the block owns, the rest aren't counted.
+ */
+static inline
+uint64_t vec8i_iters(vec8i* vi, uint32_t bailout, uint32_t lanes)
+{
+        uint64_t n = 0;
+        uint32_t k;
+
+        for(k = 0; k < lanes; ++k)
+                n += MIN((uint32_t)vec8i_el_at(vi, k) + 1, bailout);
+
+        return n;
+}
+
+/* iters is NULL in the plain version, the counting is compiled out */
+static __always_inline
+void process_block(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   uint64_t* iters)
 {
         __aligned(32) float pixels[8];
+        uint64_t count = 0;
 
         uint32_t y, x;
         uint32_t i;
 
+        const uint32_t x_end = mdb_block_end(x1, mdb.width);
+        const uint32_t y_end = mdb_block_end(y1, mdb.height);
+
         const uint32_t bailout = mdb.bailout;
 
         vec8f scale, shift_x, shift_y, center, width_r, height_r, wxh;
@@ -190,6 +214,10 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         }
 
 
+                        if(iters && y < y_end && x < x_end)
+                                count += vec8i_iters(&vi, bailout,
+                                                     MIN(x_end - x, 8));
+
                         mask = vi != v_bailout_i;
                         vi &= mask;
 
@@ -201,4 +229,20 @@ void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
                         surface_set_pixels(mdb.surf, x, y, 8, pixels);
                 }
         }
+
+        if(iters)
+                *iters += count;
+}
+
+void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
+                              uint32_t y0, uint32_t y1)
+{
+        process_block(x0, x1, y0, y1, NULL);
+}
+
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+        process_block(x0, x1, y0, y1, iters);
 }
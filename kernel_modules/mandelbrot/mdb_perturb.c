@@ -0,0 +1,1009 @@
+#include <immintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <mandelbrot/mdb_kernel_common.h>
+#include <klog.h>
+
+#if !defined(__AVX2__)
+#error "AVX2 is not enabled. Consider set gcc flags -mavx2"
+#endif
+
+#if !defined(__FMA__)
+#error "FMA is not enabled. Consider set gcc flags -mfma"
+#endif
+
+/* Perturbation kernel for deep zooms.
+ *
+ * The orbit Z of the view center is computed once per view change in
+ * fixed point wide enough for the zoom depth and rounded to doubles.
+ * A pixel at c = C + dc is iterated as its difference dz to that orbit
+ *
+ *   dz' = (2 * Z + dz) * dz + dc
+ *
+ * which stays accurate in double however small dc is. When the pixel
+ * orbit z = Z + dz gets closer to zero than dz, or the reference orbit
+ * ends, dz is rebased onto the start of the reference orbit
+ * (dz = z, Z = 0), this removes the glitches of plain perturbation.
+ *
+ * Views below double range (~1e-308) are scaled by a shared exponent:
+ * deltas start in units of 2^exp, where the dz * dz term is negligible,
+ * and switch to plain doubles once they grow large enough.
+ */
+
+GLOBAL_VAR_INIT(const char*, name, "Mandelbrot AVX2 FMA perturbation kernel");
+GLOBAL_VAR_INIT(const char*, ver_maj, "1");
+GLOBAL_VAR_INIT(const char*, ver_min, "0");
+GLOBAL_VAR_INIT(uint32_t, precisions, PRECISION_BIT(MDB_PRECISION_DOUBLE));
+
+static int perturb_event(int type, void* event);
+
+GLOBAL_VAR_INIT(mdb_event_hook_t, event_hook, &perturb_event);
+
+/* Fixed point words of the center, the first one is the signed integer
+ * part, the rest are the fraction.
+ */
+#define FIX_WORDS 24
+
+/* Bits of the center kept below the pixel step */
+#define FIX_GUARD_BITS 64
+
+/* Smallest height exponent, a 2^16 pixel high view still fits
+ * FIX_WORDS with the guard bits. About 1e-419.
+ */
+#define SCALE_EXP_MIN (-((FIX_WORDS - 1) * 64 - FIX_GUARD_BITS - 16))
+
+/* Deltas are scaled when the height is below 2^SCALED_EXP and go
+ * plain once some lane is above 2^SCALED_DELTA_EXP, dz * dz is far
+ * below double precision of dz until then.
+ */
+#define SCALED_EXP       -960
+#define SCALED_DELTA_EXP -600
+
+int mdb_kernel_cpu_features(void)
+{
+        return CPU_FEATURE_AVX2 | CPU_FEATURE_FMA;
+}
+
+
+/* Signed fixed point number, two's complement, most significant word
+ * first. Functions take the count of words to work on, the rest of
+ * them is ignored.
+ */
+struct fix
+{
+        uint64_t w[FIX_WORDS];
+};
+
+typedef unsigned __int128 uint128_t;
+
+static inline
+bool fix_is_neg(const struct fix* a)
+{
+        return (int64_t)a->w[0] < 0;
+}
+
+static
+void fix_add(struct fix* r, const struct fix* a, const struct fix* b, int n)
+{
+        uint128_t s;
+        uint64_t carry = 0;
+        int i;
+
+        for(i = n - 1; i >= 0; --i)
+        {
+                s = (uint128_t)a->w[i] + b->w[i] + carry;
+                r->w[i] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+        }
+}
+
+static
+void fix_neg(struct fix* r, const struct fix* a, int n)
+{
+        uint128_t s;
+        uint64_t carry = 1;
+        int i;
+
+        for(i = n - 1; i >= 0; --i)
+        {
+                s = (uint128_t)~a->w[i] + carry;
+                r->w[i] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+        }
+}
+
+static
+void fix_sub(struct fix* r, const struct fix* a, const struct fix* b, int n)
+{
+        struct fix nb;
+
+        fix_neg(&nb, b, n);
+        fix_add(r, a, &nb, n);
+}
+
+/* Words below n are truncated, the error is a few units of the last
+ * word.
+ */
+static
+void fix_mul(struct fix* r, const struct fix* a, const struct fix* b, int n)
+{
+        /* t[k + 1] is the word of weight 2^(-64 * k) */
+        uint64_t t[FIX_WORDS + 1];
+        struct fix ua, ub;
+        uint128_t cur;
+        uint64_t carry;
+        bool neg;
+        int i, j;
+
+        neg = fix_is_neg(a) != fix_is_neg(b);
+
+        if(fix_is_neg(a))
+                fix_neg(&ua, a, n);
+        else
+                ua = *a;
+
+        if(fix_is_neg(b))
+                fix_neg(&ub, b, n);
+        else
+                ub = *b;
+
+        t[n] = 0;
+
+        for(i = n - 1; i >= 0; --i)
+        {
+                carry = 0;
+
+                for(j = n - 1 - i; j >= 0; --j)
+                {
+                        cur = (uint128_t)ua.w[i] * ub.w[j] + t[i + j + 1]
+                              + carry;
+                        t[i + j + 1] = (uint64_t)cur;
+                        carry = (uint64_t)(cur >> 64);
+                }
+
+                t[i] = carry;
+        }
+
+        for(i = 0; i < n; ++i)
+                r->w[i] = t[i + 1];
+
+        if(neg)
+                fix_neg(r, r, n);
+}
+
+static
+double fix_to_double(const struct fix* a, int n)
+{
+        struct fix u;
+        double d = 0;
+        int i;
+
+        if(fix_is_neg(a))
+                fix_neg(&u, a, n);
+        else
+                u = *a;
+
+        /* Words past the third are below double precision */
+        for(i = MIN(n, 3) - 1; i >= 0; --i)
+                d += ldexp((double)u.w[i], -64 * i);
+
+        return fix_is_neg(a) ? -d : d;
+}
+
+/* r = m * 2^e */
+static
+void fix_set(struct fix* r, double m, int e, int n)
+{
+        uint64_t mant;
+        int ex, p, f, b;
+
+        memset(r->w, 0, n * sizeof(r->w[0]));
+
+        if(m == 0)
+                return;
+
+        mant = (uint64_t)ldexp(frexp(fabs(m), &ex), 53);
+
+        for(b = 0; b < 53; ++b)
+        {
+                if(!(mant & (1ull << b)))
+                        continue;
+
+                p = ex + e - 53 + b;
+
+                if(p >= 0)
+                {
+                        if(p < 63)
+                                r->w[0] |= 1ull << p;
+                        continue;
+                }
+
+                f = -p - 1;
+                if(1 + f / 64 < n)
+                        r->w[1 + f / 64] |= 1ull << (63 - f % 64);
+        }
+
+        if(m < 0)
+                fix_neg(r, r, n);
+}
+
+/* Non negative a only */
+static
+void fix_div_small(struct fix* r, const struct fix* a, uint64_t d, int n)
+{
+        uint128_t cur;
+        uint64_t rem = 0;
+        int i;
+
+        for(i = 0; i < n; ++i)
+        {
+                cur = ((uint128_t)rem << 64) | a->w[i];
+                r->w[i] = (uint64_t)(cur / d);
+                rem = (uint64_t)(cur % d);
+        }
+}
+
+/* Decimal string like "-0.75" or "3", MDB_FAIL if it isn't one */
+static
+int fix_set_str(struct fix* r, const char* s, int n)
+{
+        const char* frac = NULL;
+        const char* end;
+        uint64_t ipart = 0;
+        bool neg = false;
+        int digits = 0;
+
+        if(*s == '-' || *s == '+')
+                neg = *s++ == '-';
+
+        for(; *s >= '0' && *s <= '9'; ++s, ++digits)
+        {
+                if(ipart > INT32_MAX)
+                        return MDB_FAIL;
+
+                ipart = ipart * 10 + (uint64_t)(*s - '0');
+        }
+
+        if(*s == '.')
+        {
+                frac = ++s;
+
+                for(; *s >= '0' && *s <= '9'; ++s)
+                        ++digits;
+        }
+
+        if(*s || !digits)
+                return MDB_FAIL;
+
+        memset(r->w, 0, n * sizeof(r->w[0]));
+
+        /* 0.d1d2...dk = (d1 + (d2 + ... + (dk) / 10 ...) / 10) / 10 */
+        for(end = s - 1; frac && end >= frac; --end)
+        {
+                r->w[0] += (uint64_t)(*end - '0');
+                fix_div_small(r, r, 10, n);
+        }
+
+        r->w[0] = ipart;
+
+        if(neg)
+                fix_neg(r, r, n);
+
+        return MDB_SUCCESS;
+}
+
+
+/* The view at full depth, mdb.shift_x, shift_y and scale are its
+ * rounded copies used by the common code.
+ */
+static struct
+{
+        struct fix x, y;
+
+        /* Height is scale_m * 2^scale_e, scale_m in [0.5, 1) */
+        double scale_m;
+        int scale_e;
+
+        /* Values last written to mdb, the view is reloaded from mdb when
+         * they differ, i.e. the common code set a new one.
+         */
+        double shift_x, shift_y, scale;
+
+        /* Incremented on every change of the view */
+        uint64_t serial;
+
+        /* Guards the view and the orbit update */
+        pthread_mutex_t lock;
+} view = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+struct orbit
+{
+        /* Z[0] = 0, Z[1] = C, ... Z[last], escaped or Z[bailout + 1] */
+        double* x;
+        double* y;
+        uint32_t last;
+        uint32_t size;
+
+        /* View the orbit is computed for */
+        uint64_t serial;
+        uint32_t bailout;
+        uint32_t height;
+
+        /* dc of a pixel is ((x, y) / height - 0.5) * step in units of
+         * 2^exp, exp is 0 for unscaled views.
+         */
+        double step;
+        int exp;
+};
+
+/* The current orbit is published after it's computed into the other
+ * one. Blocks still running on the old orbit are safe unless the view
+ * changes twice during a block.
+ */
+static struct orbit orbits[2];
+static struct orbit* orbit_cur;
+
+static
+void view_set_scale(double m, int e)
+{
+        int k;
+
+        if(!(m > 0))
+        {
+                m = 0.5;
+                e = SCALE_EXP_MIN;
+        }
+
+        m = frexp(m, &k);
+        e += k;
+
+        if(e < SCALE_EXP_MIN)
+        {
+                m = 0.5;
+                e = SCALE_EXP_MIN;
+        }
+
+        view.scale_m = m;
+        view.scale_e = e;
+}
+
+/* Copy the view to mdb after a change */
+static
+void view_publish(void)
+{
+        view.shift_x = fix_to_double(&view.x, FIX_WORDS);
+        view.shift_y = fix_to_double(&view.y, FIX_WORDS);
+        view.scale = ldexp(view.scale_m, view.scale_e);
+
+        mdb.shift_x = view.shift_x;
+        mdb.shift_y = view.shift_y;
+        mdb.scale = view.scale;
+
+        ++view.serial;
+}
+
+static inline
+bool view_changed(void)
+{
+        return mdb.shift_x != view.shift_x || mdb.shift_y != view.shift_y
+               || mdb.scale != view.scale;
+}
+
+/* Reload the view from mdb if the common code changed it */
+static
+void view_sync(void)
+{
+        if(!view_changed())
+                return;
+
+        fix_set(&view.x, mdb.shift_x, 0, FIX_WORDS);
+        fix_set(&view.y, mdb.shift_y, 0, FIX_WORDS);
+        view_set_scale(mdb.scale, 0);
+
+        view_publish();
+}
+
+static
+void view_log_scale(void)
+{
+        double l10 = log10(view.scale_m) + view.scale_e * log10(2);
+        double e10 = floor(l10);
+
+        KLOG_SAY("scale %fe%+d", pow(10, l10 - e10), (int)e10);
+}
+
+static
+void view_move(struct fix* a, double k)
+{
+        struct fix d;
+
+        fix_set(&d, k * view.scale_m, view.scale_e, FIX_WORDS);
+        fix_add(a, a, &d, FIX_WORDS);
+}
+
+static
+int event_keyboard(struct mdb_event_keyboard* event)
+{
+        if(event->action != MDB_ACTION_PRESS
+           && event->action != MDB_ACTION_REPEAT)
+                return MDB_FAIL;
+
+        switch(event->key)
+        {
+        case MDB_KEY_1:
+                view_set_scale(view.scale_m * 1.1, view.scale_e);
+                view_log_scale();
+                break;
+
+        case MDB_KEY_2:
+                view_set_scale(view.scale_m * 0.9, view.scale_e);
+                view_log_scale();
+                break;
+
+        case MDB_KEY_RIGHT:
+                view_move(&view.x, 0.1);
+                KLOG_SAY("shift x %.17g", fix_to_double(&view.x, FIX_WORDS));
+                break;
+
+        case MDB_KEY_LEFT:
+                view_move(&view.x, -0.1);
+                KLOG_SAY("shift x %.17g", fix_to_double(&view.x, FIX_WORDS));
+                break;
+
+        case MDB_KEY_UP:
+                view_move(&view.y, 0.1);
+                KLOG_SAY("shift y %.17g", fix_to_double(&view.y, FIX_WORDS));
+                break;
+
+        case MDB_KEY_DOWN:
+                view_move(&view.y, -0.1);
+                KLOG_SAY("shift y %.17g", fix_to_double(&view.y, FIX_WORDS));
+                break;
+
+        default:
+                return MDB_FAIL;
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+int event_view_deep(struct mdb_event_view_deep* event)
+{
+        struct fix x, y;
+        double l2, e;
+
+        if(!event->shift_x || !event->shift_y || !(event->scale > 0))
+                return MDB_FAIL;
+
+        if(fix_set_str(&x, event->shift_x, FIX_WORDS) != MDB_SUCCESS
+           || fix_set_str(&y, event->shift_y, FIX_WORDS) != MDB_SUCCESS)
+        {
+                KLOG_ERROR("Invalid view center '%s', '%s'",
+                           event->shift_x, event->shift_y);
+                return MDB_FAIL;
+        }
+
+        l2 = log2(event->scale) + event->scale_exp10 * log2(10);
+        e = floor(l2) + 1;
+
+        view.x = x;
+        view.y = y;
+        view_set_scale(exp2(l2 - e), (int)e);
+
+        return MDB_SUCCESS;
+}
+
+/* Keys changing the view are handled here at full depth, the rest goes
+ * to the common handler.
+ */
+static
+int perturb_event(int type, void* event)
+{
+        int ret;
+
+        switch(type)
+        {
+        case MDB_EVENT_KEYBOARD:
+        case MDB_EVENT_VIEW_DEEP:
+                break;
+
+        default:
+                return MDB_FAIL;
+        }
+
+        pthread_mutex_lock(&view.lock);
+
+        view_sync();
+
+        if(type == MDB_EVENT_KEYBOARD)
+                ret = event_keyboard((struct mdb_event_keyboard*)event);
+        else
+                ret = event_view_deep((struct mdb_event_view_deep*)event);
+
+        if(ret == MDB_SUCCESS)
+                view_publish();
+
+        pthread_mutex_unlock(&view.lock);
+
+        return ret;
+}
+
+static
+int orbit_alloc(struct orbit* o, uint32_t size)
+{
+        double* x, *y;
+
+        if(o->size >= size)
+                return MDB_SUCCESS;
+
+        x = realloc(o->x, size * sizeof(double));
+        if(x)
+                o->x = x;
+
+        y = realloc(o->y, size * sizeof(double));
+        if(y)
+                o->y = y;
+
+        if(!x || !y)
+                return MDB_FAIL;
+
+        o->size = size;
+
+        return MDB_SUCCESS;
+}
+
+/* Iterate the center in fixed point of as many words as the depth
+ * needs, 3 multiplications of them per iteration.
+ */
+static
+int orbit_compute(struct orbit* o)
+{
+        struct fix zx, zy, x2, y2, xy;
+        uint32_t bailout = mdb.bailout;
+        uint32_t height = mdb.height;
+        int bits, n;
+        double dx, dy;
+
+        if(orbit_alloc(o, bailout + 2) != MDB_SUCCESS)
+        {
+                KLOG_ERROR("Failed to allocate the reference orbit");
+                return MDB_FAIL;
+        }
+
+        bits = -view.scale_e + (32 - __builtin_clz(height | 1))
+               + FIX_GUARD_BITS;
+        n = 1 + (MAX(bits, 1) + 63) / 64;
+        n = MIN(n, FIX_WORDS);
+
+        o->x[0] = 0;
+        o->y[0] = 0;
+        o->x[1] = fix_to_double(&view.x, n);
+        o->y[1] = fix_to_double(&view.y, n);
+        o->last = 1;
+
+        zx = view.x;
+        zy = view.y;
+        dx = o->x[1];
+        dy = o->y[1];
+
+        while(o->last <= bailout && dx * dx + dy * dy < 4)
+        {
+                fix_mul(&x2, &zx, &zx, n);
+                fix_mul(&y2, &zy, &zy, n);
+                fix_mul(&xy, &zx, &zy, n);
+
+                /* zx = zx^2 - zy^2 + cx, zy = 2 * zx * zy + cy */
+                fix_sub(&zx, &x2, &y2, n);
+                fix_add(&zx, &zx, &view.x, n);
+                fix_add(&zy, &xy, &xy, n);
+                fix_add(&zy, &zy, &view.y, n);
+
+                dx = fix_to_double(&zx, n);
+                dy = fix_to_double(&zy, n);
+
+                ++o->last;
+                o->x[o->last] = dx;
+                o->y[o->last] = dy;
+        }
+
+        o->exp = view.scale_e < SCALED_EXP ? view.scale_e : 0;
+        o->step = ldexp(view.scale_m, view.scale_e - o->exp);
+
+        o->serial = view.serial;
+        o->bailout = bailout;
+        o->height = height;
+
+        KLOG_VINFO(LOG_VERBOSE2, "Reference orbit of %u points, %d words",
+                   o->last + 1, n);
+
+        return MDB_SUCCESS;
+}
+
+static inline
+bool orbit_valid(const struct orbit* o)
+{
+        return o && o->serial == view.serial && o->bailout == mdb.bailout
+               && o->height == mdb.height && !view_changed();
+}
+
+/* The first block of a new view computes the orbit, the others wait
+ * for it.
+ */
+static
+struct orbit* orbit_get(void)
+{
+        struct orbit* o = __atomic_load_n(&orbit_cur, __ATOMIC_ACQUIRE);
+
+        if(likely(orbit_valid(o)))
+                return o;
+
+        pthread_mutex_lock(&view.lock);
+
+        view_sync();
+
+        o = orbit_cur;
+
+        if(!orbit_valid(o))
+        {
+                o = o == &orbits[0] ? &orbits[1] : &orbits[0];
+
+                if(orbit_compute(o) == MDB_SUCCESS)
+                        __atomic_store_n(&orbit_cur, o, __ATOMIC_RELEASE);
+                else
+                        o = NULL;
+        }
+
+        pthread_mutex_unlock(&view.lock);
+
+        return o;
+}
+
+__attribute__((destructor))
+static
+void orbits_free(void)
+{
+        size_t i;
+
+        for(i = 0; i < ARRAY_SIZE(orbits); ++i)
+        {
+                free(orbits[i].x);
+                free(orbits[i].y);
+        }
+}
+
+
+static inline
+void set_pixels(__m256d v_i, uint32_t x, uint32_t y, uint32_t bailout)
+{
+        __aligned(16) float pixels[4];
+        __m128 v_if;
+        __m128 v_bailout;
+        __m128 bailout_mask;
+
+        v_if = _mm256_cvtpd_ps(v_i);
+
+        v_bailout = _mm_set1_ps(bailout);
+        bailout_mask = _mm_cmp_ps(v_if, v_bailout, _CMP_NEQ_OQ);
+
+        v_if = _mm_and_ps(v_if, bailout_mask);
+
+        v_if = _mm_div_ps(v_if, v_bailout);
+
+        _mm_store_ps(pixels, v_if);
+
+        surface_set_pixels(mdb.surf, x, y, 4, pixels);
+}
+
+static inline
+void lane_stats_add(struct mdb_lane_stats* stats, __m256d v_i, uint32_t n,
+                    uint32_t lanes)
+{
+        __aligned(32) double active[4];
+        __m256d v_active;
+        uint32_t k;
+
+        v_active = _mm256_add_pd(v_i, _mm256_set1_pd(1));
+        v_active = _mm256_min_pd(v_active, _mm256_set1_pd(n));
+
+        _mm256_store_pd(active, v_active);
+
+        for(k = 0; k < lanes; ++k)
+                stats->active += (uint64_t)active[k];
+
+        stats->issued += 4 * (uint64_t)n;
+}
+
+/* Scaled phase, every lane follows the reference in lock step:
+ * dz' = 2 * Z * dz + dc. Ends when a lane outgrows the scaling, the
+ * reference escapes (so do all lanes) or at bailout.
+ *
+ * i, m - iteration and reference index, updated
+ * Returns true if the lanes escaped.
+ */
+static inline
+bool probe_scaled(const struct orbit* o, __m256d* v_dzx, __m256d* v_dzy,
+                  __m256d v_dcx, __m256d v_dcy, uint32_t bailout,
+                  uint32_t* i, uint32_t* m)
+{
+        __m256d v_zx, v_zy, v_dzx1, v_dzy1, v_big;
+        __m256d v_limit = _mm256_set1_pd(ldexp(1, SCALED_DELTA_EXP - o->exp));
+        __m256d v_abs = _mm256_castsi256_pd(_mm256_set1_epi64x(INT64_MAX));
+        double zx, zy;
+
+        for(; *i < bailout && *m < o->last; ++*i)
+        {
+                v_zx = _mm256_set1_pd(2 * o->x[*m]);
+                v_zy = _mm256_set1_pd(2 * o->y[*m]);
+
+                v_dzx1 = _mm256_fmadd_pd(v_zx, *v_dzx,
+                                         _mm256_fnmadd_pd(v_zy, *v_dzy,
+                                                          v_dcx));
+                v_dzy1 = _mm256_fmadd_pd(v_zx, *v_dzy,
+                                         _mm256_fmadd_pd(v_zy, *v_dzx,
+                                                         v_dcy));
+
+                ++*m;
+
+                zx = o->x[*m];
+                zy = o->y[*m];
+                if(zx * zx + zy * zy >= 4)
+                        return true;
+
+                *v_dzx = v_dzx1;
+                *v_dzy = v_dzy1;
+
+                v_big = _mm256_max_pd(_mm256_and_pd(v_dzx1, v_abs),
+                                      _mm256_and_pd(v_dzy1, v_abs));
+                v_big = _mm256_cmp_pd(v_big, v_limit, _CMP_GT_OQ);
+
+                if(_mm256_movemask_pd(v_big))
+                {
+                        ++*i;
+                        break;
+                }
+        }
+
+        return false;
+}
+
+/* Returns escape iterations of 4 pixels like mdb_point_probe of the
+ * other kernels, n_iter - set to the count of vector iterations made.
+ */
+static inline
+__m256d mdb_point_probe(const struct orbit* o, __m256d v_dcx, __m256d v_dcy,
+                        uint32_t bailout, uint32_t* n_iter)
+{
+        __m256d v_dzx = v_dcx, v_dzy = v_dcy;
+        __m256d v_dzx1, v_dzy1, v_tx, v_ty;
+        __m256d v_zx, v_zy, v_refx, v_refy;
+        __m256d v_mag2, v_dmag2;
+        __m256d v_i;
+        __m256d bound_mask, active_mask, rebase_mask;
+        __m256d v_unscale;
+        __m256i v_m, v_last;
+
+        uint32_t i = 0, m = 1;
+
+        /* Lanes share the reference index m until they rebase apart,
+         * then v_m holds one per lane and the orbit is gathered.
+         */
+        bool uniform = true;
+        int rebase;
+
+        __m256d v_bound2 = _mm256_set1_pd(4);
+        __m256d v_one = _mm256_set1_pd(1);
+        __m256d v_two = _mm256_set1_pd(2);
+
+        if(o->exp)
+        {
+                if(probe_scaled(o, &v_dzx, &v_dzy, v_dcx, v_dcy, bailout,
+                                &i, &m))
+                {
+                        *n_iter = i + 1;
+                        return _mm256_set1_pd(i);
+                }
+
+                /* In two steps, 2^exp itself may be out of range */
+                v_unscale = _mm256_set1_pd(ldexp(1, o->exp / 2));
+                v_dzx = _mm256_mul_pd(v_dzx, v_unscale);
+                v_dzy = _mm256_mul_pd(v_dzy, v_unscale);
+                v_dcx = _mm256_mul_pd(v_dcx, v_unscale);
+                v_dcy = _mm256_mul_pd(v_dcy, v_unscale);
+
+                v_unscale = _mm256_set1_pd(ldexp(1, o->exp - o->exp / 2));
+                v_dzx = _mm256_mul_pd(v_dzx, v_unscale);
+                v_dzy = _mm256_mul_pd(v_dzy, v_unscale);
+                v_dcx = _mm256_mul_pd(v_dcx, v_unscale);
+                v_dcy = _mm256_mul_pd(v_dcy, v_unscale);
+        }
+
+        v_m = _mm256_setzero_si256();
+        v_last = _mm256_set1_epi64x(o->last);
+
+        v_refx = _mm256_set1_pd(o->x[m]);
+        v_refy = _mm256_set1_pd(o->y[m]);
+
+        v_zx = _mm256_add_pd(v_refx, v_dzx);
+        v_zy = _mm256_add_pd(v_refy, v_dzy);
+        v_mag2 = _mm256_fmadd_pd(v_zx, v_zx, _mm256_mul_pd(v_zy, v_zy));
+
+        active_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        v_i = _mm256_set1_pd(i);
+
+        for (; i < bailout; ++i)
+        {
+                /* Rebase where |z| < |dz| or the reference ends */
+                v_dmag2 = _mm256_fmadd_pd(v_dzx, v_dzx,
+                                          _mm256_mul_pd(v_dzy, v_dzy));
+                rebase_mask = _mm256_cmp_pd(v_mag2, v_dmag2, _CMP_LT_OQ);
+
+                if(uniform)
+                {
+                        rebase = m == o->last ? 0xF
+                                 : _mm256_movemask_pd(rebase_mask);
+
+                        if(rebase == 0xF)
+                        {
+                                v_dzx = v_zx;
+                                v_dzy = v_zy;
+                                v_refx = _mm256_setzero_pd();
+                                v_refy = _mm256_setzero_pd();
+                                m = 0;
+                        }
+                        else if(rebase)
+                        {
+                                uniform = false;
+                                v_m = _mm256_set1_epi64x(m);
+                        }
+                }
+
+                if(!uniform)
+                {
+                        rebase_mask = _mm256_or_pd(rebase_mask,
+                                _mm256_castsi256_pd(
+                                        _mm256_cmpeq_epi64(v_m, v_last)));
+
+                        v_dzx = _mm256_blendv_pd(v_dzx, v_zx, rebase_mask);
+                        v_dzy = _mm256_blendv_pd(v_dzy, v_zy, rebase_mask);
+                        v_refx = _mm256_andnot_pd(rebase_mask, v_refx);
+                        v_refy = _mm256_andnot_pd(rebase_mask, v_refy);
+                        v_m = _mm256_andnot_si256(
+                                _mm256_castpd_si256(rebase_mask), v_m);
+                }
+
+                /* dz1 = (2 * Z + dz) * dz + dc */
+                v_tx = _mm256_fmadd_pd(v_two, v_refx, v_dzx);
+                v_ty = _mm256_fmadd_pd(v_two, v_refy, v_dzy);
+
+                v_dzx1 = _mm256_fmsub_pd(v_tx, v_dzx,
+                                         _mm256_fmsub_pd(v_ty, v_dzy, v_dcx));
+                v_dzy1 = _mm256_fmadd_pd(v_tx, v_dzy,
+                                         _mm256_fmadd_pd(v_ty, v_dzx, v_dcy));
+
+                if(uniform)
+                {
+                        ++m;
+                        v_refx = _mm256_set1_pd(o->x[m]);
+                        v_refy = _mm256_set1_pd(o->y[m]);
+                }
+                else
+                {
+                        v_m = _mm256_add_epi64(v_m, _mm256_set1_epi64x(1));
+                        v_refx = _mm256_i64gather_pd(o->x, v_m, 8);
+                        v_refy = _mm256_i64gather_pd(o->y, v_m, 8);
+                }
+
+                v_zx = _mm256_add_pd(v_refx, v_dzx1);
+                v_zy = _mm256_add_pd(v_refy, v_dzy1);
+                v_mag2 = _mm256_fmadd_pd(v_zx, v_zx,
+                                         _mm256_mul_pd(v_zy, v_zy));
+
+                bound_mask = _mm256_cmp_pd(v_mag2, v_bound2, _CMP_LT_OQ);
+                bound_mask = _mm256_and_pd(bound_mask, active_mask);
+
+                if (!_mm256_movemask_pd(bound_mask))
+                        break;
+
+                v_i = _mm256_add_pd(v_i, _mm256_and_pd(bound_mask, v_one));
+                active_mask = bound_mask;
+
+                v_dzx = v_dzx1;
+                v_dzy = v_dzy1;
+        }
+
+        *n_iter = i < bailout ? i + 1 : bailout;
+
+        return v_i;
+}
+
+/* stats is NULL in the plain version, the counting is compiled out */
+static __always_inline
+void process_block(uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1,
+                   struct mdb_lane_stats* stats)
+{
+        const struct orbit* o = orbit_get();
+        __m256d v_step, v_center, v_height_r;
+        uint32_t bailout, y, x_end, y_end;
+        uint32_t csr;
+
+        if(unlikely(!o))
+                return;
+
+        /* dz * dz of small deltas is denormal, it's negligible anyway
+         * and flushing it to zero avoids slow microcode assists.
+         */
+        csr = _mm_getcsr();
+        _mm_setcsr(csr | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON);
+
+        v_step = _mm256_set1_pd(o->step);
+        v_center = _mm256_set1_pd(-0.5);
+        v_height_r = _mm256_set1_pd(1.0 / o->height);
+
+        bailout = o->bailout;
+
+        x_end = mdb_block_end(x1, mdb.width);
+        y_end = mdb_block_end(y1, mdb.height);
+
+        for (y = y0; y <= y1; ++y)
+        {
+                __m256d v_dcy, v_dcx;
+                uint32_t x;
+
+                v_dcy = _mm256_set1_pd(y);
+                v_dcy = _mm256_fmadd_pd(v_dcy, v_height_r, v_center);
+                v_dcy = _mm256_mul_pd(v_dcy, v_step);
+
+                for (x = x0; x < x_end; x += 4)
+                {
+                        __m256d v_i;
+                        uint32_t n_iter;
+
+                        v_dcx = _mm256_set_pd(x + 3, x + 2, x + 1, x + 0);
+                        v_dcx = _mm256_fmadd_pd(v_dcx, v_height_r, v_center);
+                        v_dcx = _mm256_mul_pd(v_dcx, v_step);
+
+                        v_i = mdb_point_probe(o, v_dcx, v_dcy, bailout,
+                                              &n_iter);
+
+                        if(stats && y < y_end)
+                                lane_stats_add(stats, v_i, n_iter,
+                                               MIN(x_end - x, 4));
+
+                        set_pixels(v_i, x, y, bailout);
+                }
+        }
+
+        _mm_setcsr(csr);
+}
+
+__hot
+void mdb_kernel_process_block(uint32_t x0, uint32_t x1,
+                              uint32_t y0, uint32_t y1)
+{
+        process_block(x0, x1, y0, y1, NULL);
+}
+
+void mdb_kernel_process_block_stats(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    struct mdb_lane_stats* stats)
+{
+        process_block(x0, x1, y0, y1, stats);
+}
+
+/* Every lane is active until it escapes, so active lane-iterations
+ * are the escape-time iterations of the block.
+ */
+void mdb_kernel_process_block_iters(uint32_t x0, uint32_t x1,
+                                    uint32_t y0, uint32_t y1,
+                                    uint64_t* iters)
+{
+        struct mdb_lane_stats stats = {0, 0};
+
+        process_block(x0, x1, y0, y1, &stats);
+
+        *iters += stats.active;
+}
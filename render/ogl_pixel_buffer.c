@@ -5,6 +5,7 @@
 
 #include <tools/log.h>
 #include <tools/compiler.h>
+#include <tools/usdt.h>
 
 
 struct _ogl_pixel_buffer
@@ -55,8 +56,12 @@ void ogl_pbo_update(ogl_pixel_buffer* pbo, GLsync* sync)
 {
         ogl_buffer_wait(sync);
 
+        MDB_PROBE2(pbo_update_start, pbo->width, pbo->height);
+
         pbo->data_update(pbo->data, pbo->update_context);
 
+        MDB_PROBE2(pbo_update_end, pbo->width, pbo->height);
+
         ogl_buffer_lock(sync);
 
 }
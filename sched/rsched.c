@@ -10,15 +10,18 @@
 #include <unistd.h>
 #include <errno.h>
 #include <tools/compiler.h>
+#include <tools/mem.h>
 #include <tools/atomic.h>
 #include <tools/log.h>
 #include <tools/error_codes.h>
 #include <tools/timer.h>
 #include <tools/hist.h>
+#include <tools/usdt.h>
 
 #include "rsched_queue.h"
 #include "rsched_worker.h"
 #include "rsched_common.h"
+#include "rsched_costs.h"
 
 
 static inline
@@ -30,21 +33,27 @@ void rsched_init_structure(struct rsched** psched, struct rsched_options* opts)
         struct rsched* sched;
         uint32_t workers = opts->threads - 1;
 
-        *psched = calloc(1, sizeof(**psched));
+        /* Cache aligned members are only aligned with aligned storage */
+        *psched = malloc_aligned(sizeof(**psched), 64);
         sched = *psched;
+        memset(sched, 0, sizeof(*sched));
 
-        sched->worker       = calloc(workers, sizeof(*sched->worker));
+        sched->worker       = malloc_aligned(MAX(workers, 1)
+                                             * sizeof(*sched->worker), 64);
+        memset(sched->worker, 0, MAX(workers, 1) * sizeof(*sched->worker));
         sched->n_workers    = workers;
         sched->user_fun     = NULL;
         sched->user_ctx     = NULL;
 
         rsched_worker_init_stats(&sched->host_stats, opts);
+        rsched_trace_init(&sched->host_trace, opts->trace_size);
+        perf_hist_init(&sched->frame_hist);
 
-#if defined(CONFIG_RSCHED_PROFILE)
-        sched->stats.run_time_hist_show = opts->profile.run_hist.show;
-        sched->stats.task_time_hist_show = opts->profile.task_hist.show;
-        sched->stats.payload_hist_show = opts->profile.payload_hist.show;
-#endif
+        /* The host worker runs on the calling thread */
+        rsched_pmu_init(&sched->host_pmu, opts->pmu);
+        rsched_pmu_open(&sched->host_pmu);
+
+        rsched_stats_init(&sched->stats, &opts->profile);
 }
 
 int rsched_create(struct rsched** psched, struct rsched_options* opts)
@@ -57,18 +66,24 @@ int rsched_create(struct rsched** psched, struct rsched_options* opts)
         sched = *psched;
 
         rsched_queue_init(&sched->queue);
+        rsched_queue_record_costs(&sched->queue, opts->record_costs);
 
         for(i = 0; i < workers; ++i)
         {
                 int ret = rsched_worker_init(&sched->worker[i],
                                              i,
                                              &sched->queue,
+                                             &sched->stats.enabled,
                                              opts);
 
                 if(ret != MDB_SUCCESS)
                         goto shutdown_ret_fail;
         }
 
+        /* A start signal sent before a worker parks stays pending */
+        if(opts->lazy_start)
+                return MDB_SUCCESS;
+
         if(rsched_wait_workers(sched) != MDB_SUCCESS)
         {
                 LOG_ERROR("Failed to sync workers.");
@@ -184,13 +199,17 @@ void rsched_destroy_workers(struct rsched* sched)
 static
 void rsched_destroy_structure(struct rsched* sched)
 {
-        free(sched->worker);
-        free(sched);
+        free_aligned(sched->worker);
+        free_aligned(sched);
 }
 
 void rsched_shutdown(struct rsched* sched)
 {
         rsched_worker_destroy_stats(&sched->host_stats);
+        rsched_trace_destroy(&sched->host_trace);
+        rsched_pmu_destroy(&sched->host_pmu);
+        perf_hist_destroy(&sched->frame_hist);
+        rsched_stats_destroy(&sched->stats);
 
         rsched_destroy_workers(sched);
 
@@ -259,11 +278,143 @@ void rsched_run_workers(struct rsched* sched)
         }
 }
 
+/* The host part of a frame, profile is a compile time constant
+ * so the profiling and the plain loops are generated from one body.
+ */
+static __always_inline
+void rsched_host_run_tasks(struct rsched* sched, rsched_user_fun proc_fun,
+                           void* user_ctx, const bool profile)
+{
+        struct worker_stats* stats = &sched->host_stats;
+        struct rsched_trace_buf* trace = &sched->host_trace;
+        struct rsched_pmu* pmu = &sched->host_pmu;
+        uint64_t ts = 0;
+
+        if(profile)
+                rsched_profile_start(&stats->profile.run);
+
+        for (;;)
+        {
+                struct rsched_task* t;
+
+                if(profile)
+                        rsched_profile_start(&stats->profile.task);
+
+                t = rsched_queue_pop(&sched->queue,
+                                     profile ? &stats->profile.cas_retries
+                                             : NULL);
+
+                if (t == NULL)
+                {
+                        if(profile)
+                                rsched_profile_stop(&stats->profile.task);
+                        break;
+                }
+
+                MDB_PROBE1(task_pop, -1);
+
+                if(profile)
+                        rsched_profile_start(&stats->profile.payload);
+
+                if(rsched_trace_enabled(trace))
+                        ts = rsched_trace_clock();
+
+                if(rsched_pmu_enabled(pmu))
+                        rsched_pmu_begin(pmu);
+
+                MDB_PROBE5(task_begin, -1, t->x0, t->x1, t->y0, t->y1);
+
+                rsched_queue_run_task(&sched->queue, t, proc_fun, user_ctx);
+
+                MDB_PROBE5(task_end, -1, t->x0, t->x1, t->y0, t->y1);
+
+                if(rsched_pmu_enabled(pmu))
+                        rsched_pmu_end(pmu);
+
+                if(rsched_trace_enabled(trace))
+                        rsched_trace_task(trace, t->x0, t->x1, t->y0, t->y1,
+                                          ts);
+
+                if(profile)
+                {
+                        rsched_profile_stop(&stats->profile.payload);
+                        rsched_profile_tile(&stats->profile);
+                }
+
+                atomic_add_single_writer(&stats->task_count, 1);
+
+                if(profile)
+                        rsched_profile_stop(&stats->profile.task);
+        }
+
+        if(profile)
+                rsched_profile_stop(&stats->profile.run);
+}
+
+__hot static
+void rsched_host_loop(struct rsched* sched, rsched_user_fun proc_fun,
+                      void* user_ctx)
+{
+        rsched_host_run_tasks(sched, proc_fun, user_ctx, false);
+}
+
+__hot static
+void rsched_host_loop_profile(struct rsched* sched, rsched_user_fun proc_fun,
+                              void* user_ctx)
+{
+        rsched_host_run_tasks(sched, proc_fun, user_ctx, true);
+}
+
+static
+void rsched_reset_stats(struct rsched* sched)
+{
+        uint32_t i;
+
+        rsched_profile_reset(&sched->host_stats.profile);
+
+        for(i = 0; i < sched->n_workers; ++i)
+                rsched_profile_reset(&sched->worker[i].stats.profile);
+
+        rsched_stats_reset(&sched->stats);
+}
+
+/* Apply a profiling request, must be called while workers are parked.
+ * When profiling is switched off recorded stats are printed and dropped
+ * so the next profiling window starts from scratch.
+ */
+static
+void rsched_update_profiling(struct rsched* sched)
+{
+        int request = atomic_load(&sched->stats.request);
+
+        if(likely(request == sched->stats.enabled))
+                return;
+
+        if(request)
+        {
+                LOG_SAY("Scheduler profiling is on.");
+        }
+        else
+        {
+                LOG_SAY("Scheduler profiling is off.");
+                rsched_print_stats(sched);
+                rsched_reset_stats(sched);
+        }
+
+        /* Workers read it after receiving a start signal */
+        atomic_store(&sched->stats.enabled, request);
+}
+
 int rsched_host_yield(struct rsched* sched)
 {
         rsched_user_fun proc_fun;
         void* user_ctx;
         struct worker_stats* stats = &sched->host_stats;
+        struct rsched_trace_buf* trace = &sched->host_trace;
+        uint64_t frame_ts;
+        uint64_t frame_ns;
+        uint64_t ts, end_ts;
+        bool profile;
 
         user_ctx = sched->user_ctx;
         proc_fun = sched->user_fun;
@@ -275,34 +426,27 @@ int rsched_host_yield(struct rsched* sched)
                 return MDB_FAIL;
         }
 
-        rsched_run_workers(sched);
+        rsched_update_profiling(sched);
+        profile = sched->stats.enabled;
 
-        rsched_profile_start(&stats->profile.run);
-        for (;;)
-        {
-                struct rsched_task* t;
+        frame_ts = rsched_trace_clock();
 
-                rsched_profile_start(&stats->profile.task);
-
-                t = rsched_queue_pop(&sched->queue);
-
-                if (t == NULL)
-                {
-                        rsched_profile_stop(&stats->profile.task);
-                        break;
-                }
+        MDB_PROBE1(frame_start, sched->frames);
 
-                rsched_profile_start(&stats->profile.payload);
+        rsched_run_workers(sched);
 
-                proc_fun(t->x0, t->x1, t->y0, t->y1, user_ctx);
+        if(profile)
+                sched->stats.start_ticks += perf_ticks() - frame_ts;
 
-                rsched_profile_stop(&stats->profile.payload);
+        if(rsched_trace_enabled(trace))
+                rsched_trace_span(trace, RS_TRACE_START, frame_ts);
 
-                ++stats->task_count;
+        if(unlikely(profile))
+                rsched_host_loop_profile(sched, proc_fun, user_ctx);
+        else
+                rsched_host_loop(sched, proc_fun, user_ctx);
 
-                rsched_profile_stop(&stats->profile.task);
-        }
-        rsched_profile_stop(&stats->profile.run);;
+        ts = perf_ticks();
 
         if(rsched_wait_workers(sched) != MDB_SUCCESS)
         {
@@ -310,9 +454,44 @@ int rsched_host_yield(struct rsched* sched)
                 return MDB_FAIL;
         }
 
+        end_ts = perf_ticks();
+
+        atomic_add_single_writer(&stats->idle_ticks, end_ts - ts);
+
+        if(profile)
+        {
+                sched->stats.wait_ticks += end_ts - ts;
+                rsched_profile_frame(sched, frame_ts, end_ts);
+        }
+
+        if(rsched_trace_enabled(trace))
+        {
+                rsched_trace_span(trace, RS_TRACE_WAIT, ts);
+                rsched_trace_frame(trace, sched->frames, frame_ts);
+        }
+
+        frame_ns = perf_ticks_to_ns(end_ts - frame_ts);
+        perf_hist_add_shared(&sched->frame_hist, frame_ns);
+        atomic_add_single_writer(&sched->frame_ns, frame_ns);
+
+        MDB_PROBE2(frame_end, sched->frames, frame_ns);
+
+        ++sched->cost_frames;
+        atomic_add_single_writer(&sched->frames, 1);
+
         return MDB_SUCCESS;
 }
 
+void rsched_set_profiling(struct rsched* sched, bool enable)
+{
+        atomic_store(&sched->stats.request, enable ? 1 : 0);
+}
+
+void rsched_toggle_profiling(struct rsched* sched)
+{
+        atomic_fetch_xor(&sched->stats.request, 1);
+}
+
 void rsched_create_tasks(struct rsched* sched, uint32_t width, uint32_t height,
                          struct block_size* grain)
 {
@@ -326,4 +505,56 @@ void rsched_create_tasks(struct rsched* sched, uint32_t width, uint32_t height,
                             | RS_QUE_ZERO);
 
         rsched_split_task(&sched->queue, 0, width-1, 0, height-1, grain);
+
+        sched->width  = width;
+        sched->height = height;
+        sched->grain  = *grain;
+        sched->cost_frames = 0;
+}
+
+int rsched_get_costs(struct rsched* sched, struct rsched_cost_map* map)
+{
+        struct rsched_queue* queue = &sched->queue;
+        uint64_t frames = MAX(sched->cost_frames, 1);
+        uint32_t i;
+
+        if(!queue->cost)
+        {
+                LOG_ERROR("Cost recording is not enabled.");
+                return MDB_FAIL;
+        }
+
+        map->width   = sched->width;
+        map->height  = sched->height;
+        map->grain_x = sched->grain.x;
+        map->grain_y = sched->grain.y;
+        map->frames  = sched->cost_frames;
+        map->n_tiles = queue->length;
+        map->tile    = calloc(MAX(queue->length, 1), sizeof(*map->tile));
+
+        for(i = 0; i < queue->length; ++i)
+        {
+                map->tile[i].x0 = queue->tasks[i].x0;
+                map->tile[i].x1 = queue->tasks[i].x1;
+                map->tile[i].y0 = queue->tasks[i].y0;
+                map->tile[i].y1 = queue->tasks[i].y1;
+                map->tile[i].cost = queue->cost[i] / frames;
+        }
+
+        return MDB_SUCCESS;
+}
+
+int rsched_save_costs(struct rsched* sched, const char* filename)
+{
+        struct rsched_cost_map map;
+        int ret;
+
+        if(rsched_get_costs(sched, &map) != MDB_SUCCESS)
+                return MDB_FAIL;
+
+        ret = rsched_costs_save(&map, filename);
+
+        rsched_costs_free(&map);
+
+        return ret;
 }
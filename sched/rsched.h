@@ -37,13 +37,32 @@
  *
  * Profiling.
  * The scheduler has an ability to record various performance counters and make
- * histograms from it. To enable this feature the scheduler must be built with a
- * CONFIG_RSCHED_PROFILE option.
+ * histograms from it. Profiling is always compiled in and can be switched
+ * on and off at run time with rsched_set_profiling, the change takes effect
+ * at the next frame. While profiling is off workers run a loop without any
+ * profiling code. CONFIG_RSCHED_PROFILE only enables it by default.
  * Note, profiling may slightly decrease performance.
  * By default profiling enables all available profiling options and shows all
  * available counters and histograms, to disable and tune various profiling
  * options read the product documentation.
  *
+ * Cost recording.
+ * If the scheduler is created with the record_costs option it measures
+ * payload time of every tile and accumulates it across frames.
+ * The result can be saved with rsched_save_costs and replayed offline by
+ * the mdb-simsched tool under various policies and thread counts.
+ *
+ * Tracing.
+ * If the scheduler is created with a non zero trace_size option every worker
+ * records spans of its activity to its own ring buffer ( see rsched_trace.h ),
+ * the trace can be saved with rsched_save_trace as Chrome trace-event JSON.
+ *
+ * Hardware counters.
+ * If the scheduler is created with the pmu option every worker counts
+ * cycles, instructions, cache and branch misses of every tile with
+ * perf_event_open ( see rsched_pmu.h ), use rsched_print_pmu_stats
+ * to show them.
+ *
  * Debugging.
  * For debugging the scheduler must be built with a CONFIG_RSCHED_DEBUG option.
  * Note, this can generate very massive verbose output.
@@ -55,10 +74,14 @@
 #include <stdbool.h>
 #include <config/config.h>
 #include <tools/compiler.h>
+#include <tools/hist.h>
 
 #include "rsched_queue.h"
 #include "rsched_worker.h"
 #include "rsched_common.h"
+#include "rsched_trace.h"
+#include "rsched_pmu.h"
+#include "rsched_costs.h"
 
 
 
@@ -68,8 +91,19 @@
  * @n_workers    - count of workers.
  * @stats        - scheduler statistics including profile information.
  * @host_stats   - host worker statistics ( separated from worker structure ).
+ * @host_trace   - host worker trace buffer.
+ * @host_pmu     - host worker hardware counters.
  * @user_fun     - A function for executing by workers.
  * @user_ctx     - A pointer to the user specific data, put to user_fun.
+ * @width        - width of the surface split to tasks.
+ * @height       - height of the surface split to tasks.
+ * @grain        - grain the surface was split with.
+ * @cost_frames  - count of frames costs are recorded over.
+ * @frames       - count of processed frames.
+ * @frame_ns     - total time of processed frames.
+ * @frame_hist   - frame time histogram.
+ *                 frames, frame_ns and frame_hist are written only by the
+ *                 host thread and can be read at any time ( rsched_metrics.h ).
  * @queue        - Scheduler queue object.
  */
 struct rsched
@@ -78,11 +112,23 @@ struct rsched
         uint32_t n_workers;
 
         struct rsched_stats stats;
+
+        /* Written by the host thread on every tile */
+        __cache_aligned
         struct worker_stats host_stats;
+        struct rsched_trace_buf host_trace;
+        struct rsched_pmu host_pmu;
 
         rsched_user_fun user_fun;
         void* user_ctx;
 
+        uint32_t width, height;
+        struct block_size grain;
+        uint64_t cost_frames;
+        uint64_t frames;
+        uint64_t frame_ns;
+        struct perf_hist frame_hist;
+
         __cache_aligned
         struct rsched_queue queue;
 };
@@ -142,9 +188,42 @@ void rsched_set_user_context(struct rsched* sched, rsched_user_fun fun,
                              void* user_ctx);
 
 
+/* Get recorded per-tile costs averaged over processed frames,
+ * the map must be released with rsched_costs_free.
+ * The scheduler must be created with the record_costs option.
+ */
+int rsched_get_costs(struct rsched* sched, struct rsched_cost_map* map);
+
+/* Save recorded per-tile costs averaged over processed frames to a file.
+ * The scheduler must be created with the record_costs option.
+ */
+int rsched_save_costs(struct rsched* sched, const char* filename);
+
+
+/* Switch profiling on or off starting from the next frame.
+ * When it's switched off recorded stats are printed and dropped.
+ * Both functions are async-signal-safe.
+ */
+void rsched_set_profiling(struct rsched* sched, bool enable);
+
+void rsched_toggle_profiling(struct rsched* sched);
+
+
 /* Shutdown and destroy scheduler and all workers */
 void rsched_shutdown(struct rsched* sched);
 
 
 /* Returns number of threads */
 uint32_t rsched_threads_count(struct rsched* sched);
+
+extern __thread uint32_t __rsched_thread_id;
+
+/* Index of the calling thread in the scheduler: 0 for the host and
+ * 1..n for workers, less than rsched_threads_count.
+ * Lets a user function keep per-thread data without atomics.
+ */
+static inline
+uint32_t rsched_thread_id(void)
+{
+        return __rsched_thread_id;
+}
@@ -19,6 +19,20 @@ struct rsched_options
 {
         uint32_t threads;
 
+        /* Record payload time of every tile ( see rsched_save_costs ) */
+        bool record_costs;
+
+        /* Size of per worker trace buffers in events, 0 disables tracing
+         * ( see rsched_trace.h ) */
+        uint32_t trace_size;
+
+        /* Count hardware events of every tile ( see rsched_pmu.h ) */
+        bool pmu;
+
+        /* Don't wait in rsched_create until all workers are parked,
+         * the first frame waits for them instead */
+        bool lazy_start;
+
         struct rsched_profile_options profile;
 };
 
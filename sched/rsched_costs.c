@@ -0,0 +1,166 @@
+#include "rsched_costs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <tools/log.h>
+#include <tools/compiler.h>
+#include <tools/error_codes.h>
+
+#define RSCHED_COSTS_MAGIC "rsched-costs"
+#define RSCHED_COSTS_VERSION 1
+
+int rsched_costs_save(const struct rsched_cost_map* map, const char* filename)
+{
+        FILE* f;
+        uint32_t i;
+
+        f = fopen(filename, "w");
+        if(!f)
+        {
+                LOG_ERROR("Failed to open '%s' for writing: %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        fprintf(f, "# mdb per-tile payload costs\n");
+        fprintf(f, "%s %d\n", RSCHED_COSTS_MAGIC, RSCHED_COSTS_VERSION);
+        fprintf(f, "size %u %u\n", map->width, map->height);
+        fprintf(f, "grain %u %u\n", map->grain_x, map->grain_y);
+        fprintf(f, "frames %" PRIu64 "\n", map->frames);
+        fprintf(f, "tiles %u\n", map->n_tiles);
+
+        for(i = 0; i < map->n_tiles; ++i)
+        {
+                const struct rsched_tile_cost* t = &map->tile[i];
+
+                fprintf(f, "%u %u %u %u %" PRIu64 "\n",
+                        t->x0, t->x1, t->y0, t->y1, t->cost);
+        }
+
+        if(fclose(f) != 0)
+        {
+                LOG_ERROR("Failed to write '%s': %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        return MDB_SUCCESS;
+}
+
+static
+int read_line(FILE* f, char* buf, size_t sz)
+{
+        while(fgets(buf, (int)sz, f))
+        {
+                if(buf[0] == '#' || buf[0] == '\n')
+                        continue;
+
+                return 0;
+        }
+
+        return -1;
+}
+
+int rsched_costs_load(struct rsched_cost_map* map, const char* filename)
+{
+        FILE* f;
+        char line[256];
+        char magic[32];
+        int version;
+        uint32_t i;
+
+        memset(map, 0, sizeof(*map));
+
+        f = fopen(filename, "r");
+        if(!f)
+        {
+                LOG_ERROR("Failed to open '%s': %s", filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        if(read_line(f, line, sizeof(line))
+           || sscanf(line, "%31s %d", magic, &version) != 2
+           || strcmp(magic, RSCHED_COSTS_MAGIC) != 0
+           || version != RSCHED_COSTS_VERSION)
+        {
+                LOG_ERROR("'%s' is not a cost map file.", filename);
+                goto fail;
+        }
+
+        if(read_line(f, line, sizeof(line))
+           || sscanf(line, "size %u %u", &map->width, &map->height) != 2)
+                goto fail_format;
+
+        if(read_line(f, line, sizeof(line))
+           || sscanf(line, "grain %u %u", &map->grain_x, &map->grain_y) != 2)
+                goto fail_format;
+
+        if(read_line(f, line, sizeof(line))
+           || sscanf(line, "frames %" SCNu64, &map->frames) != 1)
+                goto fail_format;
+
+        if(read_line(f, line, sizeof(line))
+           || sscanf(line, "tiles %u", &map->n_tiles) != 1)
+                goto fail_format;
+
+        if(map->grain_x == 0 || map->grain_y == 0 || map->n_tiles == 0)
+                goto fail_format;
+
+        map->tile = calloc(map->n_tiles, sizeof(*map->tile));
+
+        for(i = 0; i < map->n_tiles; ++i)
+        {
+                struct rsched_tile_cost* t = &map->tile[i];
+
+                if(read_line(f, line, sizeof(line))
+                   || sscanf(line, "%u %u %u %u %" SCNu64,
+                             &t->x0, &t->x1, &t->y0, &t->y1, &t->cost) != 5)
+                        goto fail_format;
+        }
+
+        fclose(f);
+
+        return MDB_SUCCESS;
+
+fail_format:
+        LOG_ERROR("Malformed cost map file '%s'.", filename);
+fail:
+        fclose(f);
+        rsched_costs_free(map);
+
+        return MDB_FAIL;
+}
+
+void rsched_costs_free(struct rsched_cost_map* map)
+{
+        free(map->tile);
+        map->tile = NULL;
+        map->n_tiles = 0;
+}
+
+void rsched_costs_render(const struct rsched_cost_map* map, float* buf,
+                         double scale, bool per_pixel)
+{
+        uint32_t i, x, y;
+
+        for(i = 0; i < map->n_tiles; ++i)
+        {
+                const struct rsched_tile_cost* t = &map->tile[i];
+                uint32_t x1 = MIN(t->x1, map->width - 1);
+                uint32_t y1 = MIN(t->y1, map->height - 1);
+                double v = (double)t->cost * scale;
+
+                if(t->x0 > x1 || t->y0 > y1)
+                        continue;
+
+                if(per_pixel)
+                        v /= (double)(x1 - t->x0 + 1) * (y1 - t->y0 + 1);
+
+                for(y = t->y0; y <= y1; ++y)
+                        for(x = t->x0; x <= x1; ++x)
+                                buf[(size_t)y * map->width + x] = (float)v;
+        }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/* Per-tile cost maps.
+ *
+ * The scheduler can record how long the user function took on every tile
+ * of the queue ( see rsched_options.record_costs ). The recorded map can be
+ * saved to a plain text file and replayed later by the scheduler simulator
+ * ( mdb-simsched ) to try other grains, orderings and thread counts
+ * without running a kernel.
+ *
+ * File format:
+ *
+ *      # comment
+ *      rsched-costs 1
+ *      size   WIDTH HEIGHT
+ *      grain  X Y
+ *      frames N
+ *      tiles  N
+ *      x0 x1 y0 y1 cost_ns
+ *      ...
+ *
+ * Tiles are stored in the queue order, cost is an average per frame in ns.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct rsched_tile_cost
+{
+        uint32_t x0, x1, y0, y1;
+        uint64_t cost;
+};
+
+/* struct rsched_cost_map - recorded costs of a tile layout.
+ *
+ * @width, @height - size of the split surface.
+ * @grain_x, @grain_y - grain the surface was split with.
+ * @frames - number of frames the costs were averaged over.
+ * @n_tiles - count of tiles.
+ * @tile - array of tiles in the queue order.
+ */
+struct rsched_cost_map
+{
+        uint32_t width, height;
+        uint32_t grain_x, grain_y;
+        uint64_t frames;
+
+        uint32_t n_tiles;
+        struct rsched_tile_cost* tile;
+};
+
+/* Save a cost map to a file. Returns MDB_SUCCESS on success. */
+int rsched_costs_save(const struct rsched_cost_map* map, const char* filename);
+
+/* Load a cost map from a file, the map must be released
+ * with rsched_costs_free. Returns MDB_SUCCESS on success.
+ */
+int rsched_costs_load(struct rsched_cost_map* map, const char* filename);
+
+void rsched_costs_free(struct rsched_cost_map* map);
+
+/* Fill a width x height buffer of the map size with the cost of every tile
+ * at all pixels of the tile multiplied by scale.
+ * If per_pixel is set the cost is divided by the tile area.
+ */
+void rsched_costs_render(const struct rsched_cost_map* map, float* buf,
+                         double scale, bool per_pixel);
@@ -0,0 +1,103 @@
+#include "rsched_metrics.h"
+
+#include <inttypes.h>
+#include <tools/atomic.h>
+#include <tools/timer.h>
+#include <tools/hist.h>
+#include <tools/error_codes.h>
+
+#include "rsched.h"
+
+static
+void write_header(FILE* f, const char* name, const char* type,
+                  const char* help)
+{
+        fprintf(f, "# HELP %s %s\n", name, help);
+        fprintf(f, "# TYPE %s %s\n", name, type);
+}
+
+static
+void write_worker_tasks(FILE* f, const char* worker,
+                        const struct worker_stats* stats)
+{
+        fprintf(f, "mdb_worker_tasks_total{worker=\"%s\"} %" PRIu64 "\n",
+                worker, atomic_load_relaxed(&stats->task_count));
+}
+
+static
+void write_worker_idle(FILE* f, const char* worker,
+                       const struct worker_stats* stats)
+{
+        uint64_t ticks = atomic_load_relaxed(&stats->idle_ticks);
+
+        fprintf(f, "mdb_worker_idle_seconds_total{worker=\"%s\"} %.9f\n",
+                worker, ns_to_sec(perf_ticks_to_ns(ticks)));
+}
+
+static
+void write_frame_time(FILE* f, struct rsched* sched)
+{
+        static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+        struct perf_hist hist;
+        uint32_t i;
+
+        perf_hist_init(&hist);
+        perf_hist_snapshot(&hist, &sched->frame_hist);
+
+        write_header(f, "mdb_frame_seconds", "summary",
+                     "Time from starting workers until all tasks "
+                     "of a frame are done.");
+
+        for(i = 0; i < ARRAY_SIZE(quantiles); ++i)
+        {
+                uint64_t ns = perf_hist_percentile(&hist, quantiles[i] * 100);
+
+                fprintf(f, "mdb_frame_seconds{quantile=\"%g\"} %.9f\n",
+                        quantiles[i], ns_to_sec(ns));
+        }
+
+        fprintf(f, "mdb_frame_seconds_sum %.9f\n",
+                ns_to_sec(atomic_load_relaxed(&sched->frame_ns)));
+        fprintf(f, "mdb_frame_seconds_count %" PRIu64 "\n", hist.count);
+
+        perf_hist_destroy(&hist);
+}
+
+int rsched_write_metrics(struct rsched* sched, FILE* f)
+{
+        char name[16];
+        uint32_t i;
+
+        write_header(f, "mdb_frames_total", "counter",
+                     "Frames completed by the scheduler.");
+        fprintf(f, "mdb_frames_total %" PRIu64 "\n",
+                atomic_load_relaxed(&sched->frames));
+
+        write_header(f, "mdb_threads", "gauge",
+                     "Scheduler threads including the host one.");
+        fprintf(f, "mdb_threads %u\n", rsched_threads_count(sched));
+
+        write_frame_time(f, sched);
+
+        write_header(f, "mdb_worker_tasks_total", "counter",
+                     "Tasks processed by a worker.");
+        write_worker_tasks(f, "host", &sched->host_stats);
+        for(i = 0; i < sched->n_workers; ++i)
+        {
+                snprintf(name, sizeof(name), "%u", i);
+                write_worker_tasks(f, name, &sched->worker[i].stats);
+        }
+
+        write_header(f, "mdb_worker_idle_seconds_total", "counter",
+                     "Time a worker spent waiting for a frame to start, "
+                     "or the host for workers to finish a frame.");
+        write_worker_idle(f, "host", &sched->host_stats);
+        for(i = 0; i < sched->n_workers; ++i)
+        {
+                snprintf(name, sizeof(name), "%u", i);
+                write_worker_idle(f, name, &sched->worker[i].stats);
+        }
+
+        return ferror(f) ? MDB_FAIL : MDB_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+/* Live scheduler metrics.
+ *
+ * Counters are written by their owner threads with relaxed atomic stores
+ * and read here with relaxed loads, so metrics can be taken at any time
+ * from any thread without stalling workers. Values of different counters
+ * are not taken at the same instant, the snapshot may be slightly
+ * inconsistent while a frame is being processed.
+ */
+
+#include <stdio.h>
+
+struct rsched;
+
+/* Write a snapshot of scheduler counters in Prometheus text format */
+int rsched_write_metrics(struct rsched* sched, FILE* f);
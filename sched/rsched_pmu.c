@@ -0,0 +1,350 @@
+#include "rsched_pmu.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <tools/log.h>
+#include <tools/atomic.h>
+#include <tools/error_codes.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "rsched.h"
+
+/* Group read buffer header: nr, time_enabled, time_running */
+#define PMU_READ_HDR 3
+
+struct pmu_event
+{
+        const char* name;
+        uint32_t type;
+        uint64_t config;
+};
+
+static const struct pmu_event pmu_events[RS_PMU_LAST] = {
+        { "Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { "Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { "Branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { "L1D misses", PERF_TYPE_HW_CACHE,
+          PERF_COUNT_HW_CACHE_L1D
+          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+
+        /* FP_ARITH_INST_RETIRED.256B_PACKED_SINGLE, Intel only */
+        { "FP 256b packed", PERF_TYPE_RAW, 0x20C7 }
+};
+
+static __atomic int pmu_warned = 0;
+
+/* FP_ARITH_INST_RETIRED exists on Intel cores since Broadwell,
+ * there's no architectural FP event so everything else is skipped.
+ */
+static
+bool pmu_has_fp_arith(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int eax, ebx, ecx, edx;
+        unsigned int family, model;
+
+        if(!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+                return false;
+
+        /* "GenuineIntel" */
+        if(ebx != 0x756e6547 || edx != 0x49656e69 || ecx != 0x6c65746e)
+                return false;
+
+        if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+                return false;
+
+        family = (eax >> 8) & 0xf;
+        model  = ((eax >> 4) & 0xf) | ((eax >> 12) & 0xf0);
+
+        return family == 6 && model >= 0x3d;
+#else
+        return false;
+#endif
+}
+
+static
+int pmu_event_open(const struct pmu_event* ev, int group_fd)
+{
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+
+        attr.size           = sizeof(attr);
+        attr.type           = ev->type;
+        attr.config         = ev->config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP
+                              | PERF_FORMAT_TOTAL_TIME_ENABLED
+                              | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+void rsched_pmu_init(struct rsched_pmu* pmu, bool enable)
+{
+        uint32_t i;
+
+        memset(pmu, 0, sizeof(*pmu));
+
+        pmu->requested = enable;
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+                pmu->fd[i] = -1;
+}
+
+int rsched_pmu_open(struct rsched_pmu* pmu)
+{
+        int leader = -1;
+        int err = 0;
+        uint32_t i;
+
+        if(!pmu->requested)
+                return MDB_SUCCESS;
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+        {
+                if(i == RS_PMU_FP_256_PS && !pmu_has_fp_arith())
+                        continue;
+
+                pmu->fd[i] = pmu_event_open(&pmu_events[i], leader);
+                if(pmu->fd[i] < 0)
+                {
+                        if(!err)
+                                err = errno;
+
+                        pmu->fd[i] = -1;
+                        continue;
+                }
+
+                if(leader < 0)
+                        leader = pmu->fd[i];
+
+                pmu->slot[i] = pmu->n++;
+                perf_hist_init(&pmu->hist[i]);
+        }
+
+        if(!pmu->n)
+        {
+                if(!atomic_exchange(&pmu_warned, 1))
+                        LOG_WARN("Hardware performance counters are not "
+                                 "available: %s. Check "
+                                 "/proc/sys/kernel/perf_event_paranoid.",
+                                 strerror(err));
+
+                return MDB_FAIL;
+        }
+
+        return MDB_SUCCESS;
+}
+
+void rsched_pmu_destroy(struct rsched_pmu* pmu)
+{
+        uint32_t i;
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+        {
+                if(pmu->fd[i] < 0)
+                        continue;
+
+                close(pmu->fd[i]);
+                pmu->fd[i] = -1;
+
+                perf_hist_destroy(&pmu->hist[i]);
+        }
+
+        pmu->n = 0;
+}
+
+static inline
+int pmu_leader(const struct rsched_pmu* pmu)
+{
+        uint32_t i;
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+                if(pmu->fd[i] >= 0 && pmu->slot[i] == 0)
+                        return pmu->fd[i];
+
+        return -1;
+}
+
+static inline
+bool pmu_read(const struct rsched_pmu* pmu, uint64_t* buf)
+{
+        size_t size = (PMU_READ_HDR + pmu->n) * sizeof(*buf);
+
+        return read(pmu_leader(pmu), buf, size) == (ssize_t)size;
+}
+
+void rsched_pmu_begin(struct rsched_pmu* pmu)
+{
+        if(!pmu_read(pmu, pmu->begin))
+                pmu->begin[0] = 0;
+}
+
+void rsched_pmu_end(struct rsched_pmu* pmu)
+{
+        uint64_t end[RS_PMU_LAST + PMU_READ_HDR];
+        uint64_t enabled, running, d;
+        uint32_t i;
+
+        if(!pmu->begin[0] || !pmu_read(pmu, end))
+        {
+                ++pmu->dropped;
+                return;
+        }
+
+        enabled = end[1] - pmu->begin[1];
+        running = end[2] - pmu->begin[2];
+
+        if(running != enabled)
+        {
+                ++pmu->dropped;
+                return;
+        }
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+        {
+                if(pmu->fd[i] < 0)
+                        continue;
+
+                d = end[PMU_READ_HDR + pmu->slot[i]]
+                    - pmu->begin[PMU_READ_HDR + pmu->slot[i]];
+
+                pmu->total[i] += d;
+                perf_hist_add(&pmu->hist[i], d);
+        }
+
+        ++pmu->samples;
+}
+
+static
+void print_pmu_ratio(const char* label, const struct rsched_pmu* pmu,
+                     uint32_t num, uint32_t den, double scale)
+{
+        if(pmu->fd[num] < 0 || pmu->fd[den] < 0 || !pmu->total[den])
+                return;
+
+        PARAM_INFO(label, "%.3f",
+                   (double)pmu->total[num] * scale / (double)pmu->total[den]);
+}
+
+static
+void print_pmu_stats(const struct rsched_pmu* pmu, bool details)
+{
+        uint32_t i;
+
+        if(!pmu->n)
+        {
+                LOG_SAY("Counters are not available");
+                return;
+        }
+
+        PARAM_INFO("Tiles", "%'" PRIu64, pmu->samples);
+        PARAM_INFO("Tiles dropped", "%'" PRIu64, pmu->dropped);
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+        {
+                if(pmu->fd[i] < 0)
+                        continue;
+
+                PARAM_INFO(pmu_events[i].name, "%'" PRIu64, pmu->total[i]);
+
+                if(!details)
+                        continue;
+
+                LOG_SAY("    per tile p50 %'" PRIu64 ", p99 %'" PRIu64
+                        ", max %'" PRIu64,
+                        perf_hist_percentile(&pmu->hist[i], 50),
+                        perf_hist_percentile(&pmu->hist[i], 99),
+                        pmu->samples ? pmu->hist[i].max : 0);
+        }
+
+        print_pmu_ratio("IPC", pmu, RS_PMU_INSTRUCTIONS, RS_PMU_CYCLES, 1);
+        print_pmu_ratio("Branch MPKI", pmu, RS_PMU_BRANCH_MISSES,
+                        RS_PMU_INSTRUCTIONS, 1000);
+        print_pmu_ratio("L1D MPKI", pmu, RS_PMU_L1D_MISSES,
+                        RS_PMU_INSTRUCTIONS, 1000);
+        print_pmu_ratio("LLC MPKI", pmu, RS_PMU_LLC_MISSES,
+                        RS_PMU_INSTRUCTIONS, 1000);
+
+        /* 8 floats per instruction, FMA is counted twice */
+        print_pmu_ratio("FLOP per cycle", pmu, RS_PMU_FP_256_PS,
+                        RS_PMU_CYCLES, 8);
+}
+
+/* Sum counters of src into dst, dst takes the event set of the first
+ * source with counters
+ */
+static
+void pmu_merge(struct rsched_pmu* dst, const struct rsched_pmu* src)
+{
+        uint32_t i;
+
+        if(!src->n)
+                return;
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+        {
+                if(src->fd[i] < 0)
+                        continue;
+
+                if(dst->fd[i] < 0)
+                {
+                        /* Mark the event present, the descriptor is
+                         * never used for a merged result */
+                        dst->fd[i] = src->fd[i];
+                        perf_hist_init(&dst->hist[i]);
+                        ++dst->n;
+                }
+
+                dst->total[i] += src->total[i];
+                perf_hist_merge(&dst->hist[i], &src->hist[i]);
+        }
+
+        dst->samples += src->samples;
+        dst->dropped += src->dropped;
+}
+
+void rsched_print_pmu_stats(struct rsched* sched)
+{
+        struct rsched_pmu all;
+        uint32_t i;
+
+        rsched_pmu_init(&all, true);
+
+        LOG_SAY("==============================================");
+        LOG_SAY("************ HARDWARE COUNTERS ***************");
+        LOG_SAY("==============================================");
+
+        LOG_SAY("Worker [host] counters");
+        print_pmu_stats(&sched->host_pmu, false);
+        pmu_merge(&all, &sched->host_pmu);
+
+        for(i = 0; i < sched->n_workers; ++i)
+        {
+                LOG_SAY("Worker [%d] counters", i);
+                print_pmu_stats(&sched->worker[i].pmu, false);
+                pmu_merge(&all, &sched->worker[i].pmu);
+        }
+
+        LOG_SAY("Worker [all] counters");
+        print_pmu_stats(&all, true);
+
+        LOG_SAY("==============================================");
+
+        for(i = 0; i < RS_PMU_LAST; ++i)
+                if(all.fd[i] >= 0)
+                        perf_hist_destroy(&all.hist[i]);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+/* Hardware performance counters per tile.
+ *
+ * Every worker including the host one opens its own group of counters
+ * with perf_event_open, counting only its own thread in user space.
+ * The whole group is read with a single read() before and after each
+ * tile, deltas are accumulated into totals and per-tile histograms.
+ *
+ * Counters must be opened by the owner thread, a perf event opened with
+ * pid 0 counts only the thread which opened it.
+ * Events not supported by the CPU or the kernel are skipped, if no counters
+ * can be opened at all ( e.g. perf_event_paranoid forbids them or there's
+ * no PMU in a virtual machine ) the worker runs without counters.
+ * Samples during which the kernel multiplexed the group off the PMU
+ * are dropped since they don't cover the whole tile.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <tools/compiler.h>
+#include <tools/hist.h>
+
+enum
+{
+        RS_PMU_CYCLES           = 0,
+        RS_PMU_INSTRUCTIONS     = 1,
+        RS_PMU_BRANCH_MISSES    = 2,
+        RS_PMU_L1D_MISSES       = 3,
+        RS_PMU_LLC_MISSES       = 4,
+        RS_PMU_FP_256_PS        = 5,
+
+        RS_PMU_LAST
+};
+
+/* struct rsched_pmu - per worker counters.
+ *
+ * @requested - counters are enabled by options.
+ * @fd        - event file descriptors, -1 if an event is not opened,
+ *              the first opened one is the group leader.
+ * @slot      - position of an event in the group read buffer.
+ * @n         - count of opened events, 0 if counters are disabled.
+ * @begin     - group read buffer at the tile start.
+ * @total     - event counts over all measured tiles.
+ * @hist      - per-tile event counts.
+ * @samples   - count of measured tiles.
+ * @dropped   - count of tiles dropped due to multiplexing.
+ */
+struct rsched_pmu
+{
+        bool requested;
+
+        int fd[RS_PMU_LAST];
+        uint32_t slot[RS_PMU_LAST];
+        uint32_t n;
+
+        uint64_t begin[RS_PMU_LAST + 3];
+
+        uint64_t total[RS_PMU_LAST];
+        struct perf_hist hist[RS_PMU_LAST];
+
+        uint64_t samples;
+        uint64_t dropped;
+};
+
+/* No counters are opened here, see rsched_pmu_open */
+void rsched_pmu_init(struct rsched_pmu* pmu, bool enable);
+
+/* Open counters for the calling thread if they're requested */
+int rsched_pmu_open(struct rsched_pmu* pmu);
+
+void rsched_pmu_destroy(struct rsched_pmu* pmu);
+
+static inline
+bool rsched_pmu_enabled(const struct rsched_pmu* pmu)
+{
+        return unlikely(pmu->n != 0);
+}
+
+/* Sample counters at the beginning of a tile */
+void rsched_pmu_begin(struct rsched_pmu* pmu);
+
+/* Sample counters at the end of a tile and account the difference */
+void rsched_pmu_end(struct rsched_pmu* pmu);
+
+struct rsched;
+
+/* Print counters of all workers.
+ * Must not be called while workers are running.
+ */
+void rsched_print_pmu_stats(struct rsched* sched);
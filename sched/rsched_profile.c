@@ -1,20 +1,16 @@
+#include <stddef.h>
+#include <string.h>
 #include <tools/log.h>
 #include "rsched_profile.h"
 #include "rsched.h"
 
-#if defined(CONFIG_RSCHED_PROFILE)
-void rsched_profile_stat_init(struct profile_stat* stat,
-                              struct rsched_profile_hist_options* opts)
+void rsched_profile_stat_init(struct profile_stat* stat)
 {
         stat->max = 0;
         stat->min = UINT64_MAX;
         stat->total = 0;
 
-        perf_hist_init(&stat->hist,
-                       opts->size,
-                       opts->min,
-                       opts->max,
-                       opts->log_scale);
+        perf_hist_init(&stat->hist);
 }
 
 void rsched_profile_stat_destroy(struct profile_stat* stat)
@@ -25,9 +21,19 @@ void rsched_profile_stat_destroy(struct profile_stat* stat)
 void rsched_profile_init(struct profile_stats* stats,
                          struct rsched_profile_options* opts)
 {
-        rsched_profile_stat_init(&stats->run, &opts->run_hist);
-        rsched_profile_stat_init(&stats->task, &opts->task_hist);
-        rsched_profile_stat_init(&stats->payload, &opts->payload_hist);
+        UNUSED_PARAM(opts);
+
+        rsched_profile_stat_init(&stats->run);
+        rsched_profile_stat_init(&stats->task);
+        rsched_profile_stat_init(&stats->payload);
+
+        stats->cas_retries   = 0;
+        stats->start_latency = 0;
+        stats->idle_tail     = 0;
+
+        stats->frame_busy    = 0;
+        stats->frame_first   = 0;
+        stats->frame_last    = 0;
 }
 
 void rsched_profile_destroy(struct profile_stats* stats)
@@ -37,11 +43,107 @@ void rsched_profile_destroy(struct profile_stats* stats)
         rsched_profile_stat_destroy(&stats->payload);
 }
 
+void rsched_profile_reset(struct profile_stats* stats)
+{
+        rsched_profile_destroy(stats);
+        rsched_profile_init(stats, NULL);
+}
+
+void rsched_stats_init(struct rsched_stats* stats,
+                       struct rsched_profile_options* opts)
+{
+        stats->opts = *opts;
+        stats->request = opts->enabled;
+        stats->enabled = opts->enabled;
+
+        perf_hist_init(&stats->imbalance);
+        rsched_stats_reset(stats);
+}
+
+void rsched_stats_destroy(struct rsched_stats* stats)
+{
+        perf_hist_destroy(&stats->imbalance);
+}
+
+void rsched_stats_reset(struct rsched_stats* stats)
+{
+        uint64_t* bucket = stats->imbalance.bucket;
+
+        memset(bucket, 0, PERF_HIST_BUCKETS * sizeof(*bucket));
+        stats->imbalance.count = 0;
+        stats->imbalance.min = UINT64_MAX;
+        stats->imbalance.max = 0;
+
+        stats->frames = 0;
+        stats->start_ticks = 0;
+        stats->wait_ticks = 0;
+        stats->imbalance_sum = 0;
+}
+
+/* Close the frame of one worker, returns its busy time in ticks */
+static
+uint64_t profile_frame_worker(struct profile_stats* stats,
+                              uint64_t start, uint64_t end)
+{
+        uint64_t busy = stats->frame_busy;
+
+        if(stats->frame_first)
+        {
+                stats->start_latency +=
+                        perf_ticks_to_ns(stats->frame_first - start);
+                stats->idle_tail +=
+                        perf_ticks_to_ns(end - stats->frame_last);
+        }
+        else
+        {
+                /* No tiles in this frame */
+                stats->idle_tail += perf_ticks_to_ns(end - start);
+        }
+
+        stats->frame_busy = 0;
+        stats->frame_first = 0;
+        stats->frame_last = 0;
+
+        return busy;
+}
+
+void rsched_profile_frame(struct rsched* sched, uint64_t start, uint64_t end)
+{
+        struct rsched_stats* st = &sched->stats;
+        uint64_t busy, busy_max, busy_sum;
+        double mean, imbalance;
+        uint32_t i;
+
+        busy = profile_frame_worker(&sched->host_stats.profile, start, end);
+        busy_max = busy;
+        busy_sum = busy;
+
+        for(i = 0; i < sched->n_workers; ++i)
+        {
+                busy = profile_frame_worker(&sched->worker[i].stats.profile,
+                                            start, end);
+                busy_max = MAX(busy_max, busy);
+                busy_sum += busy;
+        }
+
+        ++st->frames;
+
+        if(!busy_sum)
+                return;
+
+        mean = (double)busy_sum / (sched->n_workers + 1);
+        imbalance = ((double)busy_max - mean) / mean;
+
+        st->imbalance_sum += imbalance;
+        perf_hist_add(&st->imbalance, (uint64_t)(imbalance * 10000 + 0.5));
+}
+
 
 static
-void print_worker_stats(struct worker_stats* stats)
+void print_worker_stats(struct worker_stats* stats, uint64_t frames)
 {
         struct profile_stats* profile;
+        uint64_t task_count;
         uint64_t task_time_avg;
         uint64_t payload_avg;
         uint64_t overhead_total;
@@ -49,112 +151,161 @@ void print_worker_stats(struct worker_stats* stats)
 
         profile = &stats->profile;
 
-        task_time_avg = profile->task.total / MAX(stats->task_count, 1);
-        payload_avg = profile->payload.total / MAX(stats->task_count, 1);
+        /* Tasks processed while profiling was on */
+        task_count = profile->payload.hist.count;
+
+        task_time_avg = profile->task.total / MAX(task_count, 1);
+        payload_avg = profile->payload.total / MAX(task_count, 1);
         overhead_total = profile->task.total - profile->payload.total;
         overhead_avg = task_time_avg - payload_avg;
         overhead_min = profile->task.min - profile->payload.min;
         overhead_max = profile->task.max - profile->payload.max;
 
         PARAM_INFO("Run time", "%'lu ns", profile->run.total);
-        PARAM_INFO("Task count", "%'lu", stats->task_count);
+        PARAM_INFO("Task count", "%'lu", task_count);
         PARAM_INFO("Task total", "%'lu ns", profile->task.total);
         PARAM_INFO("Task avg", "%'lu ns", task_time_avg);
         PARAM_INFO("Task min", "%'lu ns", profile->task.min);
         PARAM_INFO("Task max", "%'lu ns", profile->task.max);
+        PARAM_INFO("Task p50", "%'lu ns",
+                   perf_hist_percentile(&profile->task.hist, 50));
+        PARAM_INFO("Task p99", "%'lu ns",
+                   perf_hist_percentile(&profile->task.hist, 99));
         PARAM_INFO("Payload total", "%'lu ns", profile->payload.total);
         PARAM_INFO("Payload avg", "%'lu ns", payload_avg);
         PARAM_INFO("Payload min", "%'lu ns", profile->payload.min);
         PARAM_INFO("Payload max", "%'lu ns", profile->payload.max);
+        PARAM_INFO("Payload p50", "%'lu ns",
+                   perf_hist_percentile(&profile->payload.hist, 50));
+        PARAM_INFO("Payload p99", "%'lu ns",
+                   perf_hist_percentile(&profile->payload.hist, 99));
         PARAM_INFO("Overhead total", "%'lu ns", overhead_total);
         PARAM_INFO("Overhead avg", "%'ld ns", overhead_avg);
         PARAM_INFO("Overhead min", "%'ld ns", overhead_min);
         PARAM_INFO("Overhead max", "%'ld ns", overhead_max);
+        PARAM_INFO("CAS retries", "%'lu", profile->cas_retries);
+        PARAM_INFO("CAS retries per task", "%.3f",
+                   (double)profile->cas_retries / MAX(task_count, 1));
+        PARAM_INFO("Start latency avg", "%'lu ns",
+                   profile->start_latency / MAX(frames, 1));
+        PARAM_INFO("Idle tail avg", "%'lu ns",
+                   profile->idle_tail / MAX(frames, 1));
 }
 
-
 static
-void print_workers_run_hist(struct rsched* sched)
+void print_sync_stats(struct rsched* sched)
 {
-        uint32_t i;
-
-        LOG_SAY("==============================================");
-        LOG_SAY("Worker [host] run time histogram");
-
-        perf_hist_print(&sched->host_stats.profile.run.hist);
-
-        for(i = 0; i < sched->n_workers; ++i)
-        {
-                LOG_SAY("Worker [%d] run time histogram", i);
-                perf_hist_print(&sched->worker[i].stats.profile.run.hist);
-        }
-
+        struct rsched_stats* st = &sched->stats;
+        uint64_t frames = MAX(st->frames, 1);
+
+        LOG_SAY("Synchronization summary");
+
+        PARAM_INFO("Start workers avg", "%'lu ns",
+                   perf_ticks_to_ns(st->start_ticks) / frames);
+        PARAM_INFO("Wait workers avg", "%'lu ns",
+                   perf_ticks_to_ns(st->wait_ticks) / frames);
+
+        if(!st->imbalance.count)
+                return;
+
+        /* Imbalance is recorded in 1/100 of a percent */
+        PARAM_INFO("Imbalance avg", "%.2f %%",
+                   st->imbalance_sum * 100 / (double)st->imbalance.count);
+        PARAM_INFO("Imbalance p50", "%.2f %%",
+                   perf_hist_percentile(&st->imbalance, 50) / 100.0);
+        PARAM_INFO("Imbalance p99", "%.2f %%",
+                   perf_hist_percentile(&st->imbalance, 99) / 100.0);
+        PARAM_INFO("Imbalance max", "%.2f %%",
+                   st->imbalance.max / 100.0);
 }
 
-static
-void print_workers_task_hist(struct rsched* sched)
+static inline
+struct profile_stat* profile_stat_at(struct worker_stats* stats, size_t offset)
 {
-        uint32_t i;
-
-        LOG_SAY("==============================================");
-        LOG_SAY("Worker [host] task time histogram");
-
-        perf_hist_print(&sched->host_stats.profile.task.hist);
-
-        for(i = 0; i < sched->n_workers; ++i)
-        {
-                LOG_SAY("Worker [%d] task time histogram", i);
-                perf_hist_print(&sched->worker[i].stats.profile.task.hist);
-        }
-
+        return (struct profile_stat*)((char*)&stats->profile + offset);
 }
 
+/* Print histograms of one profile_stat of every worker
+ * and of all of them merged together.
+ * offset - offset of the profile_stat in struct profile_stats.
+ */
 static
-void print_workers_payload_hist(struct rsched* sched)
+void print_workers_hist(struct rsched* sched, const char* name, size_t offset,
+                        const struct rsched_profile_hist_options* opts)
 {
+        struct perf_hist all;
+        struct profile_stat* stat;
         uint32_t i;
 
+        perf_hist_init(&all);
+
         LOG_SAY("==============================================");
-        LOG_SAY("Worker [host] payload time histogram");
+        LOG_SAY("Worker [host] %s time histogram", name);
 
-        perf_hist_print(&sched->host_stats.profile.payload.hist);
+        stat = profile_stat_at(&sched->host_stats, offset);
+        perf_hist_print(&stat->hist, opts->size, opts->min, opts->max,
+                        opts->log_scale);
+        perf_hist_merge(&all, &stat->hist);
 
         for(i = 0; i < sched->n_workers; ++i)
         {
-                LOG_SAY("Worker [%d] payload time histogram", i);
-                perf_hist_print(&sched->worker[i].stats.profile.payload.hist);
+                LOG_SAY("Worker [%d] %s time histogram", i, name);
+
+                stat = profile_stat_at(&sched->worker[i].stats, offset);
+                perf_hist_print(&stat->hist, opts->size, opts->min, opts->max,
+                                opts->log_scale);
+                perf_hist_merge(&all, &stat->hist);
         }
 
+        LOG_SAY("Worker [all] %s time histogram", name);
+        perf_hist_print(&all, opts->size, opts->min, opts->max,
+                        opts->log_scale);
+        perf_hist_print_percentiles(&all);
+
+        perf_hist_destroy(&all);
 }
 
 void rsched_print_stats(struct rsched* sched)
 {
+        struct rsched_profile_options* opts = &sched->stats.opts;
         uint32_t i;
 
+        if(!sched->stats.frames)
+                return;
+
         LOG_SAY("==============================================");
         LOG_SAY("**************** RSCHED STATS ****************");
         LOG_SAY("==============================================");
 
+        PARAM_INFO("Profiled frames", "%'lu", sched->stats.frames);
+
         LOG_SAY("Worker [Host] summary");
-        print_worker_stats(&sched->host_stats);
+        print_worker_stats(&sched->host_stats, sched->stats.frames);
 
         for(i = 0; i < sched->n_workers; ++i)
         {
                 LOG_SAY("Worker [%d] summary", i);
-                print_worker_stats(&sched->worker[i].stats);
+                print_worker_stats(&sched->worker[i].stats,
+                                   sched->stats.frames);
         }
 
-        if(sched->stats.run_time_hist_show)
-                print_workers_run_hist(sched);
+        print_sync_stats(sched);
 
+        if(opts->run_hist.show)
+                print_workers_hist(sched, "run",
+                                   offsetof(struct profile_stats, run),
+                                   &opts->run_hist);
 
-        if(sched->stats.task_time_hist_show)
-                print_workers_task_hist(sched);
+        if(opts->task_hist.show)
+                print_workers_hist(sched, "task",
+                                   offsetof(struct profile_stats, task),
+                                   &opts->task_hist);
 
-        if(sched->stats.payload_hist_show)
-                print_workers_payload_hist(sched);
+        if(opts->payload_hist.show)
+                print_workers_hist(sched, "payload",
+                                   offsetof(struct profile_stats, payload),
+                                   &opts->payload_hist);
 
         LOG_SAY("==============================================");
 }
 
-#endif /* CONFIG_RSCHED_PROFILE */
\ No newline at end of file
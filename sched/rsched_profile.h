@@ -2,8 +2,10 @@
 
 #include <config/config.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <tools/timer.h>
 #include <tools/hist.h>
+#include <tools/atomic.h>
 
 #define sample_max_time(vptr, sample) \
         do { if(*(vptr) < (sample)) *(vptr) = sample; } while(0)
@@ -11,7 +13,16 @@
 #define sample_min_time(vptr, sample) \
         do { if(*(vptr) > (sample)) *(vptr) = sample; } while(0)
 
-#ifdef CONFIG_RSCHED_PROFILE
+/* Profiling is always compiled in and switched at run time.
+ *
+ * Workers and the host pick the profiling or the plain version of their
+ * loops at the start of every frame, so disabled profiling costs nothing
+ * in the task loop ( see rsched_set_profiling ).
+ */
+
+/* Display options of a histogram, the histogram itself always
+ * records the whole range. 0 for min or max means auto range.
+ */
 struct rsched_profile_hist_options
 {
         bool show;
@@ -20,8 +31,14 @@ struct rsched_profile_hist_options
         uint64_t min, max;
 };
 
+/* struct rsched_profile_options - profiling options.
+ *
+ * @enabled - profile from the start.
+ */
 struct rsched_profile_options
 {
+        bool enabled;
+
         struct rsched_profile_hist_options run_hist;
         struct rsched_profile_hist_options task_hist;
         struct rsched_profile_hist_options payload_hist;
@@ -36,13 +53,42 @@ struct profile_stat
         struct perf_timer tm;
 };
 
+/* struct rsched_stats - scheduler profiling state.
+ *
+ * @opts          - profiling options.
+ * @request       - profiling requested by rsched_set_profiling.
+ * @enabled       - profiling state of the current frame,
+ *                  changed by the host between frames only.
+ * @frames        - count of profiled frames.
+ * @start_ticks   - time the host spent signaling workers to start.
+ * @wait_ticks    - time the host spent spinning in rsched_wait_workers.
+ * @imbalance     - per-frame load imbalance in 1/100 of a percent.
+ * @imbalance_sum - sum of per-frame imbalance values.
+ */
 struct rsched_stats
 {
-        bool run_time_hist_show;
-        bool task_time_hist_show;
-        bool payload_hist_show;
+        struct rsched_profile_options opts;
+
+        __atomic int request;
+        __atomic int enabled;
+
+        uint64_t frames;
+
+        uint64_t start_ticks;
+        uint64_t wait_ticks;
+
+        struct perf_hist imbalance;
+        double imbalance_sum;
 };
 
+void rsched_stats_init(struct rsched_stats* stats,
+                       struct rsched_profile_options* opts);
+
+void rsched_stats_destroy(struct rsched_stats* stats);
+
+/* Drop all recorded frame stats, the profiling state is kept */
+void rsched_stats_reset(struct rsched_stats* stats);
+
 struct profile_stats;
 
 void rsched_profile_init(struct profile_stats* stats,
@@ -50,8 +96,10 @@ void rsched_profile_init(struct profile_stats* stats,
 
 void rsched_profile_destroy(struct profile_stats* stats);
 
-void rsched_profile_stat_init(struct profile_stat* stat,
-                              struct rsched_profile_hist_options* opts);
+/* Drop all recorded samples */
+void rsched_profile_reset(struct profile_stats* stats);
+
+void rsched_profile_stat_init(struct profile_stat* stat);
 
 void rsched_profile_stat_destroy(struct profile_stat* stat);
 
@@ -81,25 +129,51 @@ void rsched_profile_stop(struct profile_stat* stat)
 struct rsched;
 void rsched_print_stats(struct rsched* sched);
 
-#else
-struct rsched_profile_hist_options {};
-struct rsched_profile_options {};
-struct profile_stat {};
-struct rsched_stats {};
-
-#define rsched_profile_start(stat) UNUSED_PARAM(stat)
-#define rsched_profile_stop(stat) UNUSED_PARAM(stat)
-
-#define rsched_profile_init(stats,opts) UNUSED_PARAM(stats); UNUSED_PARAM(opts)
-#define rsched_profile_destroy(stats) UNUSED_PARAM(stats)
-
-#define rsched_print_stats(sched) UNUSED_PARAM(sched)
-
-#endif
-
+/* struct profile_stats - profiling stats of a worker.
+ *
+ * @cas_retries   - failed CAS attempts in rsched_queue_pop.
+ * @start_latency - time from a frame start to the first tile, ns.
+ * @idle_tail     - time from the last tile to a frame end, ns.
+ * @frame_busy    - payload time in the current frame, ticks.
+ * @frame_first   - start of the first tile in the current frame, ticks.
+ * @frame_last    - end of the last tile in the current frame, ticks.
+ *
+ * Frame fields are written by the worker and read and cleared by the host
+ * in rsched_profile_frame while the worker is parked.
+ */
 struct profile_stats
 {
         struct profile_stat run;
         struct profile_stat task;
         struct profile_stat payload;
+
+        uint64_t cas_retries;
+        uint64_t start_latency;
+        uint64_t idle_tail;
+
+        uint64_t frame_busy;
+        uint64_t frame_first;
+        uint64_t frame_last;
 };
+
+/* Account a tile in the current frame, must follow
+ * rsched_profile_stop of the payload stat.
+ */
+static inline
+void rsched_profile_tile(struct profile_stats* stats)
+{
+        struct perf_timer* tm = &stats->payload.tm;
+
+        if(!stats->frame_first)
+                stats->frame_first = tm->start;
+
+        stats->frame_last = tm->end;
+        stats->frame_busy += tm->end - tm->start;
+}
+
+/* Close a profiled frame: compute idle tails, start latencies and the load
+ * imbalance ( max - mean ) / mean of busy time over all workers.
+ * start and end are frame bounds in timer ticks.
+ * Must be called by the host while workers are parked.
+ */
+void rsched_profile_frame(struct rsched* sched, uint64_t start, uint64_t end);
@@ -12,6 +12,7 @@ void rsched_queue_init(struct rsched_queue* queue)
         queue->tasks    = NULL;
         queue->capacity = 0;
         queue->length   = 0;
+        queue->cost     = NULL;
         atomic_store(&queue->cur_task_idx, 0);
 }
 
@@ -20,6 +21,9 @@ void rsched_queue_destroy(struct rsched_queue* queue)
         free(queue->tasks);
         queue->tasks    = NULL;
 
+        free(queue->cost);
+        queue->cost     = NULL;
+
         queue->length   = 0;
         queue->capacity = 0;
 
@@ -36,6 +40,13 @@ void rsched_queue_resize(struct rsched_queue* queue,
                 free(queue->tasks);
 
                 queue->tasks = calloc(n, sizeof(*queue->tasks));
+
+                if(queue->cost)
+                {
+                        free(queue->cost);
+                        queue->cost = calloc(n, sizeof(*queue->cost));
+                }
+
                 queue->capacity = n;
                 queue->length = 0;
 
@@ -56,6 +67,16 @@ void rsched_queue_resize(struct rsched_queue* queue,
                                n * sizeof(*queue->tasks));
                 }
 
+                if(queue->cost)
+                {
+                        queue->cost = realloc(queue->cost,
+                                              new_cap * sizeof(*queue->cost));
+
+                        memset(queue->cost + queue->capacity,
+                               0,
+                               n * sizeof(*queue->cost));
+                }
+
                 queue->capacity = new_cap;
         }
         else
@@ -64,6 +85,15 @@ void rsched_queue_resize(struct rsched_queue* queue,
         }
 }
 
+void rsched_queue_record_costs(struct rsched_queue* queue, bool enable)
+{
+        free(queue->cost);
+        queue->cost = NULL;
+
+        if(enable)
+                queue->cost = calloc(MAX(queue->capacity, 1),
+                                     sizeof(*queue->cost));
+}
 
 void rsched_queue_push(struct rsched_queue* queue,
                               uint32_t x0, uint32_t x1,
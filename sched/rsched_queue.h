@@ -1,7 +1,11 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <tools/atomic.h>
+#include <tools/timer.h>
+
+#include "rsched_common.h"
 
 /*
  * Scheduler queue management
@@ -33,14 +37,24 @@ struct rsched_task
 
 struct rsched_queue
 {
+        /* The only field every worker writes, it's kept on its own cache
+         * line so a pop doesn't invalidate the read-only fields below.
+         */
+        __cache_aligned
         __atomic
         uint32_t cur_task_idx;
 
+        __cache_aligned
         struct rsched_task* tasks;
 
         uint32_t capacity;
 
         uint32_t length;
+
+        /* Accumulated payload time of each task in ns,
+         * NULL if cost recording is disabled.
+         */
+        uint64_t* cost;
 };
 
 void rsched_queue_init(struct rsched_queue* queue);
@@ -50,12 +64,22 @@ void rsched_queue_destroy(struct rsched_queue* queue);
 void rsched_queue_resize(struct rsched_queue* queue,
                          uint32_t n, int flags);
 
+/* Enable or disable recording of per-task costs.
+ * Enabling resets all recorded costs.
+ */
+void rsched_queue_record_costs(struct rsched_queue* queue, bool enable);
+
 void rsched_queue_push(struct rsched_queue* queue,
                        uint32_t x0, uint32_t x1,
                        uint32_t y0, uint32_t y1);
 
+/* Take the next task, NULL if the queue is drained.
+ * If retries isn't NULL it's incremented on every failed CAS, a constant
+ * NULL compiles the counting out.
+ */
 static inline
-struct rsched_task* rsched_queue_pop(struct rsched_queue* queue)
+struct rsched_task* rsched_queue_pop(struct rsched_queue* queue,
+                                     uint64_t* retries)
 {
         uint32_t cur = atomic_load(&queue->cur_task_idx);
 
@@ -65,6 +89,9 @@ struct rsched_task* rsched_queue_pop(struct rsched_queue* queue)
 
         while(!atomic_compare_exchange(&queue->cur_task_idx, &cur, cur + 1))
         {
+                if(retries)
+                        ++*retries;
+
                 if(cur >= queue->length)
                         return NULL;
 
@@ -74,6 +101,32 @@ struct rsched_task* rsched_queue_pop(struct rsched_queue* queue)
         return &queue->tasks[cur];
 }
 
+/* Run the user function on a task.
+ * If cost recording is enabled the payload time is added to the task cost.
+ * A task is owned by only one worker per processing stage, so no
+ * synchronization is required.
+ */
+static inline
+void rsched_queue_run_task(struct rsched_queue* queue, struct rsched_task* task,
+                           rsched_user_fun fun, void* ctx)
+{
+        struct perf_timer tm;
+
+        if(likely(queue->cost == NULL))
+        {
+                fun(task->x0, task->x1, task->y0, task->y1, ctx);
+                return;
+        }
+
+        perf_timer_start(&tm);
+
+        fun(task->x0, task->x1, task->y0, task->y1, ctx);
+
+        perf_timer_stop(&tm);
+
+        queue->cost[task - queue->tasks] += perf_timer_diff_ns(&tm);
+}
+
 void rsched_split_task(struct rsched_queue* queue, uint32_t x0, uint32_t x1,
                        uint32_t y0, uint32_t y1, struct block_size* grain);
 
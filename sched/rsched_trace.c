@@ -0,0 +1,167 @@
+#include "rsched_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+
+#include "rsched.h"
+
+static const char* trace_event_names[RS_TRACE_LAST] = {
+        "task",
+        "frame",
+        "start",
+        "wait",
+        "park"
+};
+
+void rsched_trace_init(struct rsched_trace_buf* buf, uint32_t size)
+{
+        uint32_t cap = 1;
+
+        buf->ev   = NULL;
+        buf->mask = 0;
+        buf->head = 0;
+
+        if(!size)
+                return;
+
+        while(cap < size && cap < (UINT32_C(1) << 31))
+                cap <<= 1;
+
+        buf->ev   = calloc(cap, sizeof(*buf->ev));
+        buf->mask = cap - 1;
+}
+
+void rsched_trace_destroy(struct rsched_trace_buf* buf)
+{
+        free(buf->ev);
+        buf->ev = NULL;
+}
+
+static
+uint64_t trace_first_index(const struct rsched_trace_buf* buf)
+{
+        uint64_t cap = (uint64_t)buf->mask + 1;
+
+        return buf->head > cap ? buf->head - cap : 0;
+}
+
+static
+uint64_t trace_min_timestamp(const struct rsched_trace_buf* buf, uint64_t ts)
+{
+        uint64_t i;
+
+        for(i = trace_first_index(buf); i < buf->head; ++i)
+                ts = MIN(ts, buf->ev[i & buf->mask].start);
+
+        return ts;
+}
+
+static
+void write_thread_name(FILE* f, uint32_t tid, const char* name, bool* first)
+{
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                *first ? "" : ",\n", tid, name);
+
+        *first = false;
+}
+
+static
+uint64_t write_buffer(FILE* f, const struct rsched_trace_buf* buf,
+                      uint32_t tid, uint64_t base, bool* first)
+{
+        uint64_t i;
+
+        for(i = trace_first_index(buf); i < buf->head; ++i)
+        {
+                const struct rsched_trace_event* e = &buf->ev[i & buf->mask];
+
+                fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"rsched\","
+                           "\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                           "\"ts\":%.3f,\"dur\":%.3f",
+                        *first ? "" : ",\n",
+                        trace_event_names[e->type], tid,
+                        perf_ticks_to_ns(e->start - base) / 1e3,
+                        perf_ticks_to_ns(e->end - e->start) / 1e3);
+
+                *first = false;
+
+                if(e->type == RS_TRACE_TASK)
+                        fprintf(f, ",\"args\":{\"x0\":%u,\"x1\":%u,"
+                                   "\"y0\":%u,\"y1\":%u}",
+                                e->x0, e->x1, e->y0, e->y1);
+                else if(e->type == RS_TRACE_FRAME)
+                        fprintf(f, ",\"args\":{\"frame\":%u}", e->frame);
+
+                fputc('}', f);
+        }
+
+        return trace_first_index(buf);
+}
+
+int rsched_save_trace(struct rsched* sched, const char* filename)
+{
+        char name[32];
+        uint64_t base = UINT64_MAX;
+        uint64_t dropped;
+        bool first = true;
+        uint32_t i;
+        FILE* f;
+
+        if(!rsched_trace_enabled(&sched->host_trace))
+        {
+                LOG_ERROR("Tracing is not enabled.");
+                return MDB_FAIL;
+        }
+
+        f = fopen(filename, "w");
+        if(!f)
+        {
+                LOG_ERROR("Failed to open '%s' for writing: %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        base = trace_min_timestamp(&sched->host_trace, base);
+        for(i = 0; i < sched->n_workers; ++i)
+                base = trace_min_timestamp(&sched->worker[i].trace, base);
+
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"args\":{\"name\":\"mdb rsched\"}}");
+        first = false;
+
+        /* tid 0 is the host, workers are 1..n */
+        write_thread_name(f, 0, "host", &first);
+        for(i = 0; i < sched->n_workers; ++i)
+        {
+                snprintf(name, sizeof(name), "worker%u", i);
+                write_thread_name(f, i + 1, name, &first);
+        }
+
+        dropped = write_buffer(f, &sched->host_trace, 0, base, &first);
+        for(i = 0; i < sched->n_workers; ++i)
+                dropped += write_buffer(f, &sched->worker[i].trace, i + 1,
+                                        base, &first);
+
+        fprintf(f, "\n]}\n");
+
+        if(fclose(f) != 0)
+        {
+                LOG_ERROR("Failed to write '%s': %s",
+                          filename, strerror(errno));
+                return MDB_FAIL;
+        }
+
+        if(dropped)
+                LOG_WARN("Trace buffers overflowed, %" PRIu64 " oldest events "
+                         "were dropped. Consider increasing the trace size.",
+                         dropped);
+
+        return MDB_SUCCESS;
+}
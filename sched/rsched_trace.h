@@ -0,0 +1,133 @@
+#pragma once
+
+/* Scheduler activity tracing.
+ *
+ * Every worker including the host one owns a fixed size ring buffer of
+ * trace events, only the owner thread writes to its buffer so recording
+ * an event is just two timer samples and a store, no atomics or locks
+ * are involved. When a buffer is full the oldest events are overwritten.
+ *
+ * Recorded events:
+ * task  - processing of a tile by a worker ( with tile coordinates ).
+ * frame - host yield, from waking up workers until all tasks are done.
+ * start - host sending start signals to workers.
+ * wait  - host waiting for workers at the end of a frame ( barrier ).
+ * park  - worker waiting for a start signal between frames.
+ *
+ * Buffers must be read only while workers are parked, the trace can be saved
+ * as Chrome trace-event JSON and opened in chrome://tracing or Perfetto.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <tools/compiler.h>
+#include <tools/timer.h>
+
+enum
+{
+        RS_TRACE_TASK   = 0,
+        RS_TRACE_FRAME  = 1,
+        RS_TRACE_START  = 2,
+        RS_TRACE_WAIT   = 3,
+        RS_TRACE_PARK   = 4,
+
+        RS_TRACE_LAST
+};
+
+struct rsched_trace_event
+{
+        uint64_t start, end;
+        uint32_t type;
+
+        /* Frame number for frame events */
+        uint32_t frame;
+
+        /* Tile coordinates for task events */
+        uint16_t x0, x1, y0, y1;
+};
+
+/* struct rsched_trace_buf - per worker ring buffer.
+ *
+ * @ev   - events, NULL if tracing is disabled.
+ * @mask - capacity - 1, capacity is a power of two.
+ * @head - count of events ever written.
+ */
+struct rsched_trace_buf
+{
+        struct rsched_trace_event* ev;
+        uint32_t mask;
+        uint64_t head;
+};
+
+/* Allocate a buffer for at least size events, 0 disables tracing */
+void rsched_trace_init(struct rsched_trace_buf* buf, uint32_t size);
+
+void rsched_trace_destroy(struct rsched_trace_buf* buf);
+
+static inline
+bool rsched_trace_enabled(const struct rsched_trace_buf* buf)
+{
+        return unlikely(buf->ev != NULL);
+}
+
+/* Returns a timestamp for trace events in timer ticks,
+ * they are converted to ns only when the trace is saved.
+ */
+static inline
+uint64_t rsched_trace_clock(void)
+{
+        return perf_ticks();
+}
+
+static inline
+struct rsched_trace_event* rsched_trace_push(struct rsched_trace_buf* buf,
+                                             uint32_t type, uint64_t start)
+{
+        struct rsched_trace_event* e = &buf->ev[buf->head & buf->mask];
+
+        ++buf->head;
+
+        e->type  = type;
+        e->start = start;
+        e->end   = rsched_trace_clock();
+
+        return e;
+}
+
+/* Record a span of the given type started at start and ended now */
+static inline
+void rsched_trace_span(struct rsched_trace_buf* buf, uint32_t type,
+                       uint64_t start)
+{
+        rsched_trace_push(buf, type, start);
+}
+
+static inline
+void rsched_trace_frame(struct rsched_trace_buf* buf, uint64_t frame,
+                        uint64_t start)
+{
+        struct rsched_trace_event* e;
+
+        e = rsched_trace_push(buf, RS_TRACE_FRAME, start);
+        e->frame = (uint32_t)frame;
+}
+
+static inline
+void rsched_trace_task(struct rsched_trace_buf* buf, uint32_t x0, uint32_t x1,
+                       uint32_t y0, uint32_t y1, uint64_t start)
+{
+        struct rsched_trace_event* e;
+
+        e = rsched_trace_push(buf, RS_TRACE_TASK, start);
+        e->x0 = (uint16_t)x0;
+        e->x1 = (uint16_t)x1;
+        e->y0 = (uint16_t)y0;
+        e->y1 = (uint16_t)y1;
+}
+
+struct rsched;
+
+/* Save all recorded events as Chrome trace-event JSON.
+ * Must not be called while workers are running.
+ */
+int rsched_save_trace(struct rsched* sched, const char* filename);
@@ -1,16 +1,22 @@
 #include <tools/hist.h>
 #include <tools/timer.h>
 #include <tools/error_codes.h>
+#include <tools/usdt.h>
+#include "rsched.h"
 #include "rsched_worker.h"
 #include "rsched_queue.h"
 
 
+/* Set by every worker at start, the host keeps 0 */
+__thread uint32_t __rsched_thread_id = 0;
+
 static void* rsched_worker(void* arg);
 
 void rsched_worker_init_stats(struct worker_stats* stats,
                               struct rsched_options* opts)
 {
         stats->task_count = 0;
+        stats->idle_ticks = 0;
 
         rsched_profile_init(&stats->profile, &opts->profile);
 
@@ -35,10 +41,14 @@ void rsched_worker_destroy(struct rsched_worker* worker)
         pthread_spin_destroy(&worker->lock);
 
         rsched_worker_destroy_stats(&worker->stats);
+
+        rsched_trace_destroy(&worker->trace);
+        rsched_pmu_destroy(&worker->pmu);
 }
 
 int rsched_worker_init(struct rsched_worker* worker, uint32_t id,
                        struct rsched_queue* queue,
+                       const __atomic int* profile,
                        struct rsched_options* opts)
 {
         static const size_t name_size = 32;
@@ -50,7 +60,11 @@ int rsched_worker_init(struct rsched_worker* worker, uint32_t id,
 
         rsched_worker_init_stats(&worker->stats, opts);
 
+        rsched_trace_init(&worker->trace, opts->trace_size);
+        rsched_pmu_init(&worker->pmu, opts->pmu);
+
         worker->queue = queue;
+        worker->profile = profile;
         worker->id = id;
 
         pthread_spin_init(&worker->lock, 0);
@@ -80,21 +94,33 @@ int rsched_worker_init(struct rsched_worker* worker, uint32_t id,
 
 
 
-__hot static
-int rsched_worker_loop(struct rsched_worker* worker,
-                       rsched_user_fun proc_fun, void* user_ctx)
+/* Task loop body, profile is a compile time constant so the profiling
+ * and the plain loops are generated from one body.
+ */
+static __always_inline
+int rsched_worker_run_tasks(struct rsched_worker* worker,
+                            rsched_user_fun proc_fun, void* user_ctx,
+                            const bool profile)
 {
         struct rsched_task* task;
+        struct rsched_trace_buf* trace = &worker->trace;
+        struct rsched_pmu* pmu = &worker->pmu;
+        struct profile_stats* stats = &worker->stats.profile;
 
         int sig;
 
-        rsched_profile_start(&worker->stats.profile.run);
+        if(profile)
+                rsched_profile_start(&worker->stats.profile.run);
 
         while(1)
         {
-                rsched_profile_start(&worker->stats.profile.task);
+                uint64_t ts = 0;
+
+                if(profile)
+                        rsched_profile_start(&worker->stats.profile.task);
 
-                task = rsched_queue_pop(worker->queue);
+                task = rsched_queue_pop(worker->queue,
+                                        profile ? &stats->cas_retries : NULL);
 
                 if(task == NULL)
                 {
@@ -103,13 +129,39 @@ int rsched_worker_loop(struct rsched_worker* worker,
                         goto loop_exit;
                 }
 
-                rsched_profile_start(&worker->stats.profile.payload);
+                MDB_PROBE1(task_pop, worker->id);
+
+                if(profile)
+                        rsched_profile_start(&worker->stats.profile.payload);
+
+                if(rsched_trace_enabled(trace))
+                        ts = rsched_trace_clock();
+
+                if(rsched_pmu_enabled(pmu))
+                        rsched_pmu_begin(pmu);
 
-                proc_fun(task->x0, task->x1, task->y0, task->y1, user_ctx);
+                MDB_PROBE5(task_begin, worker->id, task->x0, task->x1,
+                           task->y0, task->y1);
 
-                ++worker->stats.task_count;
+                rsched_queue_run_task(worker->queue, task, proc_fun, user_ctx);
 
-                rsched_profile_stop(&worker->stats.profile.payload);
+                MDB_PROBE5(task_end, worker->id, task->x0, task->x1,
+                           task->y0, task->y1);
+
+                if(rsched_pmu_enabled(pmu))
+                        rsched_pmu_end(pmu);
+
+                if(rsched_trace_enabled(trace))
+                        rsched_trace_task(trace, task->x0, task->x1,
+                                          task->y0, task->y1, ts);
+
+                atomic_add_single_writer(&worker->stats.task_count, 1);
+
+                if(profile)
+                {
+                        rsched_profile_stop(&stats->payload);
+                        rsched_profile_tile(stats);
+                }
 
                 sig = rsched_worker_sig_lock_receive(worker);
 
@@ -119,7 +171,9 @@ int rsched_worker_loop(struct rsched_worker* worker,
                 case RS_SIG_START:
                 {
                         rsched_worker_sig_unlock(worker);
-                        rsched_profile_stop(&worker->stats.profile.task);
+                        if(profile)
+                                rsched_profile_stop(
+                                        &worker->stats.profile.task);
                         continue;
                 }
 
@@ -131,12 +185,29 @@ int rsched_worker_loop(struct rsched_worker* worker,
         }
 
 loop_exit:
-        rsched_profile_stop(&worker->stats.profile.task);
-        rsched_profile_stop(&worker->stats.profile.run);
+        if(profile)
+        {
+                rsched_profile_stop(&worker->stats.profile.task);
+                rsched_profile_stop(&worker->stats.profile.run);
+        }
 
         return sig;
 }
 
+__hot static
+int rsched_worker_loop(struct rsched_worker* worker,
+                       rsched_user_fun proc_fun, void* user_ctx)
+{
+        return rsched_worker_run_tasks(worker, proc_fun, user_ctx, false);
+}
+
+__hot static
+int rsched_worker_loop_profile(struct rsched_worker* worker,
+                               rsched_user_fun proc_fun, void* user_ctx)
+{
+        return rsched_worker_run_tasks(worker, proc_fun, user_ctx, true);
+}
+
 static
 void* rsched_worker(void* arg)
 {
@@ -144,20 +215,42 @@ void* rsched_worker(void* arg)
         rsched_user_fun proc_fun;
         void* user_ctx;
         uint32_t worker_id = worker->id;
+        uint64_t park_ts;
+        bool profile = false;
 
         int sig;
 
+        __rsched_thread_id = worker_id + 1;
+
+        /* Counters count only the thread which opened them */
+        rsched_pmu_open(&worker->pmu);
+
         goto worker_yield;
 
 worker_loop:
-        sig = rsched_worker_loop(worker, proc_fun, user_ctx);
+        if(unlikely(profile))
+                sig = rsched_worker_loop_profile(worker, proc_fun, user_ctx);
+        else
+                sig = rsched_worker_loop(worker, proc_fun, user_ctx);
 
         if(sig != RS_SIG_NONE)
                 goto sig_handle;
 
 worker_yield:
+        park_ts = perf_ticks();
+
+        MDB_PROBE1(worker_park, worker_id);
+
         sig = rsched_worker_yield(worker);
 
+        MDB_PROBE1(worker_unpark, worker_id);
+
+        atomic_add_single_writer(&worker->stats.idle_ticks,
+                                 perf_ticks() - park_ts);
+
+        if(rsched_trace_enabled(&worker->trace))
+                rsched_trace_span(&worker->trace, RS_TRACE_PARK, park_ts);
+
 sig_handle:
         if(likely(sig == RS_SIG_START))
         {
@@ -166,6 +259,9 @@ sig_handle:
                 proc_fun = worker->user_fun;
                 pthread_spin_unlock(&worker->lock);
 
+                /* The host changes it only while workers are parked */
+                profile = atomic_load(worker->profile);
+
                 if(proc_fun == NULL)
                 {
                         LOG_ERROR("Worker [%d]. "
@@ -9,6 +9,8 @@
 #include "rsched_common.h"
 #include "rsched_queue.h"
 #include "rsched_profile.h"
+#include "rsched_trace.h"
+#include "rsched_pmu.h"
 
 enum
 {
@@ -32,9 +34,18 @@ enum
 
 };
 
+/* struct worker_stats - worker statistics.
+ *
+ * @task_count - count of processed tasks.
+ * @idle_ticks - timer ticks spent waiting for other workers.
+ *
+ * Counters are written only by the owner thread
+ * and can be read at any time with atomic_load_relaxed.
+ */
 struct worker_stats
 {
         uint64_t task_count;
+        uint64_t idle_ticks;
 
         struct profile_stats profile;
 };
@@ -46,6 +57,9 @@ struct rsched_worker
          */
         struct rsched_queue* queue;
 
+        /* Profiling state of the scheduler, read at a frame start */
+        const __atomic int* profile;
+
         pthread_spinlock_t lock;
 
         /* Shared data, read/write on lock */
@@ -54,8 +68,15 @@ struct rsched_worker
 
         /* --------------------------- */
 
+        /* Written only by the worker itself, starts a new cache line
+         * so the fields above stay clean in other cores' caches
+         */
+        __cache_aligned
         struct worker_stats stats;
 
+        struct rsched_trace_buf trace;
+        struct rsched_pmu pmu;
+
         uint32_t id;
 
         pthread_t pthr_id;
@@ -75,6 +96,7 @@ struct rsched_worker
 
 int rsched_worker_init(struct rsched_worker* worker, uint32_t id,
                        struct rsched_queue* queue,
+                       const __atomic int* profile,
                        struct rsched_options* opts);
 
 void rsched_worker_destroy(struct rsched_worker* worker);
@@ -12,7 +12,7 @@
 
 static
 int surface_create_buffer(void** pbuffer, uint32_t width, uint32_t height,
-                          int type)
+                          int flags)
 {
         size_t size     = width * height;
         size_t mem_size = size * sizeof(float);
@@ -21,8 +21,7 @@ int surface_create_buffer(void** pbuffer, uint32_t width, uint32_t height,
         float* surface;
 
         /* At this moment the only supported type is float32
-         * so we omit type param */
-        UNUSED_PARAM(type);
+         * so we omit the type flags */
 
         surface = malloc_aligned(mem_size, align);
         if(surface == NULL)
@@ -31,7 +30,8 @@ int surface_create_buffer(void** pbuffer, uint32_t width, uint32_t height,
                 return MDB_FAIL;
         }
 
-        memset(surface, 0, mem_size);
+        if(!(flags & SURFACE_BUFFER_UNINIT))
+                memset(surface, 0, mem_size);
 
         *pbuffer = (void*)surface;
 
@@ -52,7 +52,8 @@ int surface_create(struct surface** psurf, uint32_t width, uint32_t height,
 
         if(flags & SURFACE_BUFFER_CREATE)
         {
-                if(surface_create_buffer((void**)&surf->data, width, height, 0))
+                if(surface_create_buffer((void**)&surf->data, width, height,
+                                         flags))
                 {
                         LOG_ERROR("Failed to create surface buffer.");
                         return -1;
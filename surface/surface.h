@@ -15,6 +15,12 @@ enum
          * from outside and no need to create a buffer at initialize. */
         SURFACE_BUFFER_EXT      = 1<<1,
 
+        /* Don't clear a created buffer, its pages are first touched
+         * by whoever writes them. Only for surfaces entirely written
+         * before they're read: malloc_aligned memory isn't zeroed, so
+         * a pixel no kernel block covers is garbage rather than 0. */
+        SURFACE_BUFFER_UNINIT   = 1<<2,
+
 
         /* A surface buffer data type */
         SURFACE_BUFFER_F32      = 1<<20
@@ -52,6 +52,46 @@
 #include <string.h>
 #include "args_parser.h"
 #include "compiler.h"
+#include "timer.h"
+#include <kernel/mdb_kernel_event.h>
+
+/* Lists that weren't given hold the single scalar value */
+static
+void args_sweep_defaults(struct arguments* args)
+{
+        struct arg_sweep* sweep = &args->sweep;
+
+        if(!sweep->n_kernel)
+        {
+                sweep->kernel[0] = args->kernel_name;
+                sweep->n_kernel = 1;
+        }
+
+        if(!sweep->n_threads)
+        {
+                sweep->threads[0] = args->threads;
+                sweep->n_threads = 1;
+        }
+
+        if(!sweep->n_block)
+        {
+                sweep->block_x[0] = args->block_size_x;
+                sweep->block_y[0] = args->block_size_y;
+                sweep->n_block = 1;
+        }
+
+        if(!sweep->n_bailout)
+        {
+                sweep->bailout[0] = args->bailout;
+                sweep->n_bailout = 1;
+        }
+
+        if(!sweep->n_view)
+        {
+                sweep->view[0] = args->view_name;
+                sweep->n_view = 1;
+        }
+}
 
 /* Argp is not supporting on MinGW.
  * This is a temporary workaround.
@@ -60,7 +100,6 @@
 #if !((defined _WIN32 || defined __WIN32__) && ! defined __CYGWIN__)
 
 #include "compiler.h"
-#include "timer.h"
 
 
 #include <argp.h>
@@ -84,6 +123,7 @@ enum
         GR_CORE,
         GR_MD_ONESHOT,
         GR_MD_BENCHMARK,
+        GR_MD_REPLAY,
         GR_EXTRA
 };
 
@@ -95,7 +135,27 @@ enum
         KEY_RSCHED,
         KEY_KRN_LIST,
         KEY_BENCHMARK,
-        KEY_RENDER
+        KEY_RENDER,
+        KEY_TIMER,
+        KEY_HEATMAP,
+        KEY_HEATMAP_UNIT,
+        KEY_METRICS,
+        KEY_LANE_STATS,
+        KEY_REPORT,
+        KEY_BASELINE,
+        KEY_REGRESSION,
+        KEY_SCALING,
+        KEY_WARMUP,
+        KEY_BATCHES,
+        KEY_COMPARE_REPORTS,
+        KEY_VIEW,
+        KEY_VIEW_LIST,
+        KEY_COMPARE,
+        KEY_FAST_START,
+        KEY_REPLAY,
+        KEY_REPLAY_FPS,
+        KEY_RECORD_KEYS,
+        KEY_PRECISION
 };
 
 #define OPTION_EX(name, key, arg, flags, doc, group) \
@@ -107,19 +167,35 @@ enum
 #define rsched_opt_doc \
         "\nAll options are separated by a comma.\n" \
         "{key},{options}\n" \
-        "Key - profile. Options:\n" \
-        "hist_{run|task|payload}\n" \
+        "Key - profile. Enable scheduler profiling. Options:\n" \
+        "off - Start with profiling disabled, SIGUSR1\n" \
+        "\t\t\t\ttoggles profiling at run time.\n" \
+        "\t\t\t\t{run|task|payload}_hist\n" \
         "hist options:\n" \
         "show=[1|0] - Show histogram.\n" \
-        "\t\t\t\tsize=[N] - Histogram size.\n" \
-        "\t\t\t\tmin=[TIMEVAL] - Minimum sampling time.\n" \
-        "\t\t\t\tmax=[TIMEVAL] - Maximum sampling time.\n" \
+        "\t\t\t\tsize=[N] - Number of histogram rows.\n" \
+        "\t\t\t\tmin=[TIMEVAL] - Minimum shown time.\n" \
+        "\t\t\t\tdefault: minimum recorded time\n" \
+        "\t\t\t\tmax=[TIMEVAL] - Maximum shown time.\n" \
+        "\t\t\t\tdefault: maximum recorded time\n" \
         "\t\t\t\tlog_scale=[1|0] - Histogram logarithmic scale.\n" \
         "TIMEVAL - is a time in a format like '10[s|ms|mc|ns]' where:\n" \
         "s - seconds.\n" \
         "ms - milliseconds.\n" \
         "mc - microseconds.\n" \
-        "ns - nanoseconds.\n"
+        "ns - nanoseconds.\n" \
+        "Key - costs. Options:\n" \
+        "file=[FILE] - Record payload time of every tile and save\n" \
+        "\t\t\t\tit to FILE on exit for mdb-simsched.\n" \
+        "Key - trace. Options:\n" \
+        "size=[N] - Trace buffer size in events per worker.\n" \
+        "\t\t\t\tdefault: 65536\n" \
+        "\t\t\t\tfile=[FILE] - Record scheduler activity and save it\n" \
+        "\t\t\t\tto FILE on exit as Chrome trace-event JSON.\n" \
+        "\t\t\t\tMust be the last option.\n" \
+        "Key - pmu. No options.\n" \
+        "Count cycles, instructions, branch, L1D and LLC\n" \
+        "\t\t\t\tmisses of every tile with hardware counters.\n"
 
 /* The options we understand. */
 static const
@@ -128,15 +204,17 @@ OPTION_EX(0, 0, 0, 0, 0, GR_CORE)
 OPTION("width", 'w', "SIZE", "Surface width in pixels")
 OPTION("height",'h', "SIZE", "Surface height in pixels")
 OPTION("quad", 'x', "SIZE", "Surface NxN in pixels | default: 1024")
-OPTION("bailout", 'i', "N", "Bailout / Max iteration depth | default: 256")
-OPTION("block-size", 'b', "NxM", "Computation block size | default: 32x32")
-OPTION("kernel",'k', "NAME", "Name of a kernel to load.\n"
+OPTION("bailout", 'i', "N[,N...]",
+       "Bailout / Max iteration depth | default: 256")
+OPTION("block-size", 'b', "NxM[,NxM...]",
+       "Computation block size | default: 32x32")
+OPTION("kernel",'k', "NAME[,NAME...]", "Name of a kernel to load.\n"
                        "You can check available list by typing --kernel-list. "
                        "default: generic.")
 
 OPTION("kernel-list", KEY_KRN_LIST, 0, "List available kernels.")
 
-OPTION("threads",'t', "n|auto", "Number of processing threads.\n"
+OPTION("threads",'t', "n|auto[,...]", "Number of processing threads.\n"
                                 "auto - determines count of hardware threads.\t"
                                 "default: auto")
 
@@ -144,18 +222,61 @@ OPTION("mode", KEY_MODE, "MODE",
                        "oneshot - Renders one hdr image to --output\t"
                        "benchmark - Suitable for performance measurement\t"
                        "render - Real-time screen render, requires OpenGL\t"
+                       "replay - Headless replay of keyboard events\t"
                        "default: oneshot")
 
 OPTION("benchmark", KEY_BENCHMARK, "RUNS", "Run benchmark mode with "
-                                   "N iterations.")
+                                   "N iterations. If --kernel, --threads, "
+                                   "--block-size or --bailout is a list "
+                                   "every combination is measured.")
 
 OPTION("render", KEY_RENDER, 0, "Run render mode")
 
+OPTION("record-keys", KEY_RECORD_KEYS, "FILE",
+       "Record keyboard events of render mode to FILE as a replay script.")
+
+OPTION("view", KEY_VIEW, "NAME[,NAME...]|all",
+       "Named view of the set or zoom path changing the view every "
+       "frame. A benchmark reports results per view. "
+       "default: start-up view of the kernel")
+
+OPTION("view-list", KEY_VIEW_LIST, 0, "List available views.")
+
+OPTION("precision", KEY_PRECISION, "auto|float|double",
+       "Floating point precision of kernels supporting more than float.\t"
+       "auto - float while it resolves pixels of the view, double below\t"
+       "default: auto if the kernel supports it")
+
 OPTION("rsched", KEY_RSCHED, "OPTIONS", rsched_opt_doc)
 
 OPTION("colors", KEY_COLORS, "on|off",
        "Enable coloring by OpenGL shader | default: on")
 
+OPTION("timer", KEY_TIMER, "tsc|clock",
+       "Timer used for profiling and benchmarking.\t"
+       "tsc - CPU time stamp counter if it's invariant\t"
+       "clock - clock_gettime\t"
+       "default: tsc if enabled at build time")
+
+OPTION("heatmap", KEY_HEATMAP, "FILE",
+       "Save the cost of every tile averaged over frames "
+       "to FILE with HDR format.")
+
+OPTION("heatmap-unit", KEY_HEATMAP_UNIT, "time|cpp",
+       "Heatmap pixel value.\t"
+       "time - tile compute time in ns\t"
+       "cpp - TSC cycles per pixel, requires the tsc timer\t"
+       "default: time")
+
+OPTION("metrics", KEY_METRICS, "PORT|unix:PATH",
+       "Serve live scheduler metrics in Prometheus text format "
+       "over HTTP on 127.0.0.1:PORT or a Unix socket at PATH.")
+
+OPTION("fast-start", KEY_FAST_START, 0,
+       "Minimize startup latency: workers start while the kernel is "
+       "loaded and the surface isn't cleared, so its pages are first "
+       "touched by the workers rendering them.")
+
 OPTION_EX(0, 0, 0, 0, "Mode oneshot params:", GR_MD_ONESHOT)
 OPTION("output", 'o', "FILE",
        "Output to FILE with HDR format | default: mandelbrot.hdr")
@@ -163,6 +284,40 @@ OPTION("output", 'o', "FILE",
 OPTION_EX(0, 0, 0, 0, "Mode benchmark params:", GR_MD_BENCHMARK)
 OPTION("benchmark-runs", KEY_BENCH_RUNS,  "N"   ,
        "Number of iterations in benchmark | default: 100")
+OPTION("lane-stats", KEY_LANE_STATS, 0,
+       "Count SIMD lane utilization of vector kernels "
+       "per tile and per frame.")
+OPTION("report", KEY_REPORT, "FILE",
+       "Save results with per-run frame times to FILE, "
+       "as CSV if it ends with .csv and as JSON otherwise.")
+OPTION("baseline", KEY_BASELINE, "FILE",
+       "Compare with a JSON report saved by --report and fail "
+       "if throughput regressed significantly.")
+OPTION("regression-threshold", KEY_REGRESSION, "PCT",
+       "Throughput loss tolerated by --baseline in percents | default: 5")
+OPTION_EX("scaling", KEY_SCALING, "N", OPTION_ARG_OPTIONAL,
+          "Run the benchmark at 1..N threads and report speedup, "
+          "efficiency and the Karp-Flatt serial fraction "
+          "| default N: all processors", GR_INHERIT)
+OPTION("warmup", KEY_WARMUP, "N",
+       "Unrecorded runs before measuring, extended until the CPU "
+       "frequency settles if cpufreq is available | default: 3")
+OPTION("batches", KEY_BATCHES, "N",
+       "Repeat the measurement of --benchmark-runs N times and report "
+       "the median and confidence interval over batches | default: 1")
+OPTION("compare", KEY_COMPARE, "A,B",
+       "Load kernels A and B side by side, alternate frames between "
+       "them and report the speedup of B with a confidence interval.")
+OPTION("compare-reports", KEY_COMPARE_REPORTS, "A,B",
+       "Compare two JSON reports saved by --report, tell whether "
+       "B differs significantly from A and exit.")
+
+OPTION_EX(0, 0, 0, 0, "Mode replay params:", GR_MD_REPLAY)
+OPTION("replay", KEY_REPLAY, "FILE|tour",
+       "Run replay mode with a script recorded by --record-keys or "
+       "written by hand, or a built-in one | default: tour")
+OPTION("replay-fps", KEY_REPLAY_FPS, "N",
+       "Target frame rate of replay mode | default: 60")
 
 OPTION_EX(0, 0, 0, 0, "Extra params:", GR_EXTRA)
 
@@ -355,6 +510,10 @@ int parse_mode(char* arg)
         {
                 return MODE_RENDER;
         }
+        else if(strcmp(arg, "replay") == 0)
+        {
+                return MODE_REPLAY;
+        }
         else
         {
                 fprintf(stderr, "Unknown value for --mode=%s\n", arg);
@@ -362,6 +521,64 @@ int parse_mode(char* arg)
         }
 }
 
+static
+int parse_timer(char* arg)
+{
+        if(strcmp(arg, "tsc") == 0)
+        {
+                return PERF_CLOCK_TSC;
+        }
+        else if(strcmp(arg, "clock") == 0)
+        {
+                return PERF_CLOCK_MONOTONIC;
+        }
+        else
+        {
+                fprintf(stderr, "Unknown value for --timer=%s\n", arg);
+                exit(EXIT_FAILURE);
+        }
+}
+
+static
+int parse_precision(char* arg)
+{
+        if(strcmp(arg, "auto") == 0)
+        {
+                return MDB_PRECISION_AUTO;
+        }
+        else if(strcmp(arg, "float") == 0)
+        {
+                return MDB_PRECISION_FLOAT;
+        }
+        else if(strcmp(arg, "double") == 0)
+        {
+                return MDB_PRECISION_DOUBLE;
+        }
+        else
+        {
+                fprintf(stderr, "Unknown value for --precision=%s\n", arg);
+                exit(EXIT_FAILURE);
+        }
+}
+
+static
+int parse_heatmap_unit(char* arg)
+{
+        if(strcmp(arg, "time") == 0)
+        {
+                return HEATMAP_TIME;
+        }
+        else if(strcmp(arg, "cpp") == 0)
+        {
+                return HEATMAP_CPP;
+        }
+        else
+        {
+                fprintf(stderr, "Unknown value for --heatmap-unit=%s\n", arg);
+                exit(EXIT_FAILURE);
+        }
+}
+
 static
 int parse_on_off(char* key, char* arg)
 {
@@ -382,6 +599,93 @@ int parse_on_off(char* key, char* arg)
 }
 
 
+/* Split a comma separated list in place, returns count of items */
+static
+uint32_t parse_list(const char* key, char* arg, char** items)
+{
+        char* save = NULL;
+        char* tok;
+        uint32_t n = 0;
+
+        for(tok = strtok_r(arg, ",", &save); tok;
+            tok = strtok_r(NULL, ",", &save))
+        {
+                if(n == ARG_LIST_MAX)
+                {
+                        fprintf(stderr, "Too many values for '--%s', "
+                                "at most %d are allowed\n", key, ARG_LIST_MAX);
+                        exit(EXIT_FAILURE);
+                }
+
+                items[n++] = tok;
+        }
+
+        if(!n)
+        {
+                fprintf(stderr, "Empty value for '--%s'\n", key);
+                exit(EXIT_FAILURE);
+        }
+
+        return n;
+}
+
+static
+void parse_kernel_list(char* arg, struct arguments* args)
+{
+        struct arg_sweep* sweep = &args->sweep;
+
+        sweep->n_kernel = parse_list("kernel", arg, sweep->kernel);
+        args->kernel_name = sweep->kernel[0];
+}
+
+static
+void parse_threads_list(char* arg, struct arguments* args)
+{
+        struct arg_sweep* sweep = &args->sweep;
+        char* items[ARG_LIST_MAX];
+        uint32_t i;
+
+        sweep->n_threads = parse_list("threads", arg, items);
+
+        for(i = 0; i < sweep->n_threads; ++i)
+                sweep->threads[i] = parse_threads(items[i]);
+
+        args->threads = sweep->threads[0];
+}
+
+static
+void parse_block_size_list(char* arg, struct arguments* args)
+{
+        struct arg_sweep* sweep = &args->sweep;
+        char* items[ARG_LIST_MAX];
+        uint32_t i;
+
+        sweep->n_block = parse_list("block-size", arg, items);
+
+        for(i = 0; i < sweep->n_block; ++i)
+                parse_block_size(items[i], &sweep->block_x[i],
+                                 &sweep->block_y[i]);
+
+        args->block_size_x = sweep->block_x[0];
+        args->block_size_y = sweep->block_y[0];
+}
+
+static
+void parse_bailout_list(char* arg, struct arguments* args)
+{
+        struct arg_sweep* sweep = &args->sweep;
+        char* items[ARG_LIST_MAX];
+        uint32_t i;
+
+        sweep->n_bailout = parse_list("bailout", arg, items);
+
+        for(i = 0; i < sweep->n_bailout; ++i)
+                sweep->bailout[i] = (uint32_t)parse_int("bailout", items[i],
+                                                        1, UINT16_MAX);
+
+        args->bailout = sweep->bailout[0];
+}
+
 static
 int parse_next_comma_opt(char* arg, char** next)
 {
@@ -601,6 +905,13 @@ int parse_rsched_profile(char* arg, struct arg_rsched* rsched)
 
         LOG_DEBUG( "opt: %s\n", arg);
 
+        optional_set(&rsched->profile, true);
+
+        if(strcmp("off", arg) == 0)
+        {
+                optional_set(&rsched->profile, false);
+                return 0;
+        }
 
         if(is_sub_opt("run_hist", arg, &next_opt))
         {
@@ -647,6 +958,74 @@ int parse_rsched_profile(char* arg, struct arg_rsched* rsched)
 }
 
 
+/* A file name option takes the rest of the option string
+ * so it can contain commas.
+ */
+static
+bool is_file_opt(char* arg, char** file)
+{
+        static const char* file_lab = "file=";
+        size_t len = strlen(file_lab);
+
+        if(strncmp(file_lab, arg, len) == 0 && arg[len] != '\0')
+        {
+                *file = arg + len;
+                return true;
+        }
+
+        return false;
+}
+
+static
+int parse_rsched_costs(char* arg, struct arg_rsched* rsched)
+{
+        LOG_DEBUG("opt: %s\n", arg);
+
+        if(is_file_opt(arg, &rsched->cost_file))
+                return 0;
+
+        LOG_ERROR("Unknown option '%s'\n", arg);
+
+        return -1;
+}
+
+static
+int parse_rsched_trace(char* arg, struct arg_rsched* rsched)
+{
+        static const char* size_lab = "size";
+
+        char* next_opt;
+        char key[64];
+        char val[64];
+
+        LOG_DEBUG("opt: %s\n", arg);
+
+        next_opt = arg;
+        while(next_opt && *next_opt != '\0')
+        {
+                if(is_file_opt(next_opt, &rsched->trace_file))
+                        return 0;
+
+                if(parse_sub_key_val(next_opt, key, val, &next_opt) != 0)
+                        return -1;
+
+                if(strcmp(size_lab, key) == 0)
+                {
+                        int i = parse_int(size_lab, val, 1024, 1 << 26);
+                        optional_set(&rsched->trace_size, i);
+                }
+                else
+                {
+                        LOG_ERROR("Unknown option '%s'\n", key);
+                        return -1;
+                }
+        }
+
+        LOG_ERROR("Trace file is not specified\n");
+
+        return -1;
+}
+
 static
 int parse_rsched(char* arg, struct arg_rsched* rsched)
 {
@@ -655,11 +1034,29 @@ int parse_rsched(char* arg, struct arg_rsched* rsched)
         LOG_DEBUG("rsched opt: %s\n", arg);
 
 
-        if(is_sub_opt("profile", arg, &opt_arg))
+        if(strcmp("profile", arg) == 0)
+        {
+                optional_set(&rsched->profile, true);
+        }
+        else if(is_sub_opt("profile", arg, &opt_arg))
         {
                 if(parse_rsched_profile(opt_arg, rsched) != 0)
                         exit(EXIT_FAILURE);
         }
+        else if(is_sub_opt("costs", arg, &opt_arg))
+        {
+                if(parse_rsched_costs(opt_arg, rsched) != 0)
+                        exit(EXIT_FAILURE);
+        }
+        else if(is_sub_opt("trace", arg, &opt_arg))
+        {
+                if(parse_rsched_trace(opt_arg, rsched) != 0)
+                        exit(EXIT_FAILURE);
+        }
+        else if(strcmp("pmu", arg) == 0)
+        {
+                rsched->pmu = true;
+        }
         else
         {
                 LOG_ERROR( "Unknown value for --rsched\n");
@@ -698,6 +1095,23 @@ void list_kernels()
 }
 
 
+/* Split a list of exactly two values */
+static
+void parse_pair(const char* key, char* arg, char** pair)
+{
+        char* items[ARG_LIST_MAX];
+
+        if(parse_list(key, arg, items) != 2)
+        {
+                fprintf(stderr, "'--%s' takes two values\n", key);
+                exit(EXIT_FAILURE);
+        }
+
+        pair[0] = items[0];
+        pair[1] = items[1];
+}
+
+
 /* Parse a single option. */
 static
 error_t parse_opt(int key, char* arg, struct argp_state* state)
@@ -721,20 +1135,29 @@ case 'x':
         break;
 }
 case 'i':
-        arguments->bailout = (uint32_t)parse_int("bailout", arg, 1, UINT16_MAX);
+        parse_bailout_list(arg, arguments);
         break;
 
 case 'b':
-        parse_block_size(arg, &arguments->block_size_x,
-                         &arguments->block_size_y);
+        parse_block_size_list(arg, arguments);
         break;
 
 case 'k':
-        arguments->kernel_name = arg;
+        parse_kernel_list(arg, arguments);
         break;
 
 case 't':
-        arguments->threads = parse_threads(arg);
+        parse_threads_list(arg, arguments);
+        break;
+
+case KEY_VIEW:
+        arguments->sweep.n_view = parse_list("view", arg,
+                                             arguments->sweep.view);
+        arguments->view_name = arguments->sweep.view[0];
+        break;
+
+case KEY_VIEW_LIST:
+        arguments->view_list = 1;
         break;
 
 case KEY_MODE:
@@ -758,6 +1181,83 @@ case KEY_RENDER:
         arguments->mode = MODE_RENDER;
         break;
 
+case KEY_RECORD_KEYS:
+        arguments->record_keys = arg;
+        break;
+
+case KEY_REPLAY:
+        arguments->mode = MODE_REPLAY;
+        arguments->replay_script = arg;
+        break;
+
+case KEY_REPLAY_FPS:
+        arguments->replay_fps = parse_int("replay-fps", arg, 1, 1000);
+        break;
+
+case KEY_TIMER:
+        arguments->timer = parse_timer(arg);
+        break;
+
+case KEY_PRECISION:
+        arguments->precision = parse_precision(arg);
+        break;
+
+case KEY_HEATMAP:
+        arguments->heatmap_file = arg;
+        break;
+
+case KEY_HEATMAP_UNIT:
+        arguments->heatmap_unit = parse_heatmap_unit(arg);
+        break;
+
+case KEY_METRICS:
+        arguments->metrics_addr = arg;
+        break;
+
+case KEY_FAST_START:
+        arguments->fast_start = 1;
+        break;
+
+case KEY_LANE_STATS:
+        arguments->lane_stats = 1;
+        break;
+
+case KEY_REPORT:
+        arguments->report_file = arg;
+        break;
+
+case KEY_BASELINE:
+        arguments->baseline_file = arg;
+        break;
+
+case KEY_SCALING:
+        arguments->mode = MODE_BENCHMARK;
+        arguments->scaling = arg ? parse_int("scaling", arg, 1, INT_MAX)
+                                 : -1;
+        break;
+
+case KEY_REGRESSION:
+        arguments->regression_threshold =
+                parse_int("regression-threshold", arg, 0, 99);
+        break;
+
+case KEY_COMPARE:
+        arguments->mode = MODE_BENCHMARK;
+        parse_pair("compare", arg, arguments->compare);
+        break;
+
+case KEY_WARMUP:
+        arguments->warmup = parse_int("warmup", arg, 0, INT_MAX);
+        break;
+
+case KEY_BATCHES:
+        arguments->batches = parse_int("batches", arg, 1, INT_MAX);
+        break;
+
+case KEY_COMPARE_REPORTS:
+        parse_pair("compare-reports", arg, arguments->compare_reports);
+        break;
+
 case 'q':
 case 's':
         arguments->silent = 1;
@@ -770,9 +1270,7 @@ case 'o':
         break;
 
 case KEY_RSCHED:
-#ifdef CONFIG_RSCHED_PROFILE
         parse_rsched(arg, &arguments->rsched);
-#endif
         break;
 
 case KEY_KRN_LIST:
@@ -808,7 +1306,13 @@ void args_parse(int argc, char** argv, struct arguments* arguments)
         arguments->mode          = MODE_ONESHOT;
         arguments->output_file   = "mandelbrot.hdr";
         arguments->benchmark_runs= 100;
+        arguments->regression_threshold = 5;
+        arguments->warmup        = 3;
+        arguments->batches       = 1;
+        arguments->replay_fps    = 60;
         arguments->shader_colors = 1;
+        arguments->timer         = PERF_CLOCK_DEFAULT;
+        arguments->precision     = -1;
 #if !defined(NDEBUG)
         arguments->verbose       = 2;
 #endif
@@ -817,6 +1321,8 @@ void args_parse(int argc, char** argv, struct arguments* arguments)
            be reflected in arguments. */
         argp_parse(&argp, argc, argv, 0, 0, arguments);
 
+        args_sweep_defaults(arguments);
+
         //debug_arguments(arguments);
 }
 
@@ -841,11 +1347,18 @@ void args_parse(int argc, char** argv, struct arguments* arguments)
         arguments->mode          = MODE_RENDER;
         arguments->output_file   = "mandelbrot.hdr";
         arguments->benchmark_runs= 100;
+        arguments->regression_threshold = 5;
+        arguments->warmup        = 3;
+        arguments->batches       = 1;
+        arguments->replay_fps    = 60;
         arguments->shader_colors = 1;
+        arguments->timer         = PERF_CLOCK_DEFAULT;
+        arguments->precision     = -1;
 #if !defined(NDEBUG)
         arguments->verbose       = 2;
 #endif
 
+        args_sweep_defaults(arguments);
 }
 
 #endif /* __WIN32__ */
\ No newline at end of file
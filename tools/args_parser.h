@@ -8,7 +8,14 @@ enum
 {
         MODE_ONESHOT,
         MODE_BENCHMARK,
-        MODE_RENDER
+        MODE_RENDER,
+        MODE_REPLAY
+};
+
+enum
+{
+        HEATMAP_TIME,
+        HEATMAP_CPP
 };
 
 struct optional_bool
@@ -46,13 +53,57 @@ struct arg_rsched_hist
 struct arg_rsched
 {
         /* rsched profile options */
+        struct optional_bool profile;
+
         struct arg_rsched_hist run_hist;
 
         struct arg_rsched_hist task_hist;
 
         struct arg_rsched_hist payload_hist;
+
+        /* file to save per-tile costs to, NULL if disabled */
+        char* cost_file;
+
+        /* file to save a Chrome trace to, NULL if disabled */
+        char* trace_file;
+
+        /* trace buffer size in events per worker */
+        struct optional_u32 trace_size;
+
+        /* count hardware events per tile */
+        bool pmu;
+};
+
+#define ARG_LIST_MAX 64
+
+/* struct arg_sweep - options given as comma separated lists.
+ *
+ * The first value of a list is also stored to the scalar field of
+ * struct arguments. A benchmark runs every combination of the values
+ * if any list has more than one, see app/sweep.c.
+ */
+struct arg_sweep
+{
+        char* kernel[ARG_LIST_MAX];
+        int threads[ARG_LIST_MAX];
+        uint32_t block_x[ARG_LIST_MAX];
+        uint32_t block_y[ARG_LIST_MAX];
+        uint32_t bailout[ARG_LIST_MAX];
+
+        /* NULL is the start-up view of the kernel */
+        char* view[ARG_LIST_MAX];
+
+        uint32_t n_kernel, n_threads, n_block, n_bailout, n_view;
 };
 
+/* Count of configurations given by struct arg_sweep */
+static inline
+uint32_t arg_sweep_size(const struct arg_sweep* sweep)
+{
+        return sweep->n_kernel * sweep->n_threads
+               * sweep->n_block * sweep->n_bailout * sweep->n_view;
+}
+
 struct arguments
 {
         uint32_t width, height;
@@ -66,11 +117,46 @@ struct arguments
         int silent, verbose;
         char* output_file;
         int shader_colors;
+        int timer;
+
+        /* MDB_PRECISION_* sent to the kernel, -1 keeps its default */
+        int precision;
+        char* heatmap_file;
+        int heatmap_unit;
+        char* metrics_addr;
+        int lane_stats;
+        int fast_start;
+        char* report_file;
+        char* baseline_file;
+        int regression_threshold;
+        int warmup;
+        int batches;
+
+        /* Two reports to compare instead of running, NULL if disabled */
+        char* compare_reports[2];
+
+        /* Two kernels to compare frame by frame, NULL if disabled */
+        char* compare[2];
+
+        /* Max thread count of a strong scaling run, -1 for all processors,
+         * 0 if disabled
+         */
+        int scaling;
+
+        /* Replay script file or built-in name, NULL for "tour" */
+        char* replay_script;
+        int replay_fps;
+
+        /* File render mode records keyboard events to, NULL if disabled */
+        char* record_keys;
+
+        /* Name of a view from app/views.c, NULL for the kernel default */
+        char* view_name;
+        int view_list;
 
-#if defined(CONFIG_RSCHED_PROFILE)
         struct arg_rsched rsched;
 
-#endif
+        struct arg_sweep sweep;
 };
 
 void args_parse(int argc, char** argv, struct arguments* arguments);
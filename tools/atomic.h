@@ -8,6 +8,18 @@
 #define atomic_load(PTR) \
         __atomic_load_n(PTR, __ATOMIC_ACQUIRE)
 
+#define atomic_store_relaxed(PTR, VAL) \
+        __atomic_store_n(PTR, VAL, __ATOMIC_RELAXED)
+
+#define atomic_load_relaxed(PTR) \
+        __atomic_load_n(PTR, __ATOMIC_RELAXED)
+
+/* Add to a variable written only by one thread while other threads
+ * may read it with atomic_load_relaxed, no locked instruction is used.
+ */
+#define atomic_add_single_writer(PTR, VAL) \
+        atomic_store_relaxed(PTR, *(PTR) + (VAL))
+
 #define atomic_compare_exchange(PTR, VAL, DES) \
         __atomic_compare_exchange_n(PTR, VAL, DES, 1, \
                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
@@ -23,6 +35,9 @@
 #define atomic_fetch_add_relaxed(PTR, VAL) \
         __atomic_fetch_add(PTR, VAL, __ATOMIC_RELAXED)
 
+#define atomic_fetch_xor(PTR, VAL) \
+        __atomic_fetch_xor(PTR, VAL, __ATOMIC_ACQ_REL)
+
 
 #define atomic_test_and_set(PTR) \
         __atomic_test_and_set(PTR, __ATOMIC_ACQ_REL)
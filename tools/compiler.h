@@ -13,6 +13,10 @@
 #define __cold	__attribute__((__cold__))
 #define __hot	__attribute__((__hot__))
 
+#ifndef __always_inline
+#define __always_inline inline __attribute__((__always_inline__))
+#endif
+
 #undef __aligned
 #define __aligned(x) __attribute__((aligned(x)))
 
@@ -1,7 +1,13 @@
 #include "cpu_features.h"
 #include <string.h>
+#include <stdio.h>
+#include <stdint.h>
 #include <tools/compiler.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
 
 
 #define __cpu_probe_feature(mask, feature, name) \
@@ -139,3 +145,36 @@ exit:
 
 #undef __cpu_strcpy_feature
 }
+
+int cpu_supported_features(void)
+{
+        return CPU_FEATURE_ALL ^ cpu_check_features(CPU_FEATURE_ALL);
+}
+
+void cpu_model_name(char* buff, size_t buff_sz)
+{
+#if defined(__x86_64__) || defined(__i386__)
+        uint32_t brand[12];
+        uint32_t i;
+        char* p;
+
+        if(__get_cpuid_max(0x80000000, NULL) >= 0x80000004)
+        {
+                for(i = 0; i < 3; ++i)
+                        __get_cpuid(0x80000002 + i, &brand[i * 4],
+                                    &brand[i * 4 + 1], &brand[i * 4 + 2],
+                                    &brand[i * 4 + 3]);
+
+                /* The brand string is padded with leading spaces */
+                p = (char*)brand;
+                p[sizeof(brand) - 1] = '\0';
+
+                while(*p == ' ')
+                        ++p;
+
+                snprintf(buff, buff_sz, "%s", p);
+                return;
+        }
+#endif
+        snprintf(buff, buff_sz, "unknown");
+}
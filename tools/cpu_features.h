@@ -13,7 +13,9 @@ enum
         CPU_FEATURE_SSE4_2  = 1<<6,
         CPU_FEATURE_AVX     = 1<<7,
         CPU_FEATURE_AVX2    = 1<<8,
-        CPU_FEATURE_FMA     = 1<<9
+        CPU_FEATURE_FMA     = 1<<9,
+
+        CPU_FEATURE_ALL     = (1<<10) - 1
 };
 
 /* Check for available cpu features
@@ -22,5 +24,11 @@ enum
  */
 int cpu_check_features(int mask);
 
+/* Returns a bitmask of the cpu features available on this machine */
+int cpu_supported_features(void);
+
 /* Convert a bitmask of the CPU features to a comma separated string */
 int cpu_features_to_str(int mask, char* buff, size_t buff_sz);
+
+/* Write the CPU brand string to buff, "unknown" if it can't be queried */
+void cpu_model_name(char* buff, size_t buff_sz);
@@ -8,149 +8,201 @@
 
 #include <inttypes.h>
 
-static inline
-size_t HIST_BOUNDL(const struct perf_hist* hist)
+void perf_hist_init(struct perf_hist* hist)
 {
-        return hist->size;
+        hist->bucket = calloc(PERF_HIST_BUCKETS, sizeof(*hist->bucket));
+        hist->count = 0;
+        hist->min = UINT64_MAX;
+        hist->max = 0;
 }
 
-static inline
-size_t HIST_BOUNDR(const struct perf_hist* hist)
+void perf_hist_destroy(struct perf_hist* hist)
 {
-        return hist->size + 1;
+        free(hist->bucket);
+        hist->bucket = NULL;
 }
 
-void perf_hist_init(struct perf_hist* hist, uint32_t size,
-                    uint64_t min, uint64_t max, bool log_scale)
+static inline
+uint32_t perf_hist_bucket_shift(uint32_t idx)
 {
-        size_t i;
-        uint64_t width;
-        uint64_t bin_min, bin_max;
-
-        width = max - min;
-        bin_min = min;
-
-        hist->bin = calloc(size + 2, sizeof(*hist->bin));
-        hist->size = size;
-
-        hist->bin[HIST_BOUNDL(hist)].min = min;
-        hist->bin[HIST_BOUNDL(hist)].max = min;
-
-        hist->bin[HIST_BOUNDR(hist)].min = max;
-        hist->bin[HIST_BOUNDR(hist)].max = max;
+        if(idx < 2 * PERF_HIST_SUB_HALF)
+                return 0;
 
-        for (i = 0; i < size; ++i)
-        {
-                if (log_scale)
-                {
-                        double s = (double) (i + 1) / size;
-                        double f = log(width);
-                        double fi = exp(f * s);
+        return (uint32_t)(idx / PERF_HIST_SUB_HALF) - 1;
+}
 
-                        bin_max = min + (uint64_t) fi;
-                }
-                else
-                {
-                        bin_max = min + (width / size * (i + 1));
-                }
+uint64_t perf_hist_bucket_min(uint32_t idx)
+{
+        uint32_t shift = perf_hist_bucket_shift(idx);
 
-                hist->bin[i].min = bin_min;
-                hist->bin[i].max = bin_max;
+        if(!shift)
+                return idx;
 
-                bin_min = bin_max;
-        }
+        return (idx - shift * PERF_HIST_SUB_HALF) << shift;
 }
 
-void perf_hist_destroy(struct perf_hist* hist)
+uint64_t perf_hist_bucket_max(uint32_t idx)
 {
-        free(hist->bin);
+        uint32_t shift = perf_hist_bucket_shift(idx);
+
+        return perf_hist_bucket_min(idx) + (UINT64_C(1) << shift) - 1;
 }
 
-static inline
-int perf_hist_check_range(const struct perf_hist_bin* bin,
-                          uint64_t val)
+void perf_hist_snapshot(struct perf_hist* dst, const struct perf_hist* src)
 {
-        if(val < bin->min)
-                return -1;
-        else if(val >= bin->max)
-                return 1;
-        else
-                return 0;
+        uint32_t i;
+
+        dst->count = 0;
+
+        for(i = 0; i < PERF_HIST_BUCKETS; ++i)
+        {
+                dst->bucket[i] = atomic_load_relaxed(&src->bucket[i]);
+                dst->count += dst->bucket[i];
+        }
+
+        dst->min = atomic_load_relaxed(&src->min);
+        dst->max = atomic_load_relaxed(&src->max);
 }
 
-static inline
-int perf_hist_bsearch(const struct perf_hist* hist, uint64_t val)
+void perf_hist_merge(struct perf_hist* dst, const struct perf_hist* src)
 {
-        const struct perf_hist_bin* bin;
-        ssize_t m, l, r;
-        int cmp;
+        uint32_t i;
 
-        l = 0;
-        r = hist->size - 1;
+        for(i = 0; i < PERF_HIST_BUCKETS; ++i)
+                dst->bucket[i] += src->bucket[i];
 
-        while(l <= r)
-        {
-                m = l + (r - l) / 2;
+        dst->count += src->count;
+        dst->min = MIN(dst->min, src->min);
+        dst->max = MAX(dst->max, src->max);
+}
 
+uint64_t perf_hist_percentile(const struct perf_hist* hist, double p)
+{
+        uint64_t target, acc;
+        uint32_t i;
 
-                bin = &hist->bin[m];
+        if(!hist->count)
+                return 0;
 
-                cmp = perf_hist_check_range(bin, val);
+        target = (uint64_t)ceil(p / 100.0 * (double)hist->count);
+        target = MAX(target, 1);
 
-                if (cmp == 0)
-                {
-                        return (int)m;
-                }
-                else if(cmp == 1)
-                {
-                        l = m + 1;
-                }
-                else
-                {
-                        r = m - 1;
-                }
+        acc = 0;
+        for(i = 0; i < PERF_HIST_BUCKETS; ++i)
+        {
+                acc += hist->bucket[i];
 
+                if(acc >= target)
+                        return MAX(MIN(perf_hist_bucket_max(i), hist->max),
+                                   hist->min);
         }
 
-        /* last 2 bins are reserved for values
-         * don't fit to the specified range
-         * */
-        return l == 0 ? HIST_BOUNDL(hist) : HIST_BOUNDR(hist);
+        return hist->max;
+}
+
+void perf_hist_print_percentiles(const struct perf_hist* hist)
+{
+        PARAM_INFO("p50", "%'" PRIu64 " ns", perf_hist_percentile(hist, 50));
+        PARAM_INFO("p90", "%'" PRIu64 " ns", perf_hist_percentile(hist, 90));
+        PARAM_INFO("p99", "%'" PRIu64 " ns", perf_hist_percentile(hist, 99));
+        PARAM_INFO("p99.9", "%'" PRIu64 " ns",
+                   perf_hist_percentile(hist, 99.9));
+        PARAM_INFO("max", "%'" PRIu64 " ns", hist->count ? hist->max : 0);
 }
 
-void perf_hist_add(struct perf_hist* hist, uint64_t val)
+static
+void perf_hist_row_bounds(uint64_t* bound, uint32_t size,
+                          uint64_t min, uint64_t max, bool log_scale)
 {
-        int idx = perf_hist_bsearch(hist, val);
+        uint32_t i;
+        double f;
 
+        min = log_scale ? MAX(min, 1) : min;
+        max = MAX(max, min + size);
 
-        ++hist->bin[idx].data;
+        f = log((double)max / (double)min);
+
+        for(i = 0; i < size; ++i)
+        {
+                if(log_scale)
+                        bound[i] = (uint64_t)((double)min
+                                              * exp(f * i / size));
+                else
+                        bound[i] = min + (max - min) * i / size;
+        }
 
+        bound[size] = max;
 }
 
-void perf_hist_print(struct perf_hist* hist)
+void perf_hist_print(const struct perf_hist* hist, uint32_t size,
+                     uint64_t min, uint64_t max, bool log_scale)
 {
-        uint64_t i;
+        uint64_t* bound;
+        uint64_t* row;
+        uint64_t under = 0, over = 0;
+        uint64_t v;
+        uint32_t i, r;
         char tm0[16];
         char tm1[16];
-        uint64_t v;
 
-        perf_format_time(hist->bin[HIST_BOUNDL(hist)].min, tm0, 16);
-        v = hist->bin[HIST_BOUNDL(hist)].data;
+        if(!hist->count)
+        {
+                LOG_SAY("[**][empty]");
+                return;
+        }
+
+        size = MAX(size, 1);
+        min = min ? min : hist->min;
+        max = max ? max : hist->max + 1;
+
+        bound = calloc(size + 1, sizeof(*bound));
+        row = calloc(size, sizeof(*row));
 
-        LOG_SAY("[**][xxxx xx < %s]: %" PRIu64, tm0, v);
+        perf_hist_row_bounds(bound, size, min, max, log_scale);
 
-        for(i = 0; i < hist->size; ++i)
+        /* Buckets and rows are both sorted so
+         * a row index only moves forward */
+        r = 0;
+        for(i = 0; i < PERF_HIST_BUCKETS; ++i)
         {
-                perf_format_time(hist->bin[i].min, tm0, 16);
-                perf_format_time(hist->bin[i].max, tm1, 16);
+                if(!hist->bucket[i])
+                        continue;
+
+                /* The first bucket may start below the recorded minimum */
+                v = MAX(perf_hist_bucket_min(i), hist->min);
+
+                if(v < bound[0])
+                {
+                        under += hist->bucket[i];
+                        continue;
+                }
 
-                v = hist->bin[i].data;
+                if(v >= bound[size])
+                {
+                        over += hist->bucket[i];
+                        continue;
+                }
+
+                while(v >= bound[r + 1])
+                        ++r;
+
+                row[r] += hist->bucket[i];
+        }
+
+        perf_format_time(bound[0], tm0, 16);
+        LOG_SAY("[**][xxxx xx < %s]: %" PRIu64, tm0, under);
+
+        for(i = 0; i < size; ++i)
+        {
+                perf_format_time(bound[i], tm0, 16);
+                perf_format_time(bound[i + 1], tm1, 16);
 
-                LOG_SAY("[%02" PRIu64 "][%s - %s]: %" PRIu64, i, tm0, tm1, v);
+                LOG_SAY("[%02u][%s - %s]: %" PRIu64, i, tm0, tm1, row[i]);
         }
 
-        perf_format_time(hist->bin[HIST_BOUNDR(hist)].min, tm0, 16);
-        v = hist->bin[HIST_BOUNDR(hist)].data;
+        perf_format_time(bound[size], tm0, 16);
+        LOG_SAY("[**][xxxx xx > %s]: %" PRIu64, tm0, over);
 
-        LOG_SAY("[**][xxxx xx > %s]: %" PRIu64, tm0, v);
+        free(row);
+        free(bound);
 }
@@ -1,25 +1,124 @@
 #pragma once
 
+/* Log-linear histogram ( HDR histogram layout ).
+ *
+ * Values below 2^PERF_HIST_SUB_BITS are counted exactly, above that
+ * every power of two range is split into 2^(PERF_HIST_SUB_BITS - 1)
+ * linear buckets, so any recorded value is known within a relative
+ * error of 2^-(PERF_HIST_SUB_BITS - 1) from a nanosecond up to
+ * 2^PERF_HIST_MAX_BITS. Larger values are counted in the last bucket.
+ *
+ * Finding a bucket is a bit scan and a shift, all histograms share
+ * the same layout so merging them is just adding up the counters.
+ */
+
 #include <stdint.h>
 #include <stdbool.h>
+#include <tools/compiler.h>
+#include <tools/atomic.h>
 
-struct perf_hist_bin
-{
-        uint64_t data;
-        uint64_t min, max;
-};
+/* Significant bits of a value kept, gives 1.6% precision */
+#define PERF_HIST_SUB_BITS 7
+
+/* Values up to 2^48 ns ( ~78 hours ) */
+#define PERF_HIST_MAX_BITS 48
+
+#define PERF_HIST_SUB_HALF (UINT64_C(1) << (PERF_HIST_SUB_BITS - 1))
+
+#define PERF_HIST_BUCKETS \
+        ((PERF_HIST_MAX_BITS - PERF_HIST_SUB_BITS + 2) * PERF_HIST_SUB_HALF)
 
+/* struct perf_hist - log-linear histogram.
+ *
+ * @bucket - PERF_HIST_BUCKETS counters.
+ * @count  - total count of values.
+ * @min    - minimum recorded value, UINT64_MAX if empty.
+ * @max    - maximum recorded value.
+ */
 struct perf_hist
 {
-        uint32_t size;
-        struct perf_hist_bin* bin;
+        uint64_t* bucket;
+        uint64_t count;
+        uint64_t min, max;
 };
 
-void perf_hist_init(struct perf_hist* hist, uint32_t size,
-                    uint64_t min, uint64_t max, bool log_scale);
+void perf_hist_init(struct perf_hist* hist);
 
 void perf_hist_destroy(struct perf_hist* hist);
 
-void perf_hist_add(struct perf_hist* hist, uint64_t val);
+static inline
+uint32_t perf_hist_index(uint64_t val)
+{
+        uint32_t shift;
+
+        if(val < (UINT64_C(1) << PERF_HIST_SUB_BITS))
+                return (uint32_t)val;
+
+        if(unlikely(val >> PERF_HIST_MAX_BITS))
+                val = (UINT64_C(1) << PERF_HIST_MAX_BITS) - 1;
+
+        /* index of the highest bit minus significant bits */
+        shift = (uint32_t)(63 - __builtin_clzll(val))
+                - (PERF_HIST_SUB_BITS - 1);
+
+        return (uint32_t)(shift * PERF_HIST_SUB_HALF + (val >> shift));
+}
+
+/* Lowest value counted in the bucket */
+uint64_t perf_hist_bucket_min(uint32_t idx);
+
+/* Highest value counted in the bucket */
+uint64_t perf_hist_bucket_max(uint32_t idx);
+
+static inline
+void perf_hist_add(struct perf_hist* hist, uint64_t val)
+{
+        ++hist->bucket[perf_hist_index(val)];
+        ++hist->count;
+
+        if(val < hist->min)
+                hist->min = val;
+
+        if(val > hist->max)
+                hist->max = val;
+}
+
+/* Same as perf_hist_add but the histogram can be read by other threads
+ * with perf_hist_snapshot at the same time, there must be only one writer.
+ */
+static inline
+void perf_hist_add_shared(struct perf_hist* hist, uint64_t val)
+{
+        atomic_add_single_writer(&hist->bucket[perf_hist_index(val)], 1);
+        atomic_add_single_writer(&hist->count, 1);
+
+        if(val < hist->min)
+                atomic_store_relaxed(&hist->min, val);
+
+        if(val > hist->max)
+                atomic_store_relaxed(&hist->max, val);
+}
+
+/* Copy a histogram updated by perf_hist_add_shared, dst must be
+ * initialized. Counters are copied one by one so the copy may be off by
+ * values added during copying, but it never blocks the writer.
+ */
+void perf_hist_snapshot(struct perf_hist* dst, const struct perf_hist* src);
+
+/* Add all values of src to dst */
+void perf_hist_merge(struct perf_hist* dst, const struct perf_hist* src);
+
+/* Returns a value that p percent of recorded values are less or equal to,
+ * p is in range [0, 100]. Returns 0 for an empty histogram.
+ */
+uint64_t perf_hist_percentile(const struct perf_hist* hist, double p);
+
+/* Print p50, p90, p99, p99.9 and max */
+void perf_hist_print_percentiles(const struct perf_hist* hist);
 
-void perf_hist_print(struct perf_hist* hist);
+/* Print the histogram aggregated into size rows between min and max,
+ * 0 for min or max means the recorded minimum or maximum.
+ * Values out of the range are shown in two extra rows.
+ */
+void perf_hist_print(const struct perf_hist* hist, uint32_t size,
+                     uint64_t min, uint64_t max, bool log_scale);
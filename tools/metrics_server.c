@@ -0,0 +1,282 @@
+#include "metrics_server.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <tools/log.h>
+#include <tools/atomic.h>
+#include <tools/error_codes.h>
+
+/* How often the server thread checks for a stop request */
+#define METRICS_POLL_MS 200
+
+/* Max time to wait for a client request */
+#define METRICS_RECV_TIMEOUT_SEC 1
+
+struct metrics_server
+{
+        int fd;
+        char* unix_path;
+
+        metrics_write_fun fun;
+        void* ctx;
+
+        pthread_t thread;
+
+        __atomic int stop;
+};
+
+static
+int listen_unix(struct metrics_server* srv, const char* path)
+{
+        struct sockaddr_un sa;
+        struct stat st;
+
+        if(strlen(path) >= sizeof(sa.sun_path))
+        {
+                LOG_ERROR("Socket path '%s' is too long.", path);
+                return -1;
+        }
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strcpy(sa.sun_path, path);
+
+        srv->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(srv->fd < 0)
+                return -1;
+
+        /* Remove a stale socket left by a previous run, but never
+         * anything else that happens to be at the path.
+         */
+        if(lstat(path, &st) == 0)
+        {
+                if(!S_ISSOCK(st.st_mode))
+                {
+                        LOG_ERROR("'%s' exists and isn't a socket.", path);
+                        errno = EEXIST;
+                        return -1;
+                }
+
+                if(unlink(path) != 0)
+                        return -1;
+        }
+        else if(errno != ENOENT)
+        {
+                return -1;
+        }
+
+        if(bind(srv->fd, (struct sockaddr*)&sa, sizeof(sa)) != 0)
+                return -1;
+
+        srv->unix_path = strdup(path);
+
+        return 0;
+}
+
+static
+int listen_tcp(struct metrics_server* srv, const char* port_str)
+{
+        struct sockaddr_in sa;
+        char* pend = NULL;
+        long port;
+        int on = 1;
+
+        port = strtol(port_str, &pend, 10);
+        if(*port_str == '\0' || *pend != '\0' || port <= 0 || port > 65535)
+        {
+                LOG_ERROR("Invalid metrics port '%s'.", port_str);
+                errno = EINVAL;
+                return -1;
+        }
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((uint16_t)port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        srv->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(srv->fd < 0)
+                return -1;
+
+        setsockopt(srv->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        return bind(srv->fd, (struct sockaddr*)&sa, sizeof(sa));
+}
+
+static
+void write_all(int fd, const char* buf, size_t size)
+{
+        ssize_t n;
+
+        while(size)
+        {
+                n = write(fd, buf, size);
+                if(n < 0 && errno == EINTR)
+                        continue;
+
+                if(n <= 0)
+                        return;
+
+                buf += n;
+                size -= (size_t)n;
+        }
+}
+
+/* Read a request header, its content doesn't matter */
+static
+void read_request(int fd)
+{
+        char buf[1024];
+        size_t len = 0;
+        ssize_t n;
+
+        while(len < sizeof(buf) - 1)
+        {
+                n = read(fd, buf + len, sizeof(buf) - 1 - len);
+                if(n <= 0)
+                        return;
+
+                len += (size_t)n;
+                buf[len] = '\0';
+
+                if(strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n"))
+                        return;
+        }
+}
+
+static
+void serve_client(struct metrics_server* srv, int fd)
+{
+        struct timeval tv = { .tv_sec = METRICS_RECV_TIMEOUT_SEC };
+        char header[128];
+        char* body = NULL;
+        size_t size = 0;
+        FILE* f;
+        int ret;
+
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        read_request(fd);
+
+        f = open_memstream(&body, &size);
+        if(!f)
+                return;
+
+        ret = srv->fun(f, srv->ctx);
+        fclose(f);
+
+        if(ret == MDB_SUCCESS)
+                snprintf(header, sizeof(header),
+                         "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\n\r\n", size);
+        else
+                snprintf(header, sizeof(header),
+                         "HTTP/1.0 500 Internal Server Error\r\n"
+                         "Content-Length: 0\r\n\r\n");
+
+        write_all(fd, header, strlen(header));
+
+        if(ret == MDB_SUCCESS)
+                write_all(fd, body, size);
+
+        free(body);
+}
+
+static
+void* metrics_server_thread(void* arg)
+{
+        struct metrics_server* srv = arg;
+        struct pollfd pfd = { .fd = srv->fd, .events = POLLIN };
+        int fd;
+
+        while(!atomic_load(&srv->stop))
+        {
+                if(poll(&pfd, 1, METRICS_POLL_MS) <= 0)
+                        continue;
+
+                fd = accept4(srv->fd, NULL, NULL, SOCK_CLOEXEC);
+                if(fd < 0)
+                        continue;
+
+                serve_client(srv, fd);
+                close(fd);
+        }
+
+        return NULL;
+}
+
+int metrics_server_start(struct metrics_server** psrv, const char* addr,
+                         metrics_write_fun fun, void* ctx)
+{
+        static const char* unix_prefix = "unix:";
+
+        struct metrics_server* srv;
+        int ret;
+
+        srv = calloc(1, sizeof(*srv));
+        srv->fd = -1;
+        srv->fun = fun;
+        srv->ctx = ctx;
+
+        if(strncmp(addr, unix_prefix, strlen(unix_prefix)) == 0)
+                ret = listen_unix(srv, addr + strlen(unix_prefix));
+        else
+                ret = listen_tcp(srv, addr);
+
+        if(ret != 0 || listen(srv->fd, 8) != 0)
+        {
+                LOG_ERROR("Failed to listen for metrics on '%s': %s",
+                          addr, strerror(errno));
+                goto fail;
+        }
+
+        ret = pthread_create(&srv->thread, NULL, &metrics_server_thread, srv);
+        if(ret)
+        {
+                LOG_ERROR("[pthread_create]: %s", strerror(ret));
+                goto fail;
+        }
+
+        pthread_setname_np(srv->thread, "metrics");
+
+        *psrv = srv;
+
+        return MDB_SUCCESS;
+
+fail:
+        if(srv->fd >= 0)
+                close(srv->fd);
+
+        if(srv->unix_path)
+                unlink(srv->unix_path);
+
+        free(srv->unix_path);
+        free(srv);
+
+        return MDB_FAIL;
+}
+
+void metrics_server_stop(struct metrics_server* srv)
+{
+        atomic_store(&srv->stop, 1);
+        pthread_join(srv->thread, NULL);
+
+        close(srv->fd);
+
+        if(srv->unix_path)
+                unlink(srv->unix_path);
+
+        free(srv->unix_path);
+        free(srv);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+/* A minimal metrics endpoint.
+ *
+ * Serves a text produced by a user function over HTTP/1.0 on every
+ * request regardless of the path, so it can be scraped by Prometheus
+ * or read with curl. The server runs in its own thread and handles
+ * one connection at a time.
+ *
+ * Address formats:
+ * PORT      - TCP port on 127.0.0.1.
+ * unix:PATH - Unix domain socket at PATH, e.g.
+ *             curl --unix-socket PATH http://localhost/metrics
+ */
+
+#include <stdio.h>
+
+typedef int(* metrics_write_fun)(FILE* f, void* ctx);
+
+struct metrics_server;
+
+int metrics_server_start(struct metrics_server** psrv, const char* addr,
+                         metrics_write_fun fun, void* ctx);
+
+void metrics_server_stop(struct metrics_server* srv);
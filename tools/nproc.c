@@ -1,10 +1,13 @@
 #include "nproc.h"
 #include <tools/log.h>
+#include <tools/compiler.h>
 
 
 
 #if defined(__unix__)
 #include <sys/sysinfo.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 int nproc_active(void)
 {
@@ -16,6 +19,72 @@ int nproc_active(void)
         return 1;
 }
 
+static
+int read_cpu_attr(int cpu, const char* name)
+{
+        char path[128];
+        FILE* f;
+        int v;
+
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/%s", cpu, name);
+
+        f = fopen(path, "r");
+        if(!f)
+                return -1;
+
+        if(fscanf(f, "%d", &v) != 1)
+                v = -1;
+
+        fclose(f);
+
+        return v;
+}
+
+int nproc_first_smt_sibling(int n)
+{
+        int* core;
+        int* package;
+        int i, j;
+        int first = n;
+
+        core = calloc((size_t)n, sizeof(*core));
+        package = calloc((size_t)n, sizeof(*package));
+
+        for(i = 0; i < n && first == n; ++i)
+        {
+                core[i] = read_cpu_attr(i, "topology/core_id");
+                package[i] = read_cpu_attr(i, "topology/physical_package_id");
+
+                if(core[i] < 0 || package[i] < 0)
+                {
+                        first = -1;
+                        break;
+                }
+
+                for(j = 0; j < i; ++j)
+                {
+                        if(core[j] == core[i] && package[j] == package[i])
+                        {
+                                first = i;
+                                break;
+                        }
+                }
+        }
+
+        free(package);
+        free(core);
+
+        return first;
+}
+
+int nproc_cur_freq(int cpu)
+{
+        int v = read_cpu_attr(cpu, "cpufreq/scaling_cur_freq");
+
+        return v > 0 ? v : 0;
+}
+
 #endif
 
 #if (defined _WIN32 || defined __WIN32__) && ! defined __CYGWIN__
@@ -32,4 +101,18 @@ int nproc_active(void)
         LOG_ERROR("Failed to get number of processors. Fallback to 1");
         return 1;
 }
+
+int nproc_first_smt_sibling(int n)
+{
+        UNUSED_PARAM(n);
+
+        return -1;
+}
+
+int nproc_cur_freq(int cpu)
+{
+        UNUSED_PARAM(cpu);
+
+        return 0;
+}
 #endif
\ No newline at end of file
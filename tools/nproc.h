@@ -2,3 +2,15 @@
 
 /* Get number of active processors. */
 int nproc_active(void);
+
+/* Index of the first cpu among 0..n-1 that shares a physical core with
+ * a lower numbered one, so n threads bound to cpus in order start using
+ * SMT siblings after this many threads.
+ * Returns n if there are no siblings and -1 if topology is unknown.
+ */
+int nproc_first_smt_sibling(int n);
+
+/* Current frequency of a cpu in kHz as reported by cpufreq,
+ * 0 if unknown.
+ */
+int nproc_cur_freq(int cpu);
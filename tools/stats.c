@@ -0,0 +1,236 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include "compiler.h"
+
+void sample_stats_compute(const uint64_t* v, size_t n,
+                          struct sample_stats* st)
+{
+        double sum = 0, sq = 0, diff = 0;
+        double d;
+        size_t i;
+
+        st->n = n;
+        st->mean = st->stddev = st->jitter = 0;
+        st->min = st->max = 0;
+
+        if(!n)
+                return;
+
+        st->min = st->max = (double)v[0];
+
+        for(i = 0; i < n; ++i)
+        {
+                sum += (double)v[i];
+                st->min = MIN(st->min, (double)v[i]);
+                st->max = MAX(st->max, (double)v[i]);
+
+                if(i)
+                        diff += fabs((double)v[i] - (double)v[i - 1]);
+        }
+
+        st->mean = sum / n;
+
+        for(i = 0; i < n; ++i)
+        {
+                d = (double)v[i] - st->mean;
+                sq += d * d;
+        }
+
+        if(n > 1)
+        {
+                st->stddev = sqrt(sq / (n - 1));
+                st->jitter = diff / (n - 1);
+        }
+}
+
+static
+int sample_cmp(const void* a, const void* b)
+{
+        uint64_t x = *(const uint64_t*)a;
+        uint64_t y = *(const uint64_t*)b;
+
+        return (x > y) - (x < y);
+}
+
+void sample_sort(uint64_t* v, size_t n)
+{
+        qsort(v, n, sizeof(*v), &sample_cmp);
+}
+
+uint64_t sample_percentile(const uint64_t* sorted, size_t n, double p)
+{
+        size_t rank;
+
+        if(!n)
+                return 0;
+
+        rank = (size_t)ceil(p / 100.0 * (double)n);
+        rank = MAX(rank, 1);
+        rank = MIN(rank, n);
+
+        return sorted[rank - 1];
+}
+
+/* Continued fraction of the incomplete beta function,
+ * modified Lentz's method.
+ */
+static
+double ibeta_cf(double a, double b, double x)
+{
+        const double eps = 1e-14;
+        const double tiny = 1e-300;
+        double c, d, h, aa, del;
+        int m, m2;
+
+        c = 1.0;
+        d = 1.0 - (a + b) * x / (a + 1.0);
+        d = fabs(d) < tiny ? tiny : d;
+        d = 1.0 / d;
+        h = d;
+
+        for(m = 1; m <= 300; ++m)
+        {
+                m2 = 2 * m;
+
+                aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+                d = 1.0 + aa * d;
+                d = fabs(d) < tiny ? tiny : d;
+                c = 1.0 + aa / c;
+                c = fabs(c) < tiny ? tiny : c;
+                d = 1.0 / d;
+                h *= d * c;
+
+                aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+                d = 1.0 + aa * d;
+                d = fabs(d) < tiny ? tiny : d;
+                c = 1.0 + aa / c;
+                c = fabs(c) < tiny ? tiny : c;
+                d = 1.0 / d;
+                del = d * c;
+                h *= del;
+
+                if(fabs(del - 1.0) < eps)
+                        break;
+        }
+
+        return h;
+}
+
+/* Regularized incomplete beta function I_x(a, b) */
+static
+double ibeta(double a, double b, double x)
+{
+        double front;
+
+        if(x <= 0.0)
+                return 0.0;
+
+        if(x >= 1.0)
+                return 1.0;
+
+        front = exp(lgamma(a + b) - lgamma(a) - lgamma(b)
+                    + a * log(x) + b * log(1.0 - x));
+
+        /* The continued fraction converges fast only below this point */
+        if(x < (a + 1.0) / (a + b + 2.0))
+                return front * ibeta_cf(a, b, x) / a;
+
+        return 1.0 - front * ibeta_cf(b, a, 1.0 - x) / b;
+}
+
+double student_t_sf(double t, double df)
+{
+        double tail = 0.5 * ibeta(df / 2.0, 0.5, df / (df + t * t));
+
+        return t > 0 ? tail : 1.0 - tail;
+}
+
+/* Inverse of student_t_sf by bisection, the tail is monotonic in t */
+double student_t_isf(double p, double df)
+{
+        double lo = -1e4, hi = 1e4, mid;
+        int i;
+
+        for(i = 0; i < 100; ++i)
+        {
+                mid = 0.5 * (lo + hi);
+
+                if(student_t_sf(mid, df) > p)
+                        lo = mid;
+                else
+                        hi = mid;
+        }
+
+        return 0.5 * (lo + hi);
+}
+
+double sample_mean_ci(const struct sample_stats* st, double confidence)
+{
+        if(st->n < 2)
+                return 0.0;
+
+        return student_t_isf((1.0 - confidence) / 2.0, (double)(st->n - 1))
+               * st->stddev / sqrt((double)st->n);
+}
+
+/* Welch's t statistic of mean(a) - scale * mean(b), returns its standard
+ * error, 0 if both sets have no variance.
+ */
+static
+double welch_t(const struct sample_stats* a, const struct sample_stats* b,
+               double scale, double* t, double* df)
+{
+        double va, vb, se;
+
+        va = a->stddev * a->stddev / a->n;
+        vb = scale * scale * b->stddev * b->stddev / b->n;
+        se = sqrt(va + vb);
+
+        if(se == 0.0)
+                return 0.0;
+
+        *t = (a->mean - scale * b->mean) / se;
+
+        /* Welch-Satterthwaite degrees of freedom */
+        *df = (va + vb) * (va + vb)
+              / (va * va / (a->n - 1) + vb * vb / (b->n - 1));
+
+        return se;
+}
+
+double sample_welch_greater(const struct sample_stats* a,
+                            const struct sample_stats* b, double scale)
+{
+        double t, df;
+
+        if(a->n < 2 || b->n < 2)
+                return 1.0;
+
+        if(welch_t(a, b, scale, &t, &df) == 0.0)
+                return a->mean > scale * b->mean ? 0.0 : 1.0;
+
+        return student_t_sf(t, df);
+}
+
+double sample_welch_diff(const struct sample_stats* a,
+                         const struct sample_stats* b,
+                         double confidence, double* ci)
+{
+        double t, df, se;
+
+        *ci = 0.0;
+
+        if(a->n < 2 || b->n < 2)
+                return 1.0;
+
+        se = welch_t(a, b, 1.0, &t, &df);
+
+        if(se == 0.0)
+                return a->mean != b->mean ? 0.0 : 1.0;
+
+        *ci = student_t_isf((1.0 - confidence) / 2.0, df) * se;
+
+        return 2.0 * student_t_sf(fabs(t), df);
+}
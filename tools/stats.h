@@ -0,0 +1,67 @@
+#pragma once
+
+/* Descriptive statistics of raw samples. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* struct sample_stats - summary of a sample set.
+ *
+ * @n      - count of samples.
+ * @mean   - arithmetic mean.
+ * @stddev - sample standard deviation.
+ * @min    - minimum value.
+ * @max    - maximum value.
+ * @jitter - mean absolute difference of successive samples,
+ *           in the order they were recorded.
+ */
+struct sample_stats
+{
+        size_t n;
+        double mean;
+        double stddev;
+        double min, max;
+        double jitter;
+};
+
+/* Compute a summary of n samples, v is not modified */
+void sample_stats_compute(const uint64_t* v, size_t n,
+                          struct sample_stats* st);
+
+/* Sort samples in ascending order */
+void sample_sort(uint64_t* v, size_t n);
+
+/* Nearest-rank percentile of sorted samples, p is in range [0, 100].
+ * Returns 0 if there are no samples.
+ */
+uint64_t sample_percentile(const uint64_t* sorted, size_t n, double p);
+
+/* Upper tail P(T > t) of Student's t distribution with df degrees
+ * of freedom.
+ */
+double student_t_sf(double t, double df);
+
+/* Inverse of student_t_sf, t such that P(T > t) = p */
+double student_t_isf(double p, double df);
+
+/* Half-width of the two-sided confidence interval of the mean,
+ * 0 if there are less than two samples.
+ */
+double sample_mean_ci(const struct sample_stats* st, double confidence);
+
+/* One-sided Welch's t-test of the hypothesis mean(a) > scale * mean(b),
+ * the samples of b are scaled by scale.
+ * Returns the p-value, a small value means a is significantly greater.
+ * Returns 1 if either set has less than two samples.
+ */
+double sample_welch_greater(const struct sample_stats* a,
+                            const struct sample_stats* b, double scale);
+
+/* Two-sided Welch's t-test of the hypothesis mean(a) != mean(b).
+ * Returns the p-value and stores the half-width of the confidence
+ * interval of mean(a) - mean(b) to ci.
+ * Returns 1 and a zero ci if either set has less than two samples.
+ */
+double sample_welch_diff(const struct sample_stats* a,
+                         const struct sample_stats* b,
+                         double confidence, double* ci);
@@ -0,0 +1,165 @@
+#include "timer.h"
+
+#include <stdbool.h>
+#include <config/config.h>
+#include <tools/log.h>
+#include <tools/error_codes.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+/* Time to sleep between two calibration samples */
+#define TSC_CALIBRATION_NS (20 * NS_IN_MS)
+
+/* Tries to take a calibration sample */
+#define TSC_SAMPLE_TRIES 16
+
+struct perf_clock __perf_clock = {
+        .source = PERF_CLOCK_MONOTONIC,
+        .shift  = 0,
+        .mult   = 1,
+        .freq   = NS_IN_SEC
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+
+static
+bool tsc_is_invariant(void)
+{
+        unsigned int eax, ebx, ecx, edx;
+
+        if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx)
+           || eax < 0x80000007)
+                return false;
+
+        if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+                return false;
+
+        /* Invariant TSC */
+        return (edx & (1u << 8)) != 0;
+}
+
+/* Take a pair of simultaneous TSC and CLOCK_MONOTONIC samples.
+ * The TSC is read between two clock samples and the pair with
+ * the shortest window is taken, so a preemption or an interrupt
+ * in between doesn't spoil the calibration.
+ */
+static
+void tsc_sample(uint64_t* tsc, uint64_t* ns)
+{
+        uint64_t best = UINT64_MAX;
+        uint64_t t0, t1, c;
+        int i;
+
+        *tsc = 0;
+        *ns  = 0;
+
+        for(i = 0; i < TSC_SAMPLE_TRIES; ++i)
+        {
+                t0 = perf_clock_monotonic_ns();
+                c  = __rdtsc();
+                t1 = perf_clock_monotonic_ns();
+
+                if(t1 - t0 < best)
+                {
+                        best = t1 - t0;
+                        *tsc = c;
+                        *ns  = t0 + (t1 - t0) / 2;
+                }
+        }
+}
+
+static
+uint64_t tsc_calibrate(void)
+{
+        struct timespec req = {
+                .tv_sec  = 0,
+                .tv_nsec = TSC_CALIBRATION_NS
+        };
+        uint64_t c0, c1, t0, t1;
+
+        tsc_sample(&c0, &t0);
+        nanosleep(&req, NULL);
+        tsc_sample(&c1, &t1);
+
+        if(c1 <= c0 || t1 <= t0)
+                return 0;
+
+        return (c1 - c0) * NS_IN_SEC / (t1 - t0);
+}
+
+static
+int tsc_init(void)
+{
+        uint64_t freq;
+
+        if(!tsc_is_invariant())
+        {
+                LOG_WARN("TSC is not invariant, falling back to "
+                         "clock_gettime timer.");
+                return MDB_FAIL;
+        }
+
+        freq = tsc_calibrate();
+        if(!freq)
+        {
+                LOG_WARN("TSC calibration failed, falling back to "
+                         "clock_gettime timer.");
+                return MDB_FAIL;
+        }
+
+        __perf_clock.shift  = 32;
+        __perf_clock.mult   = (NS_IN_SEC << 32) / freq;
+        __perf_clock.freq   = freq;
+        __perf_clock.source = PERF_CLOCK_TSC;
+
+        LOG_VINFO(LOG_VERBOSE1, "TSC frequency calibrated to %.3f MHz",
+                  (double)freq / 1e6);
+
+        return MDB_SUCCESS;
+}
+
+#else
+
+static
+int tsc_init(void)
+{
+        LOG_WARN("TSC timer is not supported on this platform, "
+                 "falling back to clock_gettime timer.");
+
+        return MDB_FAIL;
+}
+
+#endif
+
+int perf_clock_init(int source)
+{
+        if(source == PERF_CLOCK_DEFAULT)
+                source = IS_ENABLED(CONFIG_TIMER_TSC) ? PERF_CLOCK_TSC
+                                                      : PERF_CLOCK_MONOTONIC;
+
+        __perf_clock.source = PERF_CLOCK_MONOTONIC;
+        __perf_clock.shift  = 0;
+        __perf_clock.mult   = 1;
+        __perf_clock.freq   = NS_IN_SEC;
+
+        if(source == PERF_CLOCK_TSC)
+                return tsc_init();
+
+        return MDB_SUCCESS;
+}
+
+const char* perf_clock_name(void)
+{
+        switch(__perf_clock.source)
+        {
+        case PERF_CLOCK_TSC:
+                return "tsc";
+        case PERF_CLOCK_MONOTONIC:
+                return "clock";
+
+        default:
+                return "unknown";
+        }
+}
@@ -7,6 +7,10 @@
 #include <stdio.h>
 #include <inttypes.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 #define NS_IN_SEC UINT64_C(1000000000)
 #define NS_IN_MS  UINT64_C(1000000)
 #define NS_IN_MCS UINT64_C(1000)
@@ -63,44 +67,128 @@ uint64_t timespec_get_total_ns(const struct timespec* ts)
         return total_ns;
 }
 
-struct perf_timer
+/* Timer backends.
+ *
+ * All perf timers count in ticks of a process wide clock source
+ * and convert to nanoseconds only when a difference is requested.
+ *
+ * PERF_CLOCK_MONOTONIC - clock_gettime(CLOCK_MONOTONIC), a tick is 1 ns.
+ * PERF_CLOCK_TSC       - the CPU time stamp counter read by rdtsc.
+ *                        Available only if the TSC is invariant
+ *                        ( constant rate and does not stop in idle states ),
+ *                        its frequency is calibrated against CLOCK_MONOTONIC.
+ *                        Reading it takes a couple of dozens of cycles
+ *                        instead of a vDSO call.
+ *
+ * rdtsc is not a serializing instruction so a TSC sample may drift
+ * by a few dozens of cycles around the code being measured, this is
+ * negligible on tile and frame scale timings.
+ *
+ * The source is selected by perf_clock_init, timers must not be running
+ * while it's called. Until then PERF_CLOCK_MONOTONIC is used.
+ */
+enum
 {
-        struct timespec start, end;
+        PERF_CLOCK_DEFAULT   = -1,
+        PERF_CLOCK_MONOTONIC = 0,
+        PERF_CLOCK_TSC       = 1
+};
 
+/* struct perf_clock - current timer backend.
+ *
+ * @source - PERF_CLOCK_* in use.
+ * @shift  - ticks to ns conversion: ns = ticks * mult >> shift.
+ * @mult
+ * @freq   - tick frequency in Hz.
+ */
+struct perf_clock
+{
+        int source;
+        uint32_t shift;
+        uint64_t mult;
+        uint64_t freq;
 };
 
+extern struct perf_clock __perf_clock;
+
+/* Select a clock source, PERF_CLOCK_DEFAULT is PERF_CLOCK_TSC if
+ * CONFIG_TIMER_TSC is enabled and PERF_CLOCK_MONOTONIC otherwise.
+ * If the TSC is requested but not usable falls back to
+ * PERF_CLOCK_MONOTONIC and returns MDB_FAIL.
+ */
+int perf_clock_init(int source);
+
+/* Name of the clock source in use */
+const char* perf_clock_name(void);
+
 static inline
-void perf_timer_start(struct perf_timer* tm)
+uint64_t perf_clock_monotonic_ns(void)
 {
-        clock_gettime(CLOCK_MONOTONIC, &tm->start);
+        struct timespec tm;
+
+        clock_gettime(CLOCK_MONOTONIC, &tm);
+
+        return timespec_get_total_ns(&tm);
 }
 
+/* Returns a timestamp in ticks of the current clock source */
 static inline
-void perf_timer_stop(struct perf_timer* tm)
+uint64_t perf_ticks(void)
 {
-        clock_gettime(CLOCK_MONOTONIC, &tm->end);
+#if defined(__x86_64__) || defined(__i386__)
+        if(__perf_clock.source == PERF_CLOCK_TSC)
+                return __rdtsc();
+#endif
+
+        return perf_clock_monotonic_ns();
 }
 
 static inline
-uint64_t perf_timer_diff_ns(const struct perf_timer* tm)
+uint64_t perf_ticks_to_ns(uint64_t ticks)
 {
-        uint64_t total_start = timespec_get_total_ns(&tm->start);
-        uint64_t total_end   = timespec_get_total_ns(&tm->end);
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 ns = (unsigned __int128)ticks * __perf_clock.mult;
 
-        uint64_t diff = total_end - total_start;
+        return (uint64_t)(ns >> __perf_clock.shift);
+#else
+        return (uint64_t)((double)ticks * NS_IN_SEC / __perf_clock.freq);
+#endif
+}
 
-        return diff;
+/* Returns a monotonic timestamp in ns */
+static inline
+uint64_t perf_clock_ns(void)
+{
+        return perf_ticks_to_ns(perf_ticks());
 }
 
+struct perf_timer
+{
+        uint64_t start, end;
+};
+
 static inline
-double perf_timer_diff_sec(const struct perf_timer* tm)
+void perf_timer_start(struct perf_timer* tm)
+{
+        tm->start = perf_ticks();
+}
+
+static inline
+void perf_timer_stop(struct perf_timer* tm)
 {
-        double total_start  = timespec_get_total_sec(&tm->start);
-        double total_end    = timespec_get_total_sec(&tm->end);
+        tm->end = perf_ticks();
+}
 
-        double diff = total_end - total_start;
+static inline
+uint64_t perf_timer_diff_ns(const struct perf_timer* tm)
+{
+        return perf_ticks_to_ns(tm->end - tm->start);
+}
 
-        return diff;
+static inline
+double perf_timer_diff_sec(const struct perf_timer* tm)
+{
+        return ns_to_sec(perf_timer_diff_ns(tm));
 }
 
 static inline
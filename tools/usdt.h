@@ -0,0 +1,130 @@
+#pragma once
+
+/* USDT static tracepoints.
+ *
+ * A probe is a single nop in the code and a record in the .note.stapsdt
+ * ELF section describing where its arguments live, so it costs nothing
+ * until a tracer attaches to it. Probes can be listed and attached with
+ *
+ *   perf probe -x ./mdb --add sdt_mdb:frame_start
+ *   bpftrace -l 'usdt:./mdb:mdb:*'
+ *   bpftrace -e 'usdt:./mdb:mdb:task_end { @[arg0] = count(); }'
+ *
+ * If <sys/sdt.h> from systemtap is available it's used as is, otherwise
+ * on x86-64 an equivalent note is emitted by the macros below.
+ * Probe arguments are passed as signed 64 bit integers, so a pointer to
+ * a string can be read with str(argN) in bpftrace.
+ *
+ * Probes of the mdb provider:
+ *
+ *   frame_start(frame)
+ *   frame_end(frame, frame_ns)
+ *   task_pop(worker)                    - a task popped from the queue
+ *   task_begin(worker, x0, x1, y0, y1)
+ *   task_end(worker, x0, x1, y0, y1)
+ *   worker_park(worker)
+ *   worker_unpark(worker)
+ *   kernel_load(name, handle)
+ *   pbo_update_start(width, height)
+ *   pbo_update_end(width, height)
+ *
+ * The host worker id is -1.
+ */
+
+#include <stdint.h>
+#include <config/config.h>
+
+#if defined(CONFIG_USDT_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MDB_USDT_SYS_SDT 1
+#endif
+#endif
+
+#if defined(CONFIG_USDT_PROBES) && defined(MDB_USDT_SYS_SDT)
+
+#define MDB_PROBE0(name) \
+        DTRACE_PROBE(mdb, name)
+
+#define MDB_PROBE1(name, a1) \
+        DTRACE_PROBE1(mdb, name, (int64_t)(a1))
+
+#define MDB_PROBE2(name, a1, a2) \
+        DTRACE_PROBE2(mdb, name, (int64_t)(a1), (int64_t)(a2))
+
+#define MDB_PROBE5(name, a1, a2, a3, a4, a5) \
+        DTRACE_PROBE5(mdb, name, (int64_t)(a1), (int64_t)(a2), \
+                      (int64_t)(a3), (int64_t)(a4), (int64_t)(a5))
+
+#elif defined(CONFIG_USDT_PROBES) && defined(__x86_64__)
+
+/* Same layout as sys/sdt.h produces: a note with the probe address,
+ * the address of .stapsdt.base for prelink adjustments, no semaphore,
+ * the provider, the probe name and arguments as "-8@operand".
+ */
+#define __MDB_USDT_NOTE(name, args) \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f-991f, 994f-993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: .8byte 990b\n" \
+        ".8byte _.stapsdt.base\n" \
+        ".8byte 0\n" \
+        ".asciz \"mdb\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"" args "\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\"," \
+        ".stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n"
+
+#define __MDB_USDT_ARG(n) "-8@%[a" #n "]"
+
+#define __MDB_USDT_OP(n, v) [a##n] "nor" ((int64_t)(v))
+
+#define MDB_PROBE0(name) \
+        __asm__ __volatile__(__MDB_USDT_NOTE(name, ""))
+
+#define MDB_PROBE1(name, a1) \
+        __asm__ __volatile__(__MDB_USDT_NOTE(name, __MDB_USDT_ARG(1)) \
+                             :: __MDB_USDT_OP(1, a1))
+
+#define MDB_PROBE2(name, a1, a2) \
+        __asm__ __volatile__(__MDB_USDT_NOTE(name, \
+                                             __MDB_USDT_ARG(1) " " \
+                                             __MDB_USDT_ARG(2)) \
+                             :: __MDB_USDT_OP(1, a1), \
+                                __MDB_USDT_OP(2, a2))
+
+#define MDB_PROBE5(name, a1, a2, a3, a4, a5) \
+        __asm__ __volatile__(__MDB_USDT_NOTE(name, \
+                                             __MDB_USDT_ARG(1) " " \
+                                             __MDB_USDT_ARG(2) " " \
+                                             __MDB_USDT_ARG(3) " " \
+                                             __MDB_USDT_ARG(4) " " \
+                                             __MDB_USDT_ARG(5)) \
+                             :: __MDB_USDT_OP(1, a1), \
+                                __MDB_USDT_OP(2, a2), \
+                                __MDB_USDT_OP(3, a3), \
+                                __MDB_USDT_OP(4, a4), \
+                                __MDB_USDT_OP(5, a5))
+
+#else
+
+#define MDB_PROBE0(name) do { } while(0)
+#define MDB_PROBE1(name, a1) do { (void)(a1); } while(0)
+#define MDB_PROBE2(name, a1, a2) do { (void)(a1); (void)(a2); } while(0)
+#define MDB_PROBE5(name, a1, a2, a3, a4, a5) \
+        do { (void)(a1); (void)(a2); (void)(a3); \
+             (void)(a4); (void)(a5); } while(0)
+
+#endif